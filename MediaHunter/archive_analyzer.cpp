@@ -0,0 +1,484 @@
+﻿#include "archive_analyzer.h"
+#include "zip_archive.h"
+#include "mapped_file.h"
+#include "file_reader.h"
+#include "signature_scanner.h"
+#include "steganography_checker.h"
+#include "extension_checker.h"
+#include "inflate_stream.h"
+#include "tar_stream.h"
+#include "thread_pool.h"
+#include "console_output.h"
+#include "buffer_pool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// Пределы распаковки. Коэффициент сжатия проверяется только сверх
+// kRatioFloor: мелкие XML-части документов сжимаются сильнее
+const size_t kMaxArchiveMembers = 1024;
+const uint64_t kMaxMemberBytes = 256ULL * 1024ULL * 1024ULL;
+const uint64_t kMaxArchiveBytes = 1024ULL * 1024ULL * 1024ULL;
+const uint64_t kMaxCompressionRatio = 100;
+const uint64_t kRatioFloor = 1024ULL * 1024ULL;
+
+const size_t kStreamChunk = 1024 * 1024;
+
+std::string detectType(ByteView content) {
+    const size_t signatureBytes = 64;
+    std::vector<uint8_t> signature(content.begin(), content.begin() + std::min(content.size(), signatureBytes));
+    return FileReader(std::string()).detectFileType(signature);
+}
+
+uint64_t ratioLimit(uint64_t compressed) {
+    return compressed > std::numeric_limits<uint64_t>::max() / kMaxCompressionRatio
+        ? std::numeric_limits<uint64_t>::max()
+        : std::max(kRatioFloor, compressed * kMaxCompressionRatio);
+}
+
+// Элементы потокового архива: поток распаковки собирает элемент целиком и
+// отдаёт его в общий пул, а отчёты выводит в порядке следования элементов.
+// Содержимое ещё не проанализированных элементов занимает не больше window
+// байт — поток распаковки ждёт, пока окно освободится
+class MemberPipeline {
+public:
+    using Analyze = std::function<void(const std::string& name, ByteView content, std::vector<std::string>& lines)>;
+
+    MemberPipeline(Analyze analyze, uint64_t window, std::vector<std::string>& lines)
+        : analyze_(std::move(analyze)), window_(window), lines_(lines) {}
+
+    ~MemberPipeline() { waitAll(); }
+
+    MemberPipeline(const MemberPipeline&) = delete;
+    MemberPipeline& operator=(const MemberPipeline&) = delete;
+
+    // Строка отчёта самого архива в общем порядке вывода
+    void note(const std::string& line) {
+        auto job = std::make_shared<Job>();
+        job->lines.push_back(line);
+        job->output = line + "\n";
+        job->done = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(job);
+        }
+        flushReady();
+    }
+
+    // Место в окне под элемент; size не больше окна
+    void reserve(uint64_t size) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            finished_.wait(lock, [&] { return inFlight_ == 0 || inFlight_ + size <= window_; });
+            inFlight_ += size;
+        }
+        flushReady();
+    }
+
+    // Возврат места элемента, который не будет проанализирован
+    void release(uint64_t size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inFlight_ -= size;
+    }
+
+    void submit(const std::string& name, PooledBuffer content, uint64_t reserved) {
+        auto job = std::make_shared<Job>();
+        job->name = name;
+        job->content = std::move(content);
+        job->reserved = reserved;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(job);
+        }
+        ThreadPool::shared().submit([this, job] { run(*job); });
+        flushReady();
+    }
+
+    // Вывод завершённых элементов, идущих подряд с начала очереди
+    void flushReady() {
+        std::vector<std::shared_ptr<Job>> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (!jobs_.empty() && jobs_.front()->done) {
+                ready.push_back(jobs_.front());
+                jobs_.pop_front();
+            }
+        }
+        for (const auto& job : ready) {
+            console() << job->output;
+            lines_.insert(lines_.end(), job->lines.begin(), job->lines.end());
+        }
+    }
+
+    void finish() {
+        waitAll();
+        flushReady();
+    }
+
+private:
+    struct Job {
+        std::string name;
+        PooledBuffer content;
+        uint64_t reserved = 0;
+        std::vector<std::string> lines;
+        std::string output;
+        bool done = false;
+    };
+
+    void run(Job& job) {
+        {
+            ConsoleCapture capture;
+            try {
+                analyze_(job.name, job.content.view(), job.lines);
+            }
+            catch (const std::exception& e) {
+                std::string line = "Ошибка при анализе элемента " + job.name + ": " + e.what();
+                job.lines.push_back(line);
+                console() << line << "\n";
+            }
+            job.output = capture.text();
+        }
+        job.content.reset();
+        // Оповещение под блокировкой: увидев последний завершённый элемент,
+        // finish() и деструктор могут сразу уничтожить mutex_ и finished_
+        std::lock_guard<std::mutex> lock(mutex_);
+        inFlight_ -= job.reserved;
+        job.done = true;
+        finished_.notify_all();
+    }
+
+    void waitAll() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [&] {
+            return std::all_of(jobs_.begin(), jobs_.end(), [](const std::shared_ptr<Job>& job) { return job->done; });
+        });
+    }
+
+    Analyze analyze_;
+    uint64_t window_;
+    std::vector<std::string>& lines_;
+    std::deque<std::shared_ptr<Job>> jobs_;
+    uint64_t inFlight_ = 0;
+    std::mutex mutex_;
+    std::condition_variable finished_;
+};
+
+// Разбор tar поверх конвейера: обычные файлы в пределах memberLimit
+// собираются в буфер и уходят на анализ, остальные записи пропускаются
+class TarSession {
+public:
+    TarSession(MemberPipeline& pipeline, uint64_t memberLimit)
+        : pipeline_(pipeline), memberLimit_(memberLimit),
+          reader_([this](const TarEntry& entry) { return start(entry); },
+              [this](const uint8_t* data, size_t size) { current_.append(data, size); },
+              [this] { end(); }) {}
+
+    // false — дальнейший вход не нужен (повреждённый заголовок или предел
+    // числа элементов)
+    bool feed(const uint8_t* data, size_t size) {
+        if (stopped_) return false;
+        if (!reader_.feed(data, size)) {
+            pipeline_.note("- [!] TAR: повреждённый заголовок после " + std::to_string(reader_.entryCount()) +
+                " записей: " + reader_.error());
+            stopped_ = true;
+        }
+        return !stopped_;
+    }
+
+    void finish() {
+        if (reader_.insideEntry()) {
+            pipeline_.note("- [!] TAR: архив обрывается внутри элемента " + reader_.current().name);
+            pipeline_.release(reader_.current().size);
+            current_.reset();
+        }
+        pipeline_.note("- TAR: проверено элементов: " + std::to_string(analyzed_) + " из " + std::to_string(files_));
+    }
+
+private:
+    bool start(const TarEntry& entry) {
+        if (!entry.regular() || stopped_) return false;
+        if (++files_ > kMaxArchiveMembers) {
+            pipeline_.note("- [!] TAR: достигнут предел числа элементов (" + std::to_string(kMaxArchiveMembers) +
+                "), остальные не проверяются");
+            files_--;
+            stopped_ = true;
+            return false;
+        }
+        if (entry.size > memberLimit_) {
+            pipeline_.note("- [!] TAR: элемент " + entry.name + " больше " + std::to_string(memberLimit_) + " байт, не проверяется");
+            return false;
+        }
+        pipeline_.reserve(entry.size);
+        current_.clear();
+        current_.reserve(static_cast<size_t>(entry.size));
+        return true;
+    }
+
+    void end() {
+        const TarEntry& entry = reader_.current();
+        pipeline_.submit(entry.name, std::move(current_), entry.size);
+        analyzed_++;
+    }
+
+    MemberPipeline& pipeline_;
+    uint64_t memberLimit_;
+    TarReader reader_;
+    PooledBuffer current_;
+    size_t files_ = 0;
+    size_t analyzed_ = 0;
+    bool stopped_ = false;
+};
+
+} // namespace
+
+std::vector<std::string> ArchiveAnalyzer::analyzeFile(const std::string& filePath) {
+    std::vector<std::string> lines;
+    MappedFile mapped;
+    if (!mapped.open(filePath)) return lines;
+    std::string format = detectType(ByteView(mapped.data(), mapped.size()));
+    if (format == "ZIP") {
+        analyzeZip(mapped.data(), mapped.size(), lines);
+    }
+    else if (format == "GZIP") {
+        analyzeGzip(filePath, mapped.data(), mapped.size(), lines);
+    }
+    else if (isTarHeader(mapped.data(), mapped.size())) {
+        analyzeTar(mapped.data(), mapped.size(), lines);
+    }
+    else {
+        // Самораспаковывающийся архив или полиглот (JPEG+ZIP): файл
+        // начинается с другого формата, а каталог ZIP лежит в конце.
+        // Архивом считается файл, у которого читается первая запись каталога
+        ZipArchive probe;
+        if (parseZipArchive(mapped.data(), mapped.size(), probe, 1) && !probe.entries.empty()) {
+            analyzeZip(mapped.data(), mapped.size(), lines);
+        }
+    }
+    return lines;
+}
+
+void ArchiveAnalyzer::analyzeZip(const uint8_t* data, size_t size, std::vector<std::string>& lines) {
+    auto add = [&](const std::string& line) {
+        lines.push_back(line);
+        console() << line << "\n";
+    };
+
+    console() << "========================================\n";
+    ZipArchive zip;
+    if (!parseZipArchive(data, size, zip, kMaxArchiveMembers)) {
+        add("- [!] ZIP: центральный каталог не найден, элементы архива не проверяются");
+        return;
+    }
+    add("Архив: " + zip.kind + ", записей: " + std::to_string(zip.declaredEntries) + (zip.zip64 ? " (ZIP64)" : ""));
+    if (zip.leadingBytes > 0) {
+        add("- ZIP: архиву предшествуют " + std::to_string(zip.leadingBytes) + " байт данных другого формата");
+    }
+    if (zip.directoryTruncated) {
+        add("- [!] ZIP: центральный каталог обрывается после " + std::to_string(zip.entries.size()) +
+            " записей из " + std::to_string(zip.declaredEntries));
+    }
+    else if (zip.entries.size() < zip.declaredEntries) {
+        add("- ZIP: проверяются первые " + std::to_string(zip.entries.size()) + " записей из " +
+            std::to_string(zip.declaredEntries));
+    }
+
+    std::vector<uint8_t> buffer;
+    uint64_t produced = 0;
+    size_t files = 0;
+    size_t analyzed = 0;
+    for (const ZipEntry& entry : zip.entries) {
+        if (entry.directory()) continue;
+        files++;
+        const uint64_t remaining = kMaxArchiveBytes - produced;
+        if (remaining == 0) {
+            add("- [!] ZIP: достигнут предел распаковки архива (" + std::to_string(kMaxArchiveBytes) +
+                " байт), остальные элементы не проверяются");
+            break;
+        }
+        const uint64_t memberRatioLimit = ratioLimit(entry.compressedSize);
+        const uint64_t limit = std::min({ kMaxMemberBytes, remaining, memberRatioLimit });
+
+        ByteView content;
+        std::string error;
+        ZipExtractResult result = extractZipEntry(data, size, entry, limit, buffer, content, error);
+        switch (result) {
+        case ZipExtractResult::Encrypted:
+            add("- [!] ZIP: элемент " + entry.name + " зашифрован, содержимое не проверяется");
+            continue;
+        case ZipExtractResult::Unsupported:
+            add("- ZIP: элемент " + entry.name + ": метод сжатия " + std::to_string(entry.method) + " не поддерживается");
+            continue;
+        case ZipExtractResult::Corrupt:
+            add("- [!] ZIP: элемент " + entry.name + " повреждён: " + error);
+            continue;
+        case ZipExtractResult::OutputLimit:
+            if (limit == remaining && remaining < kMaxMemberBytes && remaining <= memberRatioLimit) {
+                add("- [!] ZIP: достигнут предел распаковки архива (" + std::to_string(kMaxArchiveBytes) +
+                    " байт), остальные элементы не проверяются");
+                produced = kMaxArchiveBytes;
+            }
+            else if (limit == memberRatioLimit) {
+                add("- [!] ZIP: элемент " + entry.name + ": коэффициент сжатия больше " +
+                    std::to_string(kMaxCompressionRatio) + ":1 (возможна ZIP-бомба), не проверяется");
+            }
+            else {
+                add("- [!] ZIP: элемент " + entry.name + " больше " + std::to_string(kMaxMemberBytes) + " байт, не проверяется");
+            }
+            continue;
+        case ZipExtractResult::CrcMismatch:
+            add("- [!] ZIP: элемент " + entry.name + ": CRC-32 не совпадает с каталогом");
+            break;
+        case ZipExtractResult::Ok:
+            break;
+        }
+        if (content.size() != entry.uncompressedSize) {
+            add("- [!] ZIP: размер элемента " + entry.name + " (" + std::to_string(content.size()) +
+                " байт) не совпадает с каталогом (" + std::to_string(entry.uncompressedSize) + " байт)");
+        }
+        produced += content.size();
+        analyzeMember(entry.name, content, lines);
+        analyzed++;
+    }
+    add("- ZIP: проверено элементов: " + std::to_string(analyzed) + " из " + std::to_string(files));
+}
+
+void ArchiveAnalyzer::analyzeGzip(const std::string& filePath, const uint8_t* data, size_t size,
+    std::vector<std::string>& lines) {
+    console() << "========================================\n";
+    std::string header = "Архив: GZIP, " + std::to_string(size) + " байт";
+    console() << header << "\n";
+    lines.push_back(header);
+
+    const uint64_t memberLimit = std::min(kMaxMemberBytes, streamWindow_);
+    MemberPipeline pipeline([this](const std::string& name, ByteView content, std::vector<std::string>& out) {
+        analyzeMember(name, content, out);
+    }, streamWindow_, lines);
+    TarSession tar(pipeline, memberLimit);
+
+    // Пока не набрано 512 байт, неизвестно, лежит ли внутри tar; поток без
+    // tar анализируется как один файл
+    enum class Payload { Unknown, Tar, Single };
+    Payload payload = Payload::Unknown;
+    PooledBuffer single;
+    bool singleTooLarge = false;
+
+    const uint64_t outputLimit = std::min(kMaxArchiveBytes, ratioLimit(size));
+    Inflater inflater(Inflater::Format::Gzip, outputLimit);
+    size_t offset = 0;
+    Inflater::Source source = [&](const uint8_t*& chunk, size_t& chunkSize) {
+        if (offset >= size) return false;
+        chunk = data + offset;
+        chunkSize = std::min(kStreamChunk, size - offset);
+        offset += chunkSize;
+        return true;
+    };
+    Inflater::Sink sink = [&](const uint8_t* chunk, size_t chunkSize) {
+        if (payload == Payload::Tar) return tar.feed(chunk, chunkSize);
+        if (single.size() + chunkSize > memberLimit) {
+            singleTooLarge = true;
+            return false;
+        }
+        single.append(chunk, chunkSize);
+        if (payload == Payload::Unknown && single.size() >= 512) {
+            if (isTarHeader(single.data(), single.size())) {
+                payload = Payload::Tar;
+                bool more = tar.feed(single.data(), single.size());
+                single.reset();
+                return more;
+            }
+            payload = Payload::Single;
+        }
+        return true;
+    };
+    Inflater::Result result = inflater.run(source, sink);
+
+    switch (result) {
+    case Inflater::Result::Done:
+        if (inflater.trailingInput() > 0) {
+            pipeline.note("- [!] GZIP: данные после конца потока: " + std::to_string(inflater.trailingInput()) + " байт");
+        }
+        break;
+    case Inflater::Result::OutputLimit:
+        pipeline.note(outputLimit < kMaxArchiveBytes
+            ? "- [!] GZIP: коэффициент сжатия больше " + std::to_string(kMaxCompressionRatio) + ":1 (возможна gzip-бомба), распаковка остановлена"
+            : "- [!] GZIP: достигнут предел распаковки архива (" + std::to_string(kMaxArchiveBytes) + " байт)");
+        break;
+    case Inflater::Result::Truncated:
+    case Inflater::Result::Error:
+        pipeline.note("- [!] GZIP: " + inflater.error() + " (распаковано " + std::to_string(inflater.outputProduced()) + " байт)");
+        break;
+    case Inflater::Result::Stopped:
+        if (singleTooLarge) {
+            pipeline.note("- [!] GZIP: содержимое больше " + std::to_string(memberLimit) + " байт, не проверяется");
+        }
+        break;
+    }
+
+    if (payload == Payload::Tar) {
+        tar.finish();
+    }
+    else if (result != Inflater::Result::OutputLimit && !singleTooLarge && !single.empty()) {
+        std::string name = inflater.gzipName().empty()
+            ? std::filesystem::path(filePath).stem().string()
+            : inflater.gzipName();
+        uint64_t length = single.size();
+        pipeline.reserve(length);
+        pipeline.submit(name, std::move(single), length);
+    }
+    pipeline.finish();
+
+    std::string summary = "- GZIP: распаковано " + std::to_string(inflater.outputProduced()) + " байт" +
+        (inflater.gzipMembers() > 1 ? ", потоков gzip: " + std::to_string(inflater.gzipMembers()) : "") +
+        (payload == Payload::Tar ? ", внутри tar" : "");
+    console() << summary << "\n";
+    lines.push_back(summary);
+}
+
+void ArchiveAnalyzer::analyzeTar(const uint8_t* data, size_t size, std::vector<std::string>& lines) {
+    console() << "========================================\n";
+    std::string header = "Архив: TAR, " + std::to_string(size) + " байт";
+    console() << header << "\n";
+    lines.push_back(header);
+
+    const uint64_t memberLimit = std::min(kMaxMemberBytes, streamWindow_);
+    MemberPipeline pipeline([this](const std::string& name, ByteView content, std::vector<std::string>& out) {
+        analyzeMember(name, content, out);
+    }, streamWindow_, lines);
+    TarSession tar(pipeline, memberLimit);
+    for (size_t offset = 0; offset < size; offset += kStreamChunk) {
+        if (!tar.feed(data + offset, std::min(kStreamChunk, size - offset))) break;
+    }
+    tar.finish();
+    pipeline.finish();
+}
+
+void ArchiveAnalyzer::analyzeMember(const std::string& name, ByteView content, std::vector<std::string>& lines) {
+    std::string format = detectType(content);
+    std::string header = "Элемент архива: " + name + " (" + std::to_string(content.size()) + " байт, тип " + format + ")";
+    console() << "----------------------------------------\n";
+    console() << header << "\n";
+    lines.push_back(header);
+
+    std::string threat = scanner_.analyzeMemory(content.data(), content.size());
+    std::string signatureLine = threat == "OK"
+        ? "Результат сигнатурного анализа: угроз не обнаружено."
+        : "Результат сигнатурного анализа: обнаружена угроза: " + threat;
+    console() << signatureLine << "\n";
+    lines.push_back(signatureLine);
+
+    SteganographyChecker stegoChecker;
+    stegoChecker.setSignatureScanner(&scanner_);
+    std::vector<std::string> stegLines = stegoChecker.analyzeMemory(name, content.data(), content.size());
+    lines.insert(lines.end(), stegLines.begin(), stegLines.end());
+
+    ExtensionChecker extChecker;
+    std::vector<std::string> extLines = extChecker.analyzeName(name, format);
+    lines.insert(lines.end(), extLines.begin(), extLines.end());
+}
@@ -0,0 +1,45 @@
+﻿#ifndef ARCHIVE_ANALYZER_H
+#define ARCHIVE_ANALYZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "byte_ranges.h"
+
+class SignatureScanner;
+
+// Проверка элементов архивов без распаковки на диск: каждый элемент
+// извлекается в память и проходит определение типа, YARA, анализ
+// стеганографии и проверку имени. Объём распаковки ограничен по элементу,
+// по коэффициенту сжатия и по архиву в целом
+class ArchiveAnalyzer {
+public:
+    static constexpr uint64_t kDefaultStreamWindow = 256ULL * 1024ULL * 1024ULL;
+
+    // streamWindow — сколько байт содержимого элементов tar и gzip может
+    // ожидать анализа одновременно
+    explicit ArchiveAnalyzer(SignatureScanner& scanner, uint64_t streamWindow = kDefaultStreamWindow)
+        : scanner_(scanner), streamWindow_(streamWindow) {}
+
+    // Пустой отчёт — файл не является архивом поддерживаемого формата
+    std::vector<std::string> analyzeFile(const std::string& filePath);
+
+private:
+    // Центральный каталог читается из отображения файла, сжатые элементы
+    // распаковываются в один переиспользуемый буфер
+    void analyzeZip(const uint8_t* data, size_t size, std::vector<std::string>& lines);
+
+    // tar и gzip (в том числе .tar.gz) читаются за один проход: распаковка
+    // и разбор tar идут в вызывающем потоке, собранные элементы
+    // анализируются в общем пуле, а их отчёты выводятся в порядке следования
+    void analyzeGzip(const std::string& filePath, const uint8_t* data, size_t size, std::vector<std::string>& lines);
+    void analyzeTar(const uint8_t* data, size_t size, std::vector<std::string>& lines);
+
+    void analyzeMember(const std::string& name, ByteView content, std::vector<std::string>& lines);
+
+    SignatureScanner& scanner_;
+    uint64_t streamWindow_;
+};
+
+#endif // ARCHIVE_ANALYZER_H
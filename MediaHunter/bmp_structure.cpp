@@ -0,0 +1,144 @@
+﻿#include "bmp_structure.h"
+
+namespace {
+
+inline uint32_t readLE16(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8);
+}
+
+inline uint32_t readLE32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+const uint32_t kFileHeaderSize = 14;
+const uint32_t kProfileEmbedded = 0x4D424544;   // 'MBED'
+
+} // namespace
+
+const char* BmpHeader::headerName() const {
+    switch (dibSize) {
+    case 12: return "BITMAPCOREHEADER";
+    case 40: return "BITMAPINFOHEADER";
+    case 52: return "BITMAPV2INFOHEADER";
+    case 56: return "BITMAPV3INFOHEADER";
+    case 64: return "OS22XBITMAPHEADER";
+    case 108: return "BITMAPV4HEADER";
+    case 124: return "BITMAPV5HEADER";
+    default: return "нестандартный";
+    }
+}
+
+bool parseBmpHeader(const uint8_t* data, size_t size, BmpHeader& h, std::string& error) {
+    h = BmpHeader();
+    if (size < kFileHeaderSize + 12 || data[0] != 'B' || data[1] != 'M') {
+        error = "нет заголовка BMP";
+        return false;
+    }
+    h.declaredFileSize = readLE32(data + 2);
+    h.pixelOffset = readLE32(data + 10);
+    h.dibSize = readLE32(data + 14);
+    if (h.dibSize < 12 || h.dibSize > size - kFileHeaderSize) {
+        error = "некорректный размер DIB-заголовка";
+        return false;
+    }
+    const uint8_t* dib = data + kFileHeaderSize;
+
+    if (h.dibSize == 12) {
+        h.width = readLE16(dib + 4);
+        h.height = readLE16(dib + 6);
+        h.bitCount = static_cast<uint16_t>(readLE16(dib + 10));
+    }
+    else {
+        if (h.dibSize < 40) {
+            error = "некорректный размер DIB-заголовка";
+            return false;
+        }
+        h.width = static_cast<int32_t>(readLE32(dib + 4));
+        int32_t height = static_cast<int32_t>(readLE32(dib + 8));
+        h.topDown = height < 0;
+        h.height = height < 0 ? -int64_t(height) : height;
+        h.bitCount = static_cast<uint16_t>(readLE16(dib + 14));
+        h.compression = readLE32(dib + 16);
+        h.paletteEntries = readLE32(dib + 32);
+    }
+    if (h.width <= 0 || h.height <= 0) {
+        error = "нулевые или отрицательные размеры";
+        return false;
+    }
+
+    // Маски каналов: в V2+ внутри заголовка, у BITMAPINFOHEADER — сразу после него
+    uint64_t masksAfterHeader = 0;
+    if (h.compression == 3 || h.compression == 6) {
+        int maskCount = h.compression == 6 ? 4 : 3;
+        if (h.dibSize == 40) masksAfterHeader = 4u * maskCount;
+        if (kFileHeaderSize + h.dibSize + masksAfterHeader > size) {
+            error = "маски каналов за пределами файла";
+            return false;
+        }
+        const uint8_t* masks = dib + 40;
+        for (int i = 0; i < maskCount && 40 + 4u * i + 4 <= h.dibSize + masksAfterHeader; ++i) {
+            h.masks[i] = readLE32(masks + 4 * i);
+        }
+    }
+
+    // Палитра: у индексированных изображений по умолчанию 2^bitCount записей;
+    // у BI_JPEG и BI_PNG (bitCount 0) палитры нет
+    const uint64_t entrySize = h.dibSize == 12 ? 3 : 4;
+    const bool indexed = h.bitCount == 1 || h.bitCount == 4 || h.bitCount == 8;
+    if (indexed && h.paletteEntries == 0) h.paletteEntries = uint64_t(1) << h.bitCount;
+    h.headerEnd = kFileHeaderSize + h.dibSize + masksAfterHeader + h.paletteEntries * entrySize;
+
+    bool validDepth = h.bitCount == 1 || h.bitCount == 4 || h.bitCount == 8 || h.bitCount == 16 ||
+        h.bitCount == 24 || h.bitCount == 32 || (h.bitCount == 0 && (h.compression == 4 || h.compression == 5));
+    if (!validDepth) {
+        error = "недопустимая глубина цвета " + std::to_string(h.bitCount);
+        return false;
+    }
+
+    h.rowBytes = (uint64_t(h.width) * h.bitCount + 7) / 8;
+    h.rowStride = (uint64_t(h.width) * h.bitCount + 31) / 32 * 4;
+    if (h.uncompressed()) {
+        h.pixelBytes = h.rowStride * uint64_t(h.height);
+    }
+    else {
+        // RLE, JPEG и PNG: размер сжатых данных задан полем biSizeImage
+        h.pixelBytes = readLE32(dib + 20);
+    }
+
+    // V5: профиль по смещению от начала DIB-заголовка
+    if (h.dibSize >= 124 && readLE32(dib + 56) == kProfileEmbedded) {
+        h.profile.offset = kFileHeaderSize + uint64_t(readLE32(dib + 112));
+        h.profile.length = readLE32(dib + 116);
+    }
+    return true;
+}
+
+int bmpSampleChannels(const BmpHeader& h) {
+    if (h.bitCount == 8 && h.compression == 0) return 1;
+    if (h.bitCount == 24 && h.compression == 0) return 3;
+    if (h.bitCount == 32) {
+        if (h.compression == 0) return 3;
+        // Маски BGRX/BGRA: байты каналов на своих местах
+        bool standard = h.masks[0] == 0x00FF0000 && h.masks[1] == 0x0000FF00 && h.masks[2] == 0x000000FF;
+        if ((h.compression == 3 || h.compression == 6) && standard) return 3;
+    }
+    return 0;
+}
+
+SampleView bmpChannel(const BmpHeader& h, const uint8_t* data, int c) {
+    SampleView view;
+    int channels = bmpSampleChannels(h);
+    if (c < 0 || c >= channels) return view;
+    view.base = data + h.pixelOffset + c;
+    view.width = static_cast<size_t>(h.width);
+    view.height = static_cast<size_t>(h.height);
+    view.step = h.bitCount / 8;
+    view.rowStride = static_cast<size_t>(h.rowStride);
+    return view;
+}
+
+const char* bmpChannelName(const BmpHeader& h, int c) {
+    if (h.bitCount == 8) return "индекс";
+    static const char* names[] = { "B", "G", "R" };
+    return (c >= 0 && c < 3) ? names[c] : "?";
+}
@@ -0,0 +1,46 @@
+﻿#ifndef BMP_STRUCTURE_H
+#define BMP_STRUCTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "byte_ranges.h"
+#include "pixel_statistics.h"
+
+// Заголовки BMP: BITMAPFILEHEADER и DIB-заголовок любой версии
+// (BITMAPCOREHEADER, BITMAPINFOHEADER, V2–V5)
+struct BmpHeader {
+    uint32_t declaredFileSize = 0;   // поле bfSize
+    uint32_t pixelOffset = 0;        // поле bfOffBits
+    uint32_t dibSize = 0;
+    int64_t width = 0;
+    int64_t height = 0;              // модуль высоты
+    bool topDown = false;            // отрицательная высота в заголовке
+    uint16_t bitCount = 0;
+    uint32_t compression = 0;        // BI_RGB, BI_RLE8, BI_BITFIELDS, ...
+    uint32_t masks[4] = {};          // R, G, B, A для BI_BITFIELDS
+    uint64_t paletteEntries = 0;
+    uint64_t headerEnd = 0;          // конец заголовков, масок и палитры
+    uint64_t rowBytes = 0;           // значащие байты строки
+    uint64_t rowStride = 0;          // строка с выравниванием до 4 байт
+    uint64_t pixelBytes = 0;         // ожидаемый размер массива пикселей
+    ByteRange profile;               // встроенный ICC-профиль V5 (length 0 — нет)
+
+    bool uncompressed() const { return compression == 0 || compression == 3 || compression == 6; }
+    const char* headerName() const;
+};
+
+// false и текст ошибки, если заголовки повреждены или геометрия невозможна
+bool parseBmpHeader(const uint8_t* data, size_t size, BmpHeader& header, std::string& error);
+
+// Число каналов, которые можно анализировать прямо в массиве пикселей
+// (индексы палитры 8 бит, BGR 24 бита, BGRX/BGRA 32 бита со стандартными
+// масками); 0 — раскладка не поддерживается
+int bmpSampleChannels(const BmpHeader& header);
+
+// Канал c массива пикселей без копирования; массив должен целиком лежать
+// в data. Строки идут в порядке файла — в порядке последовательного встраивания
+SampleView bmpChannel(const BmpHeader& header, const uint8_t* data, int c);
+const char* bmpChannelName(const BmpHeader& header, int c);
+
+#endif // BMP_STRUCTURE_H
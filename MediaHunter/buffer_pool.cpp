@@ -0,0 +1,181 @@
+﻿#include "buffer_pool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#endif
+
+namespace {
+
+// Класс 0 — блоки до 64 КБ, далее по четыре класса на удвоение до kMaxCachedBlock
+constexpr size_t kClassCount = 41;
+
+size_t floorLog2(size_t value) {
+    size_t log = 0;
+    while (value >>= 1) log++;
+    return log;
+}
+
+// Размер блока для запроса: для size из (p, 2p] шаг округления p / 4
+size_t roundCapacity(size_t size) {
+    if (size <= BufferPool::kMinimumClass) return size;
+    size_t step = (size_t(1) << floorLog2(size - 1)) / 4;
+    if (size > SIZE_MAX - step) return size;
+    return (size + step - 1) / step * step;
+}
+
+// Номер класса; kClassCount — блок не кэшируется
+size_t classIndex(size_t capacity) {
+    if (capacity < BufferPool::kMinimumClass || capacity > BufferPool::kMaxCachedBlock) return kClassCount;
+    if (capacity == BufferPool::kMinimumClass) return 0;
+    size_t power = size_t(1) << floorLog2(capacity - 1);
+    size_t step = power / 4;
+    if (capacity % step != 0) return kClassCount;
+    return 1 + (floorLog2(power) - floorLog2(BufferPool::kMinimumClass)) * 4 + (capacity / step - 5);
+}
+
+uint8_t* mapLarge(size_t size) {
+#ifdef _WIN32
+    // Большие страницы доступны только с правом SeLockMemoryPrivilege,
+    // без него остаются обычные
+    static const size_t largePage = GetLargePageMinimum();
+    if (largePage && size % largePage == 0) {
+        void* block = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (block) return static_cast<uint8_t*>(block);
+    }
+    return static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#else
+    // Отображение с запасом, чтобы начало блока пришлось на границу 2 МБ
+    // и ядро могло подставить прозрачные большие страницы
+    const size_t align = BufferPool::kLargeBlock;
+    void* raw = mmap(nullptr, size + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + align - 1) & ~(uintptr_t(align) - 1);
+    if (aligned > start) munmap(raw, aligned - start);
+    size_t tail = start + align - aligned;
+    if (tail) munmap(reinterpret_cast<void*>(aligned + size), tail);
+#  ifdef MADV_HUGEPAGE
+    madvise(reinterpret_cast<void*>(aligned), size, MADV_HUGEPAGE);
+#  endif
+    return reinterpret_cast<uint8_t*>(aligned);
+#endif
+}
+
+uint8_t* allocateBlock(size_t capacity) {
+    if (capacity >= BufferPool::kLargeBlock) return mapLarge(capacity);
+    return static_cast<uint8_t*>(std::malloc(capacity ? capacity : 1));
+}
+
+void freeBlock(uint8_t* block, size_t capacity) {
+    if (capacity >= BufferPool::kLargeBlock) {
+#ifdef _WIN32
+        VirtualFree(block, 0, MEM_RELEASE);
+#else
+        munmap(block, capacity);
+#endif
+        return;
+    }
+    std::free(block);
+}
+
+struct ThreadCache {
+    struct Slot {
+        uint8_t* block;
+        size_t capacity;
+    };
+    Slot slots[kClassCount][BufferPool::kSlotsPerClass] = {};
+    size_t counts[kClassCount] = {};
+    size_t cachedBytes = 0;
+
+    ~ThreadCache();
+};
+
+// Блоки, освобождаемые при завершении потока после уничтожения его кэша,
+// сразу возвращаются системе
+thread_local bool cacheDestroyed = false;
+thread_local ThreadCache cache;
+
+ThreadCache::~ThreadCache() {
+    cacheDestroyed = true;
+    for (size_t index = 0; index < kClassCount; ++index) {
+        for (size_t i = 0; i < counts[index]; ++i) freeBlock(slots[index][i].block, slots[index][i].capacity);
+    }
+}
+
+} // namespace
+
+uint8_t* BufferPool::allocate(size_t size, size_t& capacity) {
+    capacity = roundCapacity(size);
+    size_t index = classIndex(capacity);
+    if (index < kClassCount && !cacheDestroyed && cache.counts[index] > 0) {
+        cache.cachedBytes -= capacity;
+        return cache.slots[index][--cache.counts[index]].block;
+    }
+    return allocateBlock(capacity);
+}
+
+void BufferPool::release(uint8_t* block, size_t capacity) {
+    if (!block) return;
+    size_t index = classIndex(capacity);
+    if (index < kClassCount && !cacheDestroyed && cache.counts[index] < kSlotsPerClass &&
+        cache.cachedBytes + capacity <= kMaxCachedBytes) {
+        cache.slots[index][cache.counts[index]++] = { block, capacity };
+        cache.cachedBytes += capacity;
+        return;
+    }
+    freeBlock(block, capacity);
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)),
+      capacity_(std::exchange(other.capacity_, 0)) {
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+        reset();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        capacity_ = std::exchange(other.capacity_, 0);
+    }
+    return *this;
+}
+
+void PooledBuffer::reserve(size_t capacity) {
+    if (capacity <= capacity_) return;
+    size_t granted = 0;
+    uint8_t* grown = BufferPool::allocate(capacity, granted);
+    if (!grown) throw std::bad_alloc();
+    if (size_) std::memcpy(grown, data_, size_);
+    BufferPool::release(data_, capacity_);
+    data_ = grown;
+    capacity_ = granted;
+}
+
+void PooledBuffer::resize(size_t size) {
+    reserve(size);
+    size_ = size;
+}
+
+void PooledBuffer::append(const uint8_t* data, size_t size) {
+    if (size == 0) return;
+    if (size > capacity_ - size_) reserve(std::max(size_ + size, capacity_ + capacity_ / 2));
+    std::memcpy(data_ + size_, data, size);
+    size_ += size;
+}
+
+void PooledBuffer::reset() {
+    BufferPool::release(data_, capacity_);
+    data_ = nullptr;
+    size_ = capacity_ = 0;
+}
@@ -0,0 +1,62 @@
+﻿#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "byte_ranges.h"
+
+// Кэш крупных буферов потока: буферы чтения, окна распаковки, элементы
+// архивов и пиксели выделяются заново для каждого файла, и при пакетном
+// анализе блоки тех же размеров переиспользуются вместо повторных
+// malloc/free. Размеры округляются до классов с шагом в четверть степени
+// двойки; блоки от 2 МБ берутся отдельными отображениями, выровненными под
+// большие страницы. Каждый поток держит свой кэш, поэтому блокировок нет,
+// а блок, освобождённый в другом потоке, попадает в кэш этого потока
+class BufferPool {
+public:
+    static constexpr size_t kMinimumClass = 64 * 1024;               // меньшие блоки не кэшируются
+    static constexpr size_t kLargeBlock = 2 * 1024 * 1024;           // отсюда — отображения с большими страницами
+    static constexpr size_t kMaxCachedBlock = 64 * 1024 * 1024;
+    static constexpr size_t kMaxCachedBytes = 128 * 1024 * 1024;     // на поток
+    static constexpr size_t kSlotsPerClass = 4;
+
+    // Блок не меньше size байт; capacity — его фактический размер, который
+    // нужно передать в release. nullptr при нехватке памяти
+    static uint8_t* allocate(size_t size, size_t& capacity);
+    static void release(uint8_t* block, size_t capacity);
+};
+
+// Байтовый буфер поверх BufferPool. В отличие от std::vector, resize не
+// обнуляет новые байты; при нехватке памяти выбрасывается std::bad_alloc
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+    explicit PooledBuffer(size_t size) { resize(size); }
+    ~PooledBuffer() { reset(); }
+
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+    ByteView view() const { return ByteView(data_, size_); }
+
+    void reserve(size_t capacity);
+    void resize(size_t size);
+    void append(const uint8_t* data, size_t size);
+    void clear() { size_ = 0; }
+    // Возврат блока в пул
+    void reset();
+
+private:
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,45 @@
+﻿#include "byte_ranges.h"
+#include <algorithm>
+#include <cstdio>
+
+std::string formatHexOffset(uint64_t offset) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "0x%llX", static_cast<unsigned long long>(offset));
+    return buf;
+}
+
+std::string formatByteRange(const ByteRange& range) {
+    return formatHexOffset(range.offset) + "–" + formatHexOffset(range.end()) +
+        " (" + std::to_string(range.length) + " байт)";
+}
+
+std::vector<ByteRange> mergeRanges(std::vector<ByteRange> ranges) {
+    ranges.erase(std::remove_if(ranges.begin(), ranges.end(),
+        [](const ByteRange& r) { return r.length == 0; }), ranges.end());
+    std::sort(ranges.begin(), ranges.end(),
+        [](const ByteRange& a, const ByteRange& b) { return a.offset < b.offset; });
+
+    std::vector<ByteRange> merged;
+    for (const ByteRange& r : ranges) {
+        if (!merged.empty() && r.offset <= merged.back().end()) {
+            uint64_t end = std::max(merged.back().end(), r.end());
+            merged.back().length = end - merged.back().offset;
+        }
+        else {
+            merged.push_back(r);
+        }
+    }
+    return merged;
+}
+
+std::vector<ByteRange> uncoveredRanges(std::vector<ByteRange> covered, uint64_t total) {
+    std::vector<ByteRange> gaps;
+    uint64_t pos = 0;
+    for (const ByteRange& r : mergeRanges(std::move(covered))) {
+        if (r.offset >= total) break;
+        if (r.offset > pos) gaps.push_back({ pos, r.offset - pos });
+        pos = std::max(pos, r.end());
+    }
+    if (pos < total) gaps.push_back({ pos, total - pos });
+    return gaps;
+}
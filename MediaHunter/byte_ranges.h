@@ -0,0 +1,58 @@
+﻿#ifndef BYTE_RANGES_H
+#define BYTE_RANGES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Диапазон байтов файла [offset, offset + length)
+struct ByteRange {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+
+    uint64_t end() const { return offset + length; }
+};
+
+// Непрерывный участок байтов без владения: файл целиком, его отображение
+// или вырезанная из него часть. Вектор, из которого построен вид, должен
+// пережить его
+class ByteView {
+public:
+    ByteView() = default;
+    ByteView(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+    ByteView(const std::vector<uint8_t>& buffer) : data_(buffer.data()), size_(buffer.size()) {}
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const uint8_t& operator[](size_t index) const { return data_[index]; }
+    const uint8_t* begin() const { return data_; }
+    const uint8_t* end() const { return data_ + size_; }
+
+    // Часть вида; диапазон обрезается по его границам
+    ByteView subview(const ByteRange& range) const {
+        if (range.offset >= size_) return ByteView(data_ + size_, 0);
+        uint64_t length = range.length < size_ - range.offset ? range.length : size_ - range.offset;
+        return ByteView(data_ + range.offset, static_cast<size_t>(length));
+    }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Объединение пересекающихся и смежных диапазонов, результат упорядочен
+// по смещению. Сортировка — O(n log n), пустые диапазоны отбрасываются
+std::vector<ByteRange> mergeRanges(std::vector<ByteRange> ranges);
+
+// Участки [0, total), не покрытые ни одним из диапазонов
+std::vector<ByteRange> uncoveredRanges(std::vector<ByteRange> covered, uint64_t total);
+
+// "0x3A000"
+std::string formatHexOffset(uint64_t offset);
+
+// "0x3A000–0x91000 (356352 байт)"
+std::string formatByteRange(const ByteRange& range);
+
+#endif // BYTE_RANGES_H
@@ -0,0 +1,220 @@
+﻿#include "byte_search.h"
+#include "cpu_features.h"
+#include <cstring>
+
+#if defined(MH_X86)
+#  include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+namespace {
+
+using SyncKernel = size_t (*)(const uint8_t* data, size_t size);
+using PairKernel = size_t (*)(const uint8_t* data, size_t size, const BytePairSet& pairs);
+using NonZeroKernel = size_t (*)(const uint8_t* data, size_t size);
+
+inline unsigned lowestSetBit(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// Скалярная версия: байты 0xFF ищет memchr, который в стандартных
+// библиотеках уже векторизован
+size_t findSyncScalar(const uint8_t* data, size_t size) {
+    size_t i = 0;
+    while (i + 1 < size) {
+        const void* hit = std::memchr(data + i, 0xFF, size - 1 - i);
+        if (!hit) break;
+        i = static_cast<size_t>(static_cast<const uint8_t*>(hit) - data);
+        if ((data[i + 1] & 0xE0) == 0xE0) return i;
+        ++i;
+    }
+    return size;
+}
+
+// Скалярная версия поиска пар: первый байт каждой пары ищет memchr,
+// ближайшее совпадение второго байта определяет результат
+size_t findPairScalar(const uint8_t* data, size_t size, const BytePairSet& pairs) {
+    if (size < 2) return size;
+    size_t best = size;
+    for (size_t k = 0; k < pairs.count; ++k) {
+        // Кандидат должен лежать левее лучшего найденного и иметь второй байт
+        const size_t limit = best < size ? best : size - 1;
+        size_t i = 0;
+        while (i < limit) {
+            const void* hit = std::memchr(data + i, pairs.first[k], limit - i);
+            if (!hit) break;
+            i = static_cast<size_t>(static_cast<const uint8_t*>(hit) - data);
+            if (data[i + 1] == pairs.second[k]) {
+                best = i;
+                break;
+            }
+            ++i;
+        }
+    }
+    return best;
+}
+
+// Скалярная версия поиска ненулевого байта: по восемь байтов за шаг
+size_t findNonZeroScalar(const uint8_t* data, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        if (word) break;
+    }
+    for (; i < size; ++i) {
+        if (data[i]) return i;
+    }
+    return size;
+}
+
+#if defined(MH_X86)
+
+// Два невыровненных чтения со сдвигом на байт: маска «байт равен 0xFF»
+// объединяется с маской «следующий байт начинается с 111»
+#define MH_DEFINE_SYNC_KERNEL(NAME, ISA, VEC, WIDTH, LOAD, AND, CMPEQ, SET1, MOVEMASK) \
+MH_TARGET(ISA)                                                                      \
+size_t NAME(const uint8_t* data, size_t size) {                                     \
+    const VEC ff = SET1(static_cast<char>(0xFF));                                   \
+    const VEC e0 = SET1(static_cast<char>(0xE0));                                   \
+    size_t i = 0;                                                                   \
+    for (; i + (WIDTH) + 1 <= size; i += (WIDTH)) {                                 \
+        VEC current = LOAD(data + i);                                               \
+        VEC next = LOAD(data + i + 1);                                              \
+        VEC hits = AND(CMPEQ(current, ff), CMPEQ(AND(next, e0), e0));               \
+        uint32_t mask = static_cast<uint32_t>(MOVEMASK(hits));                      \
+        if (mask) return i + lowestSetBit(mask);                                    \
+    }                                                                               \
+    size_t tail = findSyncScalar(data + i, size - i);                               \
+    return i + tail;                                                                \
+}
+
+MH_TARGET("sse2")
+inline __m128i loadSse2(const uint8_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+MH_DEFINE_SYNC_KERNEL(findSyncSse2, "sse2", __m128i, 16, loadSse2, _mm_and_si128, _mm_cmpeq_epi8,
+    _mm_set1_epi8, _mm_movemask_epi8)
+
+MH_TARGET("avx2")
+inline __m256i loadAvx2(const uint8_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+MH_DEFINE_SYNC_KERNEL(findSyncAvx2, "avx2", __m256i, 32, loadAvx2, _mm256_and_si256, _mm256_cmpeq_epi8,
+    _mm256_set1_epi8, _mm256_movemask_epi8)
+
+#undef MH_DEFINE_SYNC_KERNEL
+
+// Поиск пар: для каждой пары набора маска «текущий байт равен первому» и
+// «следующий байт равен второму»; маски пар объединяются
+#define MH_DEFINE_PAIR_KERNEL(NAME, ISA, VEC, WIDTH, LOAD, AND, OR, CMPEQ, SET1, SETZERO, MOVEMASK) \
+MH_TARGET(ISA)                                                                      \
+size_t NAME(const uint8_t* data, size_t size, const BytePairSet& pairs) {           \
+    VEC first[BytePairSet::kMaxPairs];                                              \
+    VEC second[BytePairSet::kMaxPairs];                                             \
+    for (size_t k = 0; k < pairs.count; ++k) {                                      \
+        first[k] = SET1(static_cast<char>(pairs.first[k]));                         \
+        second[k] = SET1(static_cast<char>(pairs.second[k]));                       \
+    }                                                                               \
+    size_t i = 0;                                                                   \
+    for (; i + (WIDTH) + 1 <= size; i += (WIDTH)) {                                 \
+        VEC current = LOAD(data + i);                                               \
+        VEC next = LOAD(data + i + 1);                                              \
+        VEC hits = SETZERO();                                                       \
+        for (size_t k = 0; k < pairs.count; ++k) {                                  \
+            hits = OR(hits, AND(CMPEQ(current, first[k]), CMPEQ(next, second[k]))); \
+        }                                                                           \
+        uint32_t mask = static_cast<uint32_t>(MOVEMASK(hits));                      \
+        if (mask) return i + lowestSetBit(mask);                                    \
+    }                                                                               \
+    return i + findPairScalar(data + i, size - i, pairs);                           \
+}
+
+MH_DEFINE_PAIR_KERNEL(findPairSse2, "sse2", __m128i, 16, loadSse2, _mm_and_si128, _mm_or_si128, _mm_cmpeq_epi8,
+    _mm_set1_epi8, _mm_setzero_si128, _mm_movemask_epi8)
+
+MH_DEFINE_PAIR_KERNEL(findPairAvx2, "avx2", __m256i, 32, loadAvx2, _mm256_and_si256, _mm256_or_si256,
+    _mm256_cmpeq_epi8, _mm256_set1_epi8, _mm256_setzero_si256, _mm256_movemask_epi8)
+
+#undef MH_DEFINE_PAIR_KERNEL
+
+// Ненулевой байт: четыре вектора объединяются по ИЛИ, и только при
+// ненулевой сумме ищется точная позиция
+#define MH_DEFINE_NONZERO_KERNEL(NAME, ISA, VEC, WIDTH, LOAD, OR, CMPEQ, SETZERO, MOVEMASK, FULL) \
+MH_TARGET(ISA)                                                                      \
+size_t NAME(const uint8_t* data, size_t size) {                                     \
+    const VEC zero = SETZERO();                                                     \
+    size_t i = 0;                                                                   \
+    for (; i + 4 * (WIDTH) <= size; i += 4 * (WIDTH)) {                             \
+        VEC any = OR(OR(LOAD(data + i), LOAD(data + i + (WIDTH))),                  \
+            OR(LOAD(data + i + 2 * (WIDTH)), LOAD(data + i + 3 * (WIDTH))));        \
+        if (static_cast<uint32_t>(MOVEMASK(CMPEQ(any, zero))) != (FULL)) break;      \
+    }                                                                               \
+    for (; i + (WIDTH) <= size; i += (WIDTH)) {                                     \
+        uint32_t mask = ~static_cast<uint32_t>(MOVEMASK(CMPEQ(LOAD(data + i), zero))) & (FULL); \
+        if (mask) return i + lowestSetBit(mask);                                    \
+    }                                                                               \
+    return i + findNonZeroScalar(data + i, size - i);                               \
+}
+
+MH_DEFINE_NONZERO_KERNEL(findNonZeroSse2, "sse2", __m128i, 16, loadSse2, _mm_or_si128, _mm_cmpeq_epi8,
+    _mm_setzero_si128, _mm_movemask_epi8, 0xFFFFu)
+
+MH_DEFINE_NONZERO_KERNEL(findNonZeroAvx2, "avx2", __m256i, 32, loadAvx2, _mm256_or_si256, _mm256_cmpeq_epi8,
+    _mm256_setzero_si256, _mm256_movemask_epi8, 0xFFFFFFFFu)
+
+#undef MH_DEFINE_NONZERO_KERNEL
+
+#endif // MH_X86
+
+struct KernelChoice {
+    SyncKernel sync;
+    PairKernel pairs;
+    NonZeroKernel nonZero;
+    const char* name;
+};
+
+KernelChoice selectKernel() {
+#if defined(MH_X86)
+    const CpuFeatures& cpu = cpuFeatures();
+    if (cpu.avx2) return { findSyncAvx2, findPairAvx2, findNonZeroAvx2, "AVX2" };
+    if (cpu.sse2) return { findSyncSse2, findPairSse2, findNonZeroSse2, "SSE2" };
+#endif
+    return { findSyncScalar, findPairScalar, findNonZeroScalar, "scalar" };
+}
+
+const KernelChoice& kernel() {
+    static const KernelChoice choice = selectKernel();
+    return choice;
+}
+
+} // namespace
+
+size_t findSyncWord(const uint8_t* data, size_t size) {
+    if (!data || size < 2) return size;
+    return kernel().sync(data, size);
+}
+
+size_t findAnyBytePair(const uint8_t* data, size_t size, const BytePairSet& pairs) {
+    if (!data || size < 2 || pairs.count == 0 || pairs.count > BytePairSet::kMaxPairs) return size;
+    return kernel().pairs(data, size, pairs);
+}
+
+size_t findNonZeroByte(const uint8_t* data, size_t size) {
+    if (!data || size == 0) return size;
+    return kernel().nonZero(data, size);
+}
+
+const char* byteSearchKernelName() {
+    return kernel().name;
+}
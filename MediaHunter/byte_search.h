@@ -0,0 +1,33 @@
+﻿#ifndef BYTE_SEARCH_H
+#define BYTE_SEARCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Позиция первого кандидата в синхрослово MPEG-аудио (11 единичных битов:
+// байт 0xFF, за которым следует байт со старшими битами 111) или size, если
+// кандидатов нет. Кандидат не проверяется как заголовок кадра.
+// Реализация (SSE2 / AVX2 / скалярная) выбирается при первом вызове
+size_t findSyncWord(const uint8_t* data, size_t size);
+
+// Набор двухбайтовых префиксов сигнатур (не более kMaxPairs) для поиска
+// кандидатов сразу по всем сигнатурам за один проход
+struct BytePairSet {
+    static constexpr size_t kMaxPairs = 8;
+    uint8_t first[kMaxPairs] = {};
+    uint8_t second[kMaxPairs] = {};
+    size_t count = 0;
+};
+
+// Позиция первой пары байтов из набора или size, если совпадений нет.
+// Используется та же реализация (SSE2 / AVX2 / скалярная), что и для синхрослова
+size_t findAnyBytePair(const uint8_t* data, size_t size, const BytePairSet& pairs);
+
+// Позиция первого ненулевого байта или size, если участок заполнен нулями.
+// Используется та же реализация (SSE2 / AVX2 / скалярная)
+size_t findNonZeroByte(const uint8_t* data, size_t size);
+
+// Название выбранной реализации (для отчёта)
+const char* byteSearchKernelName();
+
+#endif // BYTE_SEARCH_H
@@ -0,0 +1,32 @@
+﻿#include "chunk_source.h"
+#include "random_access_file.h"
+#include <algorithm>
+
+ChunkSource::ChunkSource(const RandomAccessFile& file, uint64_t base, uint64_t size, size_t chunkSize)
+    : file_(&file), base_(base), size_(size), chunkSize_(std::max<size_t>(chunkSize, 1)),
+      buffer_(std::max<size_t>(chunkSize, 1)) {
+}
+
+ChunkSource::ChunkSource(ByteView data, size_t chunkSize)
+    : data_(data), size_(data.size()), chunkSize_(std::max<size_t>(chunkSize, 1)) {
+}
+
+bool ChunkSource::forEachChunk(const ByteRange& range, const Visitor& visit) {
+    uint64_t offset = std::min(range.offset, size_);
+    const uint64_t end = offset + std::min(range.length, size_ - offset);
+    while (offset < end) {
+        size_t length = static_cast<size_t>(std::min<uint64_t>(chunkSize_, end - offset));
+        ByteView chunk;
+        if (file_) {
+            size_t got = file_->readAt(base_ + offset, buffer_.data(), length);
+            if (got < length) return false;
+            chunk = ByteView(buffer_.data(), length);
+        }
+        else {
+            chunk = ByteView(data_.data() + offset, length);
+        }
+        if (!visit(offset, chunk)) return false;
+        offset += length;
+    }
+    return true;
+}
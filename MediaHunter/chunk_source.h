@@ -0,0 +1,48 @@
+﻿#ifndef CHUNK_SOURCE_H
+#define CHUNK_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "buffer_pool.h"
+#include "byte_ranges.h"
+
+class RandomAccessFile;
+
+// Источник данных для проходов по всем байтам (LSB, энтропия): участок
+// файла читается через pread в один переиспользуемый буфер фиксированного
+// размера, участок памяти отдаётся видами без копирования. Память прохода
+// не зависит от размера файла, а страницы отображения проходом не
+// затрагиваются
+class ChunkSource {
+public:
+    static constexpr size_t kDefaultChunkSize = 1024 * 1024;
+
+    // Участок [base, base + size) файла
+    ChunkSource(const RandomAccessFile& file, uint64_t base, uint64_t size, size_t chunkSize = kDefaultChunkSize);
+    // Данные в памяти: элемент архива, вырезанный участок
+    explicit ChunkSource(ByteView data, size_t chunkSize = kDefaultChunkSize);
+
+    ChunkSource(const ChunkSource&) = delete;
+    ChunkSource& operator=(const ChunkSource&) = delete;
+
+    uint64_t size() const { return size_; }
+    size_t chunkSize() const { return chunkSize_; }
+
+    // Последовательный обход range порциями не длиннее chunkSize; вид
+    // действителен только внутри вызова visit. false — visit остановил
+    // обход или файл оказался короче ожидаемого
+    using Visitor = std::function<bool(uint64_t offset, ByteView chunk)>;
+    bool forEachChunk(const ByteRange& range, const Visitor& visit);
+    bool forEachChunk(const Visitor& visit) { return forEachChunk({ 0, size_ }, visit); }
+
+private:
+    const RandomAccessFile* file_ = nullptr;
+    uint64_t base_ = 0;
+    ByteView data_;
+    uint64_t size_ = 0;
+    size_t chunkSize_;
+    PooledBuffer buffer_;   // только для чтения из файла
+};
+
+#endif // CHUNK_SOURCE_H
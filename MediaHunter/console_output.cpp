@@ -0,0 +1,20 @@
+﻿#include "console_output.h"
+#include <iostream>
+
+namespace {
+
+thread_local std::ostream* consoleOverride = nullptr;
+
+} // namespace
+
+std::ostream& console() {
+    return consoleOverride ? *consoleOverride : std::cout;
+}
+
+ConsoleCapture::ConsoleCapture() : previous_(consoleOverride) {
+    consoleOverride = &stream_;
+}
+
+ConsoleCapture::~ConsoleCapture() {
+    consoleOverride = previous_;
+}
@@ -0,0 +1,29 @@
+﻿#ifndef CONSOLE_OUTPUT_H
+#define CONSOLE_OUTPUT_H
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+// Консольный вывод модулей анализа. Задание, которое выполняется в пуле
+// параллельно с другими, перехватывает вывод своего потока через
+// ConsoleCapture, а запустивший его поток печатает собранный текст целиком,
+// чтобы строки параллельных заданий не перемешивались
+std::ostream& console();
+
+class ConsoleCapture {
+public:
+    ConsoleCapture();
+    ~ConsoleCapture();
+
+    ConsoleCapture(const ConsoleCapture&) = delete;
+    ConsoleCapture& operator=(const ConsoleCapture&) = delete;
+
+    std::string text() const { return stream_.str(); }
+
+private:
+    std::ostringstream stream_;
+    std::ostream* previous_;
+};
+
+#endif // CONSOLE_OUTPUT_H
@@ -0,0 +1,72 @@
+﻿#include "cpu_features.h"
+
+#if defined(MH_X86)
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#  endif
+#endif
+
+namespace {
+
+#if defined(MH_X86)
+void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned int>(r[i]);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+unsigned long long xgetbv0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax = 0, edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+CpuFeatures detect() {
+    CpuFeatures f;
+#if defined(MH_X86)
+    unsigned int r[4] = {};
+    cpuid(0, 0, r);
+    unsigned int maxLeaf = r[0];
+    if (maxLeaf < 1) return f;
+
+    cpuid(1, 0, r);
+    f.sse2 = (r[3] & (1u << 26)) != 0;
+    f.sse41 = (r[2] & (1u << 19)) != 0;
+    f.popcnt = (r[2] & (1u << 23)) != 0;
+    f.pclmul = (r[2] & (1u << 1)) != 0;
+    bool osxsave = (r[2] & (1u << 27)) != 0;
+    bool avx = (r[2] & (1u << 28)) != 0;
+
+    // ОС должна сохранять регистры YMM/ZMM при переключении контекста
+    unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+    bool ymmEnabled = (xcr0 & 0x6) == 0x6;
+    bool zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+
+    if (maxLeaf >= 7) {
+        cpuid(7, 0, r);
+        f.avx2 = avx && ymmEnabled && (r[1] & (1u << 5)) != 0;
+        bool avx512f = (r[1] & (1u << 16)) != 0;
+        bool avx512bw = (r[1] & (1u << 30)) != 0;
+        f.avx512bw = zmmEnabled && avx512f && avx512bw;
+    }
+#endif
+    return f;
+}
+
+} // namespace
+
+const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = detect();
+    return features;
+}
@@ -0,0 +1,33 @@
+﻿#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+// Определение возможностей процессора для выбора SIMD-ядер во время выполнения
+
+#if defined(_M_X64) || defined(__x86_64__)
+#  define MH_X86 1
+#  define MH_X64 1
+#elif defined(_M_IX86) || defined(__i386__)
+#  define MH_X86 1
+#endif
+
+// GCC/Clang требуют явного разрешения набора инструкций для отдельной функции,
+// MSVC позволяет использовать интринсики без дополнительных атрибутов
+#if defined(__GNUC__) || defined(__clang__)
+#  define MH_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define MH_TARGET(isa)
+#endif
+
+struct CpuFeatures {
+    bool sse2 = false;
+    bool sse41 = false;
+    bool popcnt = false;
+    bool pclmul = false;
+    bool avx2 = false;
+    bool avx512bw = false;
+};
+
+// Результат определяется один раз при первом обращении
+const CpuFeatures& cpuFeatures();
+
+#endif // CPU_FEATURES_H
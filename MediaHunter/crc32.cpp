@@ -0,0 +1,165 @@
+﻿#include "crc32.h"
+#include "cpu_features.h"
+#include <array>
+
+#if defined(MH_X86)
+#  include <immintrin.h>
+#endif
+
+namespace {
+
+using CrcTables = std::array<std::array<uint32_t, 256>, 8>;
+
+// Таблица k содержит CRC байта, за которым следуют k нулевых байтов
+constexpr CrcTables makeCrcTables() {
+    CrcTables t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        t[0][i] = c;
+    }
+    for (int k = 1; k < 8; ++k) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+        }
+    }
+    return t;
+}
+
+constexpr CrcTables kCrcTables = makeCrcTables();
+
+inline uint32_t loadLe32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+        (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Slicing-by-8: восемь независимых обращений к таблицам на 8 байтов.
+// crc — внутреннее (инвертированное) состояние
+uint32_t crcTables(const uint8_t* data, size_t size, uint32_t crc) {
+    const auto& t = kCrcTables;
+    while (size >= 8) {
+        uint32_t lo = crc ^ loadLe32(data);
+        uint32_t hi = loadLe32(data + 4);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+            t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while (size--) {
+        crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+using CrcKernel = uint32_t (*)(const uint8_t* data, size_t size, uint32_t crc);
+
+#if defined(MH_X86)
+
+// Свёртка без переносов (Gopal et al., "Fast CRC Computation for Generic
+// Polynomials Using PCLMULQDQ Instruction"): четыре 128-битных аккумулятора
+// сворачиваются через 64 байта, затем в один, затем редукция Барретта до
+// 32 бит. Константы — для отражённого полинома CRC-32.
+MH_TARGET("pclmul,sse4.1")
+uint32_t crcFold(const uint8_t* data, size_t size, uint32_t crc) {
+    if (size < 64) return crcTables(data, size, crc);
+
+    alignas(16) static const uint64_t k1k2[2] = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+    alignas(16) static const uint64_t k3k4[2] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+    alignas(16) static const uint64_t k5k0[2] = { 0x0163cd6124ULL, 0 };
+    alignas(16) static const uint64_t poly[2] = { 0x01db710641ULL, 0x01f7011641ULL };
+
+    const size_t folded = size & ~static_cast<size_t>(15);
+    const uint8_t* p = data;
+    size_t len = folded;
+
+    __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+    __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+    __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+    p += 64;
+    len -= 64;
+
+    while (len >= 64) {
+        __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+        __m128i x6 = _mm_clmulepi64_si128(x2, k, 0x00);
+        __m128i x7 = _mm_clmulepi64_si128(x3, k, 0x00);
+        __m128i x8 = _mm_clmulepi64_si128(x4, k, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48)));
+        p += 64;
+        len -= 64;
+    }
+
+    // Четыре аккумулятора — в один
+    k = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+    const __m128i rest[3] = { x2, x3, x4 };
+    for (const __m128i& next : rest) {
+        __m128i lo = _mm_clmulepi64_si128(x1, k, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, next), lo);
+    }
+    while (len >= 16) {
+        __m128i lo = _mm_clmulepi64_si128(x1, k, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))), lo);
+        p += 16;
+        len -= 16;
+    }
+
+    // 128 -> 64 бита
+    __m128i mask32 = _mm_setr_epi32(-1, 0, -1, 0);
+    __m128i x = _mm_clmulepi64_si128(x1, k, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x);
+    k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+    x = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x00);
+    x1 = _mm_xor_si128(x1, x);
+
+    // Редукция Барретта до 32 бит
+    k = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+    x = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x10);
+    x = _mm_clmulepi64_si128(_mm_and_si128(x, mask32), k, 0x00);
+    x1 = _mm_xor_si128(x1, x);
+    crc = static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+
+    return crcTables(data + folded, size - folded, crc);
+}
+
+#endif // MH_X86
+
+struct KernelChoice {
+    CrcKernel fn;
+    const char* name;
+};
+
+KernelChoice selectKernel() {
+#if defined(MH_X86)
+    const CpuFeatures& cpu = cpuFeatures();
+    if (cpu.pclmul && cpu.sse41) return { crcFold, "PCLMULQDQ" };
+#endif
+    return { crcTables, "slicing-by-8" };
+}
+
+const KernelChoice& kernel() {
+    static const KernelChoice choice = selectKernel();
+    return choice;
+}
+
+} // namespace
+
+uint32_t computeCrc32(const uint8_t* data, size_t size, uint32_t crc) {
+    if (!data || size == 0) return crc;
+    return ~kernel().fn(data, size, ~crc);
+}
+
+const char* crc32KernelName() {
+    return kernel().name;
+}
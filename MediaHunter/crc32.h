@@ -0,0 +1,15 @@
+﻿#ifndef CRC32_H
+#define CRC32_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (полином 0xEDB88320, как в PNG, ZIP и gzip). Для подсчёта по частям
+// передаётся результат предыдущей части. Реализация (PCLMULQDQ-свёртка или
+// таблицы slicing-by-8) выбирается при первом вызове.
+uint32_t computeCrc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+// Название выбранной реализации (для отчёта)
+const char* crc32KernelName();
+
+#endif // CRC32_H
@@ -0,0 +1,292 @@
+﻿#include "ebml_structure.h"
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+enum : uint32_t {
+    kIdEbml = 0x1A45DFA3,
+    kIdDocType = 0x4282,
+    kIdDocTypeVersion = 0x4287,
+    kIdSegment = 0x18538067,
+    kIdSeekHead = 0x114D9B74,
+    kIdInfo = 0x1549A966,
+    kIdTracks = 0x1654AE6B,
+    kIdCluster = 0x1F43B675,
+    kIdCues = 0x1C53BB6B,
+    kIdAttachments = 0x1941A469,
+    kIdChapters = 0x1043A770,
+    kIdTags = 0x1254C367,
+    kIdVoid = 0xEC,
+    kIdCrc32 = 0xBF,
+    kIdAttachedFile = 0x61A7,
+    kIdFileDescription = 0x467E,
+    kIdFileName = 0x466E,
+    kIdFileMimeType = 0x4660,
+    kIdFileData = 0x465C,
+    kIdTag = 0x7373,
+    kIdTargets = 0x63C0,
+    kIdSimpleTag = 0x67C8,
+    kIdTagName = 0x45A3,
+    kIdTagString = 0x4487,
+    kIdTagBinary = 0x4485
+};
+
+// Допустимые дочерние элементы заголовка EBML, сегмента, вложений и тегов
+const uint32_t kHeaderChildren[] = { 0x4286, 0x42F7, 0x42F2, 0x42F3, kIdDocType, kIdDocTypeVersion, 0x4285, 0x4281 };
+const uint32_t kSegmentChildren[] = { kIdSeekHead, kIdInfo, kIdTracks, kIdCluster, kIdCues, kIdAttachments,
+    kIdChapters, kIdTags };
+const uint32_t kAttachedFileChildren[] = { kIdFileDescription, kIdFileName, kIdFileMimeType, kIdFileData,
+    0x46AE, 0x4675, 0x4661, 0x4662 };
+const uint32_t kTagChildren[] = { kIdTargets, kIdSimpleTag };
+const uint32_t kSimpleTagChildren[] = { kIdTagName, 0x447A, 0x447B, 0x4484, 0x44B4, kIdTagString, kIdTagBinary,
+    kIdSimpleTag };
+
+// Глубина вложенных SimpleTag
+const int kMaxTagDepth = 16;
+// Строковые значения (имена, типы MIME) обрезаются до этой длины
+const size_t kMaxString = 256;
+
+template <size_t N>
+bool contains(const uint32_t (&ids)[N], uint32_t id) {
+    return std::find(std::begin(ids), std::end(ids), id) != std::end(ids);
+}
+
+int vintLength(uint8_t first) {
+    int length = 1;
+    for (uint8_t mask = 0x80; mask && !(first & mask); mask >>= 1) length++;
+    return length;
+}
+
+class EbmlWalker {
+public:
+    EbmlWalker(const uint8_t* data, size_t size, EbmlStructure& ebml)
+        : data_(data), size_(size), ebml_(ebml) {}
+
+    // Заголовок элемента в [pos, end). Неизвестный размер заменяется остатком
+    // родителя, выход данных за end проверяет вызывающий
+    bool readElement(uint64_t pos, uint64_t end, EbmlElement& e) const {
+        if (pos >= end) return false;
+        int idLength = vintLength(data_[pos]);
+        if (idLength > 4 || end - pos < static_cast<uint64_t>(idLength) + 1) return false;
+        uint32_t id = 0;
+        for (int i = 0; i < idLength; ++i) id = (id << 8) | data_[pos + i];
+
+        uint64_t sizePos = pos + idLength;
+        int sizeLength = vintLength(data_[sizePos]);
+        if (sizeLength > 8 || end - sizePos < static_cast<uint64_t>(sizeLength)) return false;
+        uint64_t value = data_[sizePos] & (0xFF >> sizeLength);
+        bool allOnes = value == (0xFFu >> sizeLength);
+        for (int i = 1; i < sizeLength; ++i) {
+            value = (value << 8) | data_[sizePos + i];
+            allOnes = allOnes && data_[sizePos + i] == 0xFF;
+        }
+
+        e.id = id;
+        e.offset = pos;
+        e.dataOffset = sizePos + sizeLength;
+        e.unknownSize = allOnes;
+        e.size = allOnes ? end - e.dataOffset : value;
+        return true;
+    }
+
+    void walkTopLevel() {
+        uint64_t pos = 0;
+        EbmlElement e;
+        while (readElement(pos, size_, e)) {
+            if (e.id == kIdEbml) {
+                if (!fits(e, size_)) break;
+                forEachChild(e, [&](const EbmlElement& child) {
+                    if (child.id == kIdDocType) ebml_.docType = readString(child);
+                    else if (child.id == kIdDocTypeVersion) ebml_.docTypeVersion = readUnsigned(child);
+                    else if (child.id != kIdVoid && child.id != kIdCrc32 && !contains(kHeaderChildren, child.id)) {
+                        ebml_.unknownElements.push_back(child);
+                    }
+                });
+                pos = e.end();
+            }
+            else if (e.id == kIdSegment) {
+                ebml_.segments++;
+                fits(e, size_);
+                pos = walkSegment(e);
+            }
+            else {
+                break;                      // на верхнем уровне допустимы только EBML и Segment
+            }
+            ebml_.streamEnd = pos;
+        }
+    }
+
+private:
+    // Данные элемента внутри родителя; обрезанный элемент укорачивается
+    bool fits(EbmlElement& e, uint64_t end) {
+        if (e.size <= end - e.dataOffset) return true;
+        if (end == size_) ebml_.truncated = true;
+        else ebml_.malformed++;
+        e.size = end - e.dataOffset;
+        return end == size_;
+    }
+
+    // Возвращает позицию, на которой закончился сегмент
+    uint64_t walkSegment(const EbmlElement& segment) {
+        uint64_t pos = segment.dataOffset;
+        const uint64_t end = segment.end();
+        EbmlElement e;
+        while (pos < end) {
+            if (!readElement(pos, end, e)) {
+                if (segment.unknownSize) return pos;    // дальше данные вне потока
+                ebml_.malformed++;
+                return end;
+            }
+            // Сегмент неизвестного размера заканчивается следующим заголовком EBML
+            if (segment.unknownSize && (e.id == kIdEbml || e.id == kIdSegment)) return pos;
+            if (e.unknownSize) {
+                if (e.id != kIdCluster) {
+                    ebml_.malformed++;
+                    return segment.unknownSize ? pos : end;
+                }
+                e.size = clusterEnd(e.dataOffset, end) - e.dataOffset;
+            }
+            else if (!fits(e, end)) {
+                return end;
+            }
+
+            switch (e.id) {
+            case kIdCluster:
+                ebml_.clusters++;
+                if (!ebml_.clusterRanges.empty() && ebml_.clusterRanges.back().end() == e.offset) {
+                    ebml_.clusterRanges.back().length = e.end() - ebml_.clusterRanges.back().offset;
+                }
+                else {
+                    ebml_.clusterRanges.push_back({ e.offset, e.end() - e.offset });
+                }
+                break;
+            case kIdAttachments:
+                walkAttachments(e);
+                break;
+            case kIdTags:
+                walkTags(e);
+                break;
+            case kIdVoid:
+                ebml_.voids.push_back({ e.dataOffset, e.size });
+                break;
+            default:
+                if (e.id != kIdCrc32 && !contains(kSegmentChildren, e.id)) ebml_.unknownElements.push_back(e);
+                break;
+            }
+            pos = e.end();
+        }
+        return end;
+    }
+
+    // Конец кластера неизвестного размера: первый элемент уровня сегмента.
+    // Блоки пропускаются по заголовкам, их данные не читаются
+    uint64_t clusterEnd(uint64_t begin, uint64_t end) const {
+        uint64_t pos = begin;
+        EbmlElement e;
+        while (readElement(pos, end, e)) {
+            if (e.id == kIdEbml || e.id == kIdSegment || e.id == kIdCluster || contains(kSegmentChildren, e.id) ||
+                e.unknownSize || e.size > end - e.dataOffset) break;
+            pos = e.end();
+        }
+        return pos;
+    }
+
+    // Обход дочерних элементов; неверный заголовок или выход за пределы
+    // родителя прекращает обход
+    void forEachChild(const EbmlElement& parent, const std::function<void(const EbmlElement&)>& visit) {
+        uint64_t pos = parent.dataOffset;
+        const uint64_t end = parent.end();
+        EbmlElement e;
+        while (pos < end) {
+            if (!readElement(pos, end, e) || e.unknownSize || e.size > end - e.dataOffset) {
+                ebml_.malformed++;
+                return;
+            }
+            visit(e);
+            pos = e.end();
+        }
+    }
+
+    void walkAttachments(const EbmlElement& attachments) {
+        forEachChild(attachments, [&](const EbmlElement& child) {
+            if (child.id == kIdVoid) ebml_.voids.push_back({ child.dataOffset, child.size });
+            if (child.id != kIdAttachedFile) {
+                if (child.id != kIdVoid && child.id != kIdCrc32) ebml_.unknownElements.push_back(child);
+                return;
+            }
+            EbmlAttachment file;
+            forEachChild(child, [&](const EbmlElement& field) {
+                if (field.id == kIdFileName) file.name = readString(field);
+                else if (field.id == kIdFileMimeType) file.mimeType = readString(field);
+                else if (field.id == kIdFileDescription) file.description = readString(field);
+                else if (field.id == kIdFileData) file.data = { field.dataOffset, field.size };
+                else if (field.id != kIdVoid && field.id != kIdCrc32 && !contains(kAttachedFileChildren, field.id)) {
+                    ebml_.unknownElements.push_back(field);
+                }
+            });
+            ebml_.attachments.push_back(std::move(file));
+        });
+    }
+
+    void walkTags(const EbmlElement& tags) {
+        forEachChild(tags, [&](const EbmlElement& child) {
+            if (child.id == kIdVoid) ebml_.voids.push_back({ child.dataOffset, child.size });
+            if (child.id != kIdTag) {
+                if (child.id != kIdVoid && child.id != kIdCrc32) ebml_.unknownElements.push_back(child);
+                return;
+            }
+            forEachChild(child, [&](const EbmlElement& field) {
+                if (field.id == kIdSimpleTag) walkSimpleTag(field, 0);
+                else if (field.id != kIdVoid && field.id != kIdCrc32 && !contains(kTagChildren, field.id)) {
+                    ebml_.unknownElements.push_back(field);
+                }
+            });
+        });
+    }
+
+    void walkSimpleTag(const EbmlElement& simpleTag, int depth) {
+        if (depth >= kMaxTagDepth) return;
+        EbmlTag tag;
+        forEachChild(simpleTag, [&](const EbmlElement& field) {
+            if (field.id == kIdTagName) tag.name = readString(field);
+            else if (field.id == kIdTagString || field.id == kIdTagBinary) {
+                tag.value = { field.dataOffset, field.size };
+                tag.binary = field.id == kIdTagBinary;
+            }
+            else if (field.id == kIdSimpleTag) walkSimpleTag(field, depth + 1);
+            else if (field.id != kIdVoid && field.id != kIdCrc32 && !contains(kSimpleTagChildren, field.id)) {
+                ebml_.unknownElements.push_back(field);
+            }
+        });
+        if (tag.value.length > 0) ebml_.tags.push_back(std::move(tag));
+    }
+
+    std::string readString(const EbmlElement& e) const {
+        std::string s(reinterpret_cast<const char*>(data_ + e.dataOffset),
+            static_cast<size_t>(std::min<uint64_t>(e.size, kMaxString)));
+        s.erase(std::find(s.begin(), s.end(), '\0'), s.end());
+        return s;
+    }
+
+    uint64_t readUnsigned(const EbmlElement& e) const {
+        uint64_t v = 0;
+        for (uint64_t i = 0; i < std::min<uint64_t>(e.size, 8); ++i) v = (v << 8) | data_[e.dataOffset + i];
+        return v;
+    }
+
+    const uint8_t* data_;
+    uint64_t size_;
+    EbmlStructure& ebml_;
+};
+
+} // namespace
+
+bool parseEbmlStructure(const uint8_t* data, size_t size, EbmlStructure& ebml) {
+    ebml = EbmlStructure();
+    EbmlWalker walker(data, size, ebml);
+    EbmlElement header;
+    if (!walker.readElement(0, size, header) || header.id != kIdEbml) return false;
+    walker.walkTopLevel();
+    return true;
+}
@@ -0,0 +1,59 @@
+﻿#ifndef EBML_STRUCTURE_H
+#define EBML_STRUCTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "byte_ranges.h"
+
+// Элемент EBML: идентификатор с маркером длины, как в спецификации (0x1A45DFA3)
+struct EbmlElement {
+    uint32_t id = 0;
+    uint64_t offset = 0;          // начало идентификатора
+    uint64_t dataOffset = 0;      // начало данных
+    uint64_t size = 0;            // размер данных; для неизвестного размера — до конца родителя
+    bool unknownSize = false;
+
+    uint64_t end() const { return dataOffset + size; }
+};
+
+// Вложение Matroska (AttachedFile)
+struct EbmlAttachment {
+    std::string name;
+    std::string mimeType;
+    std::string description;
+    ByteRange data;               // FileData
+};
+
+// Тег (SimpleTag) с непустым значением
+struct EbmlTag {
+    std::string name;
+    ByteRange value;              // TagString или TagBinary
+    bool binary = false;
+};
+
+// Структура MKV/WebM. Кластеры пропускаются по размеру без чтения блоков;
+// разбираются заголовок EBML, вложения, теги и элементы верхних уровней
+struct EbmlStructure {
+    std::string docType;
+    uint64_t docTypeVersion = 0;
+    size_t segments = 0;
+    size_t clusters = 0;
+    std::vector<ByteRange> clusterRanges;       // кластеры целиком, смежные объединены
+    std::vector<EbmlAttachment> attachments;
+    std::vector<EbmlTag> tags;
+    std::vector<EbmlElement> unknownElements;   // неизвестные идентификаторы в сегменте, вложениях и тегах
+    std::vector<ByteRange> voids;               // данные элементов Void
+    size_t malformed = 0;                       // неверная кодировка или выход за пределы родителя
+    bool truncated = false;                     // элемент обрывается концом файла
+    uint64_t streamEnd = 0;                     // конец последнего сегмента
+};
+
+// Обход элементов по заголовкам, включая сегменты и кластеры неизвестного
+// размера (потоковая запись). Данные кластеров не читаются, поэтому разбор
+// файла, отображённого в память, затрагивает только заголовки.
+// false — файл не начинается с заголовка EBML
+bool parseEbmlStructure(const uint8_t* data, size_t size, EbmlStructure& ebml);
+
+#endif // EBML_STRUCTURE_H
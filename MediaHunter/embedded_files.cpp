@@ -0,0 +1,439 @@
+﻿#include "embedded_files.h"
+#include "byte_search.h"
+#include "crc32.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+inline uint16_t readLE16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t readLE32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline uint64_t readLE64(const uint8_t* p) {
+    return uint64_t(readLE32(p)) | (uint64_t(readLE32(p + 4)) << 32);
+}
+
+// Смещения и размеры из заголовков больше этого значения считаются повреждёнными
+const uint64_t kMaxFieldValue = 1ULL << 48;
+const size_t kMaxZipName = 1024;
+const uint32_t kMaxPeHeaderOffset = 0x10000;
+const size_t kMaxRarBlocks = 100000;
+const size_t kMaxShebangLine = 256;
+
+std::string hex(uint32_t value) {
+    std::ostringstream out;
+    out << "0x" << std::hex << std::uppercase << value;
+    return out.str();
+}
+
+// Поля ELF с порядком байтов из e_ident
+struct ElfReader {
+    bool bigEndian;
+
+    uint16_t u16(const uint8_t* p) const {
+        return bigEndian ? static_cast<uint16_t>((p[0] << 8) | p[1]) : readLE16(p);
+    }
+    uint32_t u32(const uint8_t* p) const {
+        return bigEndian ? (uint32_t(u16(p)) << 16) | u16(p + 2) : readLE32(p);
+    }
+    uint64_t u64(const uint8_t* p) const {
+        return bigEndian ? (uint64_t(u32(p)) << 32) | u32(p + 4) : readLE64(p);
+    }
+};
+
+bool validZipLocalHeader(const uint8_t* p, size_t size) {
+    static const uint16_t methods[] = { 0, 1, 6, 8, 9, 12, 14, 19, 93, 95, 98, 99 };
+    if (size < 30 || readLE32(p) != 0x04034B50) return false;
+    uint16_t method = readLE16(p + 8);
+    uint16_t nameLength = readLE16(p + 26);
+    if ((readLE16(p + 4) & 0xFF) > 63 || std::find(std::begin(methods), std::end(methods), method) == std::end(methods)) {
+        return false;
+    }
+    if (nameLength == 0 || nameLength > kMaxZipName || 30u + nameLength > size) return false;
+    return std::all_of(p + 30, p + 30 + nameLength, [](uint8_t b) { return b >= 0x20 && b != 0x7F; });
+}
+
+// Конец архива — запись EOCD, центральный каталог которой лежит внутри
+// архива; без неё архив прослеживается по локальным заголовкам
+bool carveZip(const uint8_t* p, size_t size, EmbeddedFile& file) {
+    if (!validZipLocalHeader(p, size)) return false;
+    file.type = "ZIP";
+
+    static const uint8_t eocd[] = { 'P', 'K', 5, 6 };
+    const uint8_t* end = p + size;
+    for (const uint8_t* pos = std::search(p, end, eocd, eocd + 4); pos != end; pos = std::search(pos + 1, end, eocd, eocd + 4)) {
+        size_t at = static_cast<size_t>(pos - p);
+        if (size - at < 22) break;
+        uint16_t entries = readLE16(pos + 10);
+        uint32_t directorySize = readLE32(pos + 12);
+        uint16_t commentLength = readLE16(pos + 20);
+        bool directoryFound = directorySize == 0 ? entries == 0 :
+            directorySize <= at && readLE32(pos - directorySize) == 0x02014B50;
+        if (directoryFound && size - at - 22 >= commentLength) {
+            file.range.length = at + 22 + commentLength;
+            file.complete = true;
+            file.detail = "записей: " + std::to_string(entries);
+            return true;
+        }
+    }
+
+    uint64_t at = 0;
+    size_t entries = 0;
+    while (validZipLocalHeader(p + at, size - at)) {
+        // Размер данных в дескрипторе после них: конец записи неизвестен
+        if (readLE16(p + at + 6) & 0x08) {
+            at = size;
+            break;
+        }
+        uint64_t next = at + 30 + readLE16(p + at + 26) + readLE16(p + at + 28) + readLE32(p + at + 18);
+        if (next > size) {
+            at = size;
+            break;
+        }
+        at = next;
+        entries++;
+    }
+    file.range.length = at;
+    file.detail = "без центрального каталога, локальных записей: " + std::to_string(entries);
+    return true;
+}
+
+// Конец PE — максимум из заголовков, данных секций и таблицы сертификатов
+// (каталог 4 задан смещением в файле, а не RVA)
+bool carvePe(const uint8_t* p, size_t size, EmbeddedFile& file) {
+    if (size < 0x40) return false;
+    uint32_t peOffset = readLE32(p + 0x3C);
+    if (peOffset < 0x40 || peOffset > kMaxPeHeaderOffset || uint64_t(peOffset) + 24 > size ||
+        readLE32(p + peOffset) != 0x00004550) return false;
+
+    const uint8_t* coff = p + peOffset + 4;
+    uint16_t machine = readLE16(coff);
+    uint16_t sections = readLE16(coff + 2);
+    uint16_t optionalSize = readLE16(coff + 16);
+    uint16_t characteristics = readLE16(coff + 18);
+    uint64_t optional = uint64_t(peOffset) + 24;
+    uint64_t table = optional + optionalSize;
+    if (sections == 0 || sections > 96 || optionalSize < 2 || table + uint64_t(sections) * 40 > size) return false;
+    uint16_t magic = readLE16(p + optional);
+    if (magic != 0x10B && magic != 0x20B) return false;
+    const bool plus = magic == 0x20B;
+
+    uint64_t end = table + uint64_t(sections) * 40;
+    if (optionalSize >= 64) end = std::max<uint64_t>(end, readLE32(p + optional + 60));   // SizeOfHeaders
+    for (uint16_t s = 0; s < sections; ++s) {
+        const uint8_t* section = p + table + uint64_t(s) * 40;
+        uint32_t rawSize = readLE32(section + 16);
+        if (rawSize > 0) end = std::max(end, uint64_t(readLE32(section + 20)) + rawSize);
+    }
+    uint64_t directories = optional + (plus ? 112 : 96);
+    if (optionalSize >= directories - optional + 40 && readLE32(p + directories - 4) > 4) {
+        uint32_t certificateSize = readLE32(p + directories + 36);
+        if (certificateSize > 0) end = std::max(end, uint64_t(readLE32(p + directories + 32)) + certificateSize);
+    }
+
+    const char* arch = machine == 0x14C ? "x86" : machine == 0x8664 ? "x86-64" : machine == 0xAA64 ? "ARM64" :
+        (machine == 0x1C0 || machine == 0x1C4) ? "ARM" : nullptr;
+    file.type = "PE";
+    file.detail = std::string(plus ? "PE32+" : "PE32") + ", " + (arch ? arch : "машина " + hex(machine)) +
+        ((characteristics & 0x2000) ? ", DLL" : "");
+    file.complete = end <= size;
+    file.range.length = std::min<uint64_t>(end, size);
+    return true;
+}
+
+// Конец ELF — максимум из таблиц заголовков программы и секций и данных,
+// на которые они ссылаются (кроме SHT_NOBITS)
+bool carveElf(const uint8_t* p, size_t size, EmbeddedFile& file) {
+    if (size < 52 || std::memcmp(p, "\x7F" "ELF", 4) != 0) return false;
+    const uint8_t elfClass = p[4];
+    if ((elfClass != 1 && elfClass != 2) || (p[5] != 1 && p[5] != 2) || p[6] != 1) return false;
+    const bool is64 = elfClass == 2;
+    if (is64 && size < 64) return false;
+    const ElfReader r{ p[5] == 2 };
+
+    uint16_t type = r.u16(p + 16);
+    uint16_t machine = r.u16(p + 18);
+    if (type < 1 || type > 4 || r.u32(p + 20) != 1) return false;
+    uint64_t phoff = is64 ? r.u64(p + 32) : r.u32(p + 28);
+    uint64_t shoff = is64 ? r.u64(p + 40) : r.u32(p + 32);
+    const uint8_t* counts = p + (is64 ? 52 : 40);
+    uint16_t ehsize = r.u16(counts);
+    uint16_t phentsize = r.u16(counts + 2);
+    uint16_t phnum = r.u16(counts + 4);
+    uint16_t shentsize = r.u16(counts + 6);
+    uint16_t shnum = r.u16(counts + 8);
+    if (ehsize != (is64 ? 64 : 52) || (phnum && phentsize != (is64 ? 56 : 32)) ||
+        (shnum && shentsize != (is64 ? 64 : 40)) || phoff > kMaxFieldValue || shoff > kMaxFieldValue) return false;
+
+    uint64_t end = ehsize;
+    auto extend = [&](uint64_t offset, uint64_t length) {
+        if (offset <= kMaxFieldValue && length <= kMaxFieldValue) end = std::max(end, offset + length);
+    };
+    if (phnum) {
+        uint64_t tableEnd = phoff + uint64_t(phnum) * phentsize;
+        extend(phoff, uint64_t(phnum) * phentsize);
+        for (uint16_t i = 0; tableEnd <= size && i < phnum; ++i) {
+            const uint8_t* ph = p + phoff + uint64_t(i) * phentsize;
+            if (is64) extend(r.u64(ph + 8), r.u64(ph + 32));
+            else extend(r.u32(ph + 4), r.u32(ph + 16));
+        }
+    }
+    if (shnum) {
+        uint64_t tableEnd = shoff + uint64_t(shnum) * shentsize;
+        extend(shoff, uint64_t(shnum) * shentsize);
+        for (uint16_t i = 0; tableEnd <= size && i < shnum; ++i) {
+            const uint8_t* sh = p + shoff + uint64_t(i) * shentsize;
+            uint32_t sectionType = r.u32(sh + 4);
+            if (sectionType == 0 || sectionType == 8) continue;   // SHT_NULL, SHT_NOBITS
+            if (is64) extend(r.u64(sh + 24), r.u64(sh + 32));
+            else extend(r.u32(sh + 16), r.u32(sh + 20));
+        }
+    }
+
+    static const char* const types[] = { "", "объектный", "исполняемый", "разделяемый", "core" };
+    const char* arch = machine == 3 ? "x86" : machine == 62 ? "x86-64" : machine == 40 ? "ARM" :
+        machine == 183 ? "AArch64" : machine == 8 ? "MIPS" : machine == 243 ? "RISC-V" : nullptr;
+    file.type = "ELF";
+    file.detail = std::string(is64 ? "ELF64" : "ELF32") + ", " + types[type] + ", " +
+        (arch ? arch : "машина " + hex(machine));
+    file.complete = end <= size;
+    file.range.length = std::min<uint64_t>(end, size);
+    return true;
+}
+
+// Конец документа — последний %%EOF (инкрементальные обновления дописывают
+// новые) вместе с переводом строки
+bool carvePdf(const uint8_t* p, size_t size, EmbeddedFile& file) {
+    if (size < 8 || std::memcmp(p, "%PDF-", 5) != 0 || p[5] < '0' || p[5] > '9' || p[6] != '.' ||
+        p[7] < '0' || p[7] > '9') return false;
+    static const char marker[] = "%%EOF";
+    file.type = "PDF";
+    file.detail = "версия " + std::string(reinterpret_cast<const char*>(p + 5), 3);
+    const uint8_t* last = std::find_end(p, p + size, marker, marker + 5);
+    if (last == p + size) {
+        file.range.length = size;
+        return true;
+    }
+    size_t end = static_cast<size_t>(last - p) + 5;
+    if (end < size && p[end] == '\r') end++;
+    if (end < size && p[end] == '\n') end++;
+    file.range.length = end;
+    file.complete = true;
+    return true;
+}
+
+// Заголовок 7z: сигнатура, версия, CRC стартового заголовка, смещение и
+// размер следующего заголовка (относительно конца стартового) и его CRC
+bool carve7z(const uint8_t* p, size_t size, EmbeddedFile& file) {
+    static const uint8_t signature[] = { '7', 'z', 0xBC, 0xAF, 0x27, 0x1C };
+    if (size < 32 || std::memcmp(p, signature, 6) != 0 || p[6] != 0 || computeCrc32(p + 12, 20) != readLE32(p + 8)) {
+        return false;
+    }
+    uint64_t nextOffset = readLE64(p + 12);
+    uint64_t nextSize = readLE64(p + 20);
+    if (nextOffset > kMaxFieldValue || nextSize > kMaxFieldValue) return false;
+    uint64_t end = 32 + nextOffset + nextSize;
+    file.type = "7z";
+    file.detail = "версия 0." + std::to_string(p[7]);
+    file.complete = end <= size && computeCrc32(p + 32 + nextOffset, static_cast<size_t>(nextSize)) == readLE32(p + 28);
+    file.range.length = std::min<uint64_t>(end, size);
+    return true;
+}
+
+// Число переменной длины RAR5: по 7 бит, старший бит — продолжение
+bool readVint(const uint8_t* p, size_t size, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < size; shift += 7) {
+        uint8_t b = p[pos++];
+        value |= uint64_t(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// Блоки RAR5: CRC32, размер заголовка, тип, флаги, размеры дополнительной
+// области и данных. Первым идёт главный заголовок или заголовок шифрования,
+// последним — конец архива (тип 5)
+bool walkRar5(const uint8_t* p, size_t size, EmbeddedFile& file) {
+    file.detail = "RAR5";
+    uint64_t pos = 8;
+    size_t blocks = 0;
+    while (pos + 4 < size && blocks < kMaxRarBlocks) {
+        size_t at = static_cast<size_t>(pos) + 4;
+        uint64_t headerSize;
+        if (!readVint(p, size, at, headerSize) || headerSize == 0 || headerSize > size - at ||
+            computeCrc32(p + pos + 4, at - pos - 4 + static_cast<size_t>(headerSize)) != readLE32(p + pos)) break;
+        const size_t headerEnd = at + static_cast<size_t>(headerSize);
+        uint64_t type, flags, extraSize = 0, dataSize = 0;
+        if (!readVint(p, headerEnd, at, type) || !readVint(p, headerEnd, at, flags) ||
+            ((flags & 1) && !readVint(p, headerEnd, at, extraSize)) ||
+            ((flags & 2) && !readVint(p, headerEnd, at, dataSize)) || dataSize > kMaxFieldValue) break;
+        if (blocks++ == 0 && type != 1 && type != 4) return false;
+        if (type == 4) {
+            // Дальнейшие заголовки зашифрованы и не прослеживаются
+            file.detail += ", зашифрованные заголовки";
+            break;
+        }
+        pos = headerEnd + dataSize;
+        if (type == 5) {
+            file.complete = pos <= size;
+            file.range.length = std::min<uint64_t>(pos, size);
+            return true;
+        }
+    }
+    if (blocks == 0) return false;
+    file.complete = pos == size;
+    file.range.length = size;
+    return true;
+}
+
+// Блоки RAR 1.5–4.x: CRC16, тип, флаги, размер заголовка и, при флаге
+// 0x8000 или у файлового блока, размер данных. Первым после сигнатуры
+// идёт заголовок архива (0x73), последним — необязательный 0x7B
+bool walkRar4(const uint8_t* p, size_t size, EmbeddedFile& file) {
+    file.detail = "RAR 1.5–4.x";
+    uint64_t pos = 7;
+    size_t blocks = 0;
+    while (pos + 7 <= size && blocks < kMaxRarBlocks) {
+        const uint8_t* h = p + pos;
+        uint8_t type = h[2];
+        uint16_t flags = readLE16(h + 3);
+        uint16_t headSize = readLE16(h + 5);
+        if (type < 0x72 || type > 0x7B || headSize < 7) break;
+        if (blocks == 0 && (type != 0x73 || headSize > size - pos ||
+            (computeCrc32(h + 2, headSize - 2u) & 0xFFFF) != readLE16(h))) return false;
+        uint64_t dataSize = 0;
+        if ((flags & 0x8000) || type == 0x74) {
+            if (headSize < 11 || pos + 11 > size) break;
+            dataSize = readLE32(h + 7);
+            if (type == 0x74 && (flags & 0x100) && headSize >= 36 && pos + 36 <= size) {
+                dataSize |= uint64_t(readLE32(h + 32)) << 32;     // HIGH_PACK_SIZE
+            }
+        }
+        blocks++;
+        pos += headSize + dataSize;
+        if (type == 0x7B) {
+            file.complete = pos <= size;
+            file.range.length = std::min<uint64_t>(pos, size);
+            return true;
+        }
+    }
+    if (blocks == 0) return false;
+    file.complete = pos == size;
+    file.range.length = size;
+    return true;
+}
+
+bool carveRar(const uint8_t* p, size_t size, EmbeddedFile& file) {
+    static const uint8_t rar5[] = { 'R', 'a', 'r', '!', 0x1A, 0x07, 0x01, 0x00 };
+    static const uint8_t rar4[] = { 'R', 'a', 'r', '!', 0x1A, 0x07, 0x00 };
+    file.type = "RAR";
+    if (size >= 8 && std::memcmp(p, rar5, 8) == 0) return walkRar5(p, size, file);
+    if (size >= 7 && std::memcmp(p, rar4, 7) == 0) return walkRar4(p, size, file);
+    return false;
+}
+
+inline bool isTextByte(uint8_t b) {
+    return b >= 0x20 || b == '\t' || b == '\n' || b == '\r' || b == '\f';
+}
+
+// Строка #! с абсолютным путём интерпретатора; сценарий продолжается до
+// первого управляющего байта, не встречающегося в тексте
+bool carveScript(const uint8_t* p, size_t size, EmbeddedFile& file) {
+    size_t i = 2;
+    while (i < size && i < 4 && p[i] == ' ') i++;
+    if (i >= size || p[i] != '/') return false;
+
+    size_t lineEnd = i;
+    while (lineEnd < size && lineEnd < kMaxShebangLine && p[lineEnd] != '\n') {
+        uint8_t b = p[lineEnd];
+        if ((b < 0x20 && b != '\t' && b != '\r') || b >= 0x7F) return false;
+        lineEnd++;
+    }
+    if (lineEnd >= size || p[lineEnd] != '\n') return false;
+
+    size_t pathEnd = i;
+    while (pathEnd < lineEnd && p[pathEnd] != ' ' && p[pathEnd] != '\t' && p[pathEnd] != '\r') pathEnd++;
+    size_t nameBegin = i;
+    for (size_t k = i; k < pathEnd; ++k) {
+        if (p[k] == '/') nameBegin = k + 1;
+    }
+    if (nameBegin == pathEnd || !std::all_of(p + i, p + pathEnd, [](uint8_t b) {
+        return std::isalnum(b) || b == '/' || b == '.' || b == '_' || b == '-' || b == '+';
+    })) return false;
+
+    size_t end = lineEnd + 1;
+    while (end < size && isTextByte(p[end])) end++;
+    size_t shown = lineEnd > 0 && p[lineEnd - 1] == '\r' ? lineEnd - 1 : lineEnd;
+    file.type = "Script";
+    file.detail = std::string(reinterpret_cast<const char*>(p), std::min<size_t>(shown, 80));
+    file.complete = true;
+    file.range.length = end;
+    return true;
+}
+
+struct Carver {
+    uint8_t first;
+    uint8_t second;
+    bool (*carve)(const uint8_t* p, size_t size, EmbeddedFile& file);
+};
+
+const Carver kCarvers[] = {
+    { 'P', 'K', carveZip }, { 'M', 'Z', carvePe }, { 0x7F, 'E', carveElf }, { '%', 'P', carvePdf },
+    { '7', 'z', carve7z }, { 'R', 'a', carveRar }, { '#', '!', carveScript } };
+
+BytePairSet makeCarverPairs() {
+    BytePairSet pairs;
+    for (const Carver& c : kCarvers) {
+        pairs.first[pairs.count] = c.first;
+        pairs.second[pairs.count] = c.second;
+        pairs.count++;
+    }
+    return pairs;
+}
+
+} // namespace
+
+std::vector<EmbeddedFile> findEmbeddedFiles(const uint8_t* data, size_t size, size_t maxFiles) {
+    return findEmbeddedFiles(data, size, { { 0, size } }, maxFiles);
+}
+
+std::vector<EmbeddedFile> findEmbeddedFiles(const uint8_t* data, size_t size, const std::vector<ByteRange>& search,
+    size_t maxFiles) {
+    static_assert(sizeof(kCarvers) / sizeof(kCarvers[0]) <= BytePairSet::kMaxPairs, "слишком много сигнатур");
+    static const BytePairSet pairs = makeCarverPairs();
+    std::vector<EmbeddedFile> files;
+    size_t pos = 1;
+    for (const ByteRange& range : search) {
+        const size_t end = static_cast<size_t>(std::min<uint64_t>(range.end(), size));
+        pos = std::max(pos, static_cast<size_t>(std::min<uint64_t>(range.offset, size)));
+        while (pos < end && files.size() < maxFiles) {
+            size_t hit = pos + findAnyBytePair(data + pos, end - pos, pairs);
+            if (hit >= end) break;
+
+            EmbeddedFile file;
+            bool found = false;
+            for (const Carver& c : kCarvers) {
+                if (data[hit] == c.first && data[hit + 1] == c.second) {
+                    found = c.carve(data + hit, size - hit, file);
+                    break;
+                }
+            }
+            if (!found) {
+                pos = hit + 1;
+                continue;
+            }
+            file.range.offset = hit;
+            pos = hit + std::max<size_t>(static_cast<size_t>(file.range.length), 1);
+            files.push_back(std::move(file));
+        }
+    }
+    return files;
+}
@@ -0,0 +1,31 @@
+﻿#ifndef EMBEDDED_FILES_H
+#define EMBEDDED_FILES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "byte_ranges.h"
+
+// Файл, найденный внутри данных по сигнатуре и подтверждённый разбором заголовков
+struct EmbeddedFile {
+    std::string type;             // ZIP, PE, ELF, PDF, 7z, RAR, Script
+    ByteRange range;              // границы для вырезания и повторного сканирования
+    bool complete = false;        // конец найден по структуре; иначе файл обрезан или длится до конца данных
+    std::string detail;           // разрядность и архитектура, версия, число записей, интерпретатор
+};
+
+// Поиск сигнатур ZIP (PK\3\4), PE (MZ + PE\0\0), ELF, PDF, 7z, RAR и строк
+// #! одним векторным проходом сразу по всем префиксам; каждый кандидат
+// проверяется по структуре, а граница файла берётся из его заголовков
+// (EOCD, таблица секций, таблицы ELF, %%EOF, заголовок 7z, блоки RAR).
+// Сигнатура в начале данных относится к самому файлу и не считается
+// вложенной; внутри найденного файла поиск не продолжается
+std::vector<EmbeddedFile> findEmbeddedFiles(const uint8_t* data, size_t size, size_t maxFiles = 64);
+
+// То же, но сигнатуры ищутся только в участках search (упорядоченных по
+// смещению); разбор найденного файла может выходить за пределы участка
+std::vector<EmbeddedFile> findEmbeddedFiles(const uint8_t* data, size_t size, const std::vector<ByteRange>& search,
+    size_t maxFiles = 64);
+
+#endif // EMBEDDED_FILES_H
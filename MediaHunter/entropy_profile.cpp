@@ -0,0 +1,124 @@
+﻿#include "entropy_profile.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Четыре частичные гистограммы разрывают зависимость по памяти между
+// соседними байтами с одинаковым значением (store-to-load forwarding),
+// что для гистограмм даёт основной выигрыш; сведение частичных гистограмм
+// и суммирование энтропии компилятор векторизует.
+void accumulate4(const uint8_t* data, size_t size, uint32_t* counts) {
+    uint32_t* h0 = counts;
+    uint32_t* h1 = counts + 256;
+    uint32_t* h2 = counts + 512;
+    uint32_t* h3 = counts + 768;
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        h0[data[i]]++;
+        h1[data[i + 1]]++;
+        h2[data[i + 2]]++;
+        h3[data[i + 3]]++;
+    }
+    for (; i < size; ++i) h0[data[i]]++;
+}
+
+void reduce4(const uint32_t* counts, uint32_t* out) {
+    for (int v = 0; v < 256; ++v) {
+        out[v] = counts[v] + counts[256 + v] + counts[512 + v] + counts[768 + v];
+    }
+}
+
+} // namespace
+
+double shannonEntropy(const uint8_t* data, size_t size) {
+    if (!data || size == 0) return 0.0;
+    // Гистограмма 32-битная, поэтому очень большие буферы обрабатываются частями
+    std::vector<uint32_t> counts(4 * 256, 0);
+    uint32_t merged[256];
+    uint64_t total[256] = {};
+    const size_t chunk = size_t(1) << 30;
+    for (size_t off = 0; off < size; off += chunk) {
+        std::fill(counts.begin(), counts.end(), 0u);
+        accumulate4(data + off, std::min(chunk, size - off), counts.data());
+        reduce4(counts.data(), merged);
+        for (int v = 0; v < 256; ++v) total[v] += merged[v];
+    }
+    double sumNLogN = 0.0;
+    for (uint64_t c : total) {
+        if (c) sumNLogN += static_cast<double>(c) * std::log2(static_cast<double>(c));
+    }
+    double n = static_cast<double>(size);
+    return std::log2(n) - sumNLogN / n;
+}
+
+EntropyProfiler::EntropyProfiler(size_t blockSize)
+    : blockSize_(blockSize ? blockSize : 4096)
+    , nLogN_(blockSize_ + 1, 0.0)
+    , counts_(4 * 256, 0) {
+    for (size_t c = 2; c <= blockSize_; ++c) {
+        nLogN_[c] = static_cast<double>(c) * std::log2(static_cast<double>(c));
+    }
+}
+
+void EntropyProfiler::update(const uint8_t* data, size_t size) {
+    while (size > 0) {
+        size_t take = std::min(size, blockSize_ - filled_);
+        accumulate4(data, take, counts_.data());
+        filled_ += take;
+        total_ += take;
+        data += take;
+        size -= take;
+        if (filled_ == blockSize_) closeBlock();
+    }
+}
+
+void EntropyProfiler::finish() {
+    if (filled_ > 0) closeBlock();
+}
+
+void EntropyProfiler::closeBlock() {
+    uint32_t merged[256];
+    reduce4(counts_.data(), merged);
+    double sum = 0.0;
+    for (int v = 0; v < 256; ++v) sum += nLogN_[merged[v]];
+    double n = static_cast<double>(filled_);
+    blocks_.push_back(static_cast<float>(std::log2(n) - sum / n));
+    std::fill(counts_.begin(), counts_.end(), 0u);
+    filled_ = 0;
+}
+
+double EntropyProfiler::meanEntropy() const {
+    if (blocks_.empty()) return 0.0;
+    double sum = 0.0;
+    for (float e : blocks_) sum += e;
+    return sum / blocks_.size();
+}
+
+double EntropyProfiler::maxEntropy() const {
+    return blocks_.empty() ? 0.0 : *std::max_element(blocks_.begin(), blocks_.end());
+}
+
+std::vector<EntropyRegion> EntropyProfiler::highEntropyRegions(double threshold, size_t minBlocks) const {
+    std::vector<EntropyRegion> regions;
+    size_t i = 0;
+    while (i < blocks_.size()) {
+        if (blocks_[i] < threshold) {
+            ++i;
+            continue;
+        }
+        size_t first = i;
+        double sum = 0.0;
+        while (i < blocks_.size() && blocks_[i] >= threshold) sum += blocks_[i++];
+        size_t count = i - first;
+        if (count < std::max<size_t>(minBlocks, 1)) continue;
+
+        EntropyRegion region;
+        region.range.offset = static_cast<uint64_t>(first) * blockSize_;
+        uint64_t end = std::min<uint64_t>(total_, static_cast<uint64_t>(i) * blockSize_);
+        region.range.length = end - region.range.offset;
+        region.meanEntropy = sum / count;
+        regions.push_back(region);
+    }
+    return regions;
+}
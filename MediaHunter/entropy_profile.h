@@ -0,0 +1,49 @@
+﻿#ifndef ENTROPY_PROFILE_H
+#define ENTROPY_PROFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "byte_ranges.h"
+
+// Энтропия Шеннона (бит на байт) для произвольного буфера
+double shannonEntropy(const uint8_t* data, size_t size);
+
+// Непрерывная область блоков с высокой энтропией
+struct EntropyRegion {
+    ByteRange range;
+    double meanEntropy = 0.0;
+};
+
+// Карта энтропии по блокам фиксированного размера, строится за один
+// потоковый проход: данные можно подавать частями произвольной длины.
+class EntropyProfiler {
+public:
+    explicit EntropyProfiler(size_t blockSize = 4096);
+
+    void update(const uint8_t* data, size_t size);
+    // Учитывает неполный последний блок; после вызова update не допускается
+    void finish();
+
+    size_t blockSize() const { return blockSize_; }
+    uint64_t bytesProcessed() const { return total_; }
+    const std::vector<float>& blocks() const { return blocks_; }
+
+    double meanEntropy() const;
+    double maxEntropy() const;
+
+    // Подряд идущие блоки с энтропией не ниже threshold (не менее minBlocks)
+    std::vector<EntropyRegion> highEntropyRegions(double threshold = 7.9, size_t minBlocks = 2) const;
+
+private:
+    void closeBlock();
+
+    size_t blockSize_;
+    std::vector<double> nLogN_;        // c·log2(c) для c из [0, blockSize]
+    std::vector<uint32_t> counts_;     // 4 частичные гистограммы по 256 ячеек
+    size_t filled_ = 0;                // байтов в текущем блоке
+    uint64_t total_ = 0;
+    std::vector<float> blocks_;
+};
+
+#endif // ENTROPY_PROFILE_H
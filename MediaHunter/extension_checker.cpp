@@ -1,6 +1,8 @@
 ﻿#include "extension_checker.h"
 #include "file_reader.h"
 #include "report_generator.h"
+#include "console_output.h"
+#include "random_access_file.h"
 #include <iostream>
 #include <filesystem>
 #include <vector>
@@ -12,15 +14,20 @@ namespace fs = std::filesystem;
 
 std::vector<std::string> ExtensionChecker::analyzeFile(const std::string& filePath) {
     std::vector<std::string> reportLines;
-    // Загрузка файла и определение формата по сигнатуре
-    FileReader reader(filePath);
-    std::vector<uint8_t> buffer;
-    if (!reader.loadFile(buffer)) {
+    // Определение формата по сигнатуре: достаточно первых байтов файла
+    RandomAccessFile file;
+    if (!file.open(filePath)) {
         std::cerr << "Ошибка: не удалось открыть файл: " << filePath << "\n";
         reportLines.push_back("Ошибка: не удалось открыть файл."); // ⬅️ Сохраняем сообщение в отчёт
         return reportLines;
     }
-    std::string format = reader.detectFileType(buffer);
+    std::vector<uint8_t> signature(64);
+    signature.resize(file.readAt(0, signature.data(), signature.size()));
+    return analyzeName(filePath, FileReader(filePath).detectFileType(signature));
+}
+
+std::vector<std::string> ExtensionChecker::analyzeName(const std::string& filePath, const std::string& format) {
+    std::vector<std::string> reportLines;
 
     // Получение расширений файла
     fs::path pathObj(filePath);
@@ -47,11 +54,26 @@ std::vector<std::string> ExtensionChecker::analyzeFile(const std::string& filePa
     else if (format == "BMP") {
         if (extLower != ".bmp") extMismatch = true;
     }
+    else if (format == "GIF") {
+        if (extLower != ".gif") extMismatch = true;
+    }
     else if (format == "MP3") {
         if (extLower != ".mp3") extMismatch = true;
     }
+    else if (format == "WAV") {
+        if (extLower != ".wav") extMismatch = true;
+    }
     else if (format == "MP4") {
-        if (extLower != ".mp4") extMismatch = true;
+        if (!(extLower == ".mp4" || extLower == ".m4v" || extLower == ".m4a")) extMismatch = true;
+    }
+    else if (format == "MOV") {
+        if (extLower != ".mov") extMismatch = true;
+    }
+    else if (format == "HEIF") {
+        if (!(extLower == ".heic" || extLower == ".heif")) extMismatch = true;
+    }
+    else if (format == "AVIF") {
+        if (extLower != ".avif") extMismatch = true;
     }
     else if (format == "WebM") {
         if (extLower != ".webm") extMismatch = true;
@@ -71,7 +93,7 @@ std::vector<std::string> ExtensionChecker::analyzeFile(const std::string& filePa
     else if (format == "AV1") {
         if (extLower != ".av1") extMismatch = true;
     }
-    else if (format == "WebP") {
+    else if (format == "WEBP") {
         if (extLower != ".webp") extMismatch = true;
     }
     else if (format == "TIFF") {
@@ -92,6 +114,19 @@ std::vector<std::string> ExtensionChecker::analyzeFile(const std::string& filePa
     else if (format == "WMF") {
         if (extLower != ".wmf") extMismatch = true;
     }
+    else if (format == "ZIP") {
+        static const std::vector<std::string> zipExtensions = {
+            ".zip", ".docx", ".docm", ".xlsx", ".xlsm", ".pptx", ".pptm", ".odt", ".ods", ".odp",
+            ".jar", ".apk", ".epub"
+        };
+        if (std::find(zipExtensions.begin(), zipExtensions.end(), extLower) == zipExtensions.end()) extMismatch = true;
+    }
+    else if (format == "GZIP") {
+        if (!(extLower == ".gz" || extLower == ".tgz")) extMismatch = true;
+        // .tar.gz, .png.gz — обычное имя сжатого файла, а не маскировка;
+        // имя внутри проверяется отдельно при анализе архива
+        if (extLower == ".gz") fullExt.clear();
+    }
     // Формат "Unknown" или прочие пропускаем
 
     // Проверка не-ASCII символов в расширении
@@ -155,14 +190,14 @@ std::vector<std::string> ExtensionChecker::analyzeFile(const std::string& filePa
     bool threat = extMismatch || !fullExt.empty() || nonAsciiExt || hasInvisible;
 
     // Вывод результатов в консоль
-    std::cout << "========================================\n";
-    std::cout << "Анализ файла: " << filePath << "\n\n";
-    std::cout << "Фактический тип: " << format << "\n";
-    std::cout << "Расширение файла: " << (extension.empty() ? "-" : extension) << "\n";
-    std::cout << "Двойное расширение: " << (fullExt.empty() ? "-" : fullExt) << "\n";
-    std::cout << "Комментарий: " << comment << "\n\n";
-    std::cout << "Результат: " << (threat ? "Потенциальная угроза" : "Угроз не обнаружено") << "\n";
-    std::cout << "========================================\n";
+    console() << "========================================\n";
+    console() << "Анализ файла: " << filePath << "\n\n";
+    console() << "Фактический тип: " << format << "\n";
+    console() << "Расширение файла: " << (extension.empty() ? "-" : extension) << "\n";
+    console() << "Двойное расширение: " << (fullExt.empty() ? "-" : fullExt) << "\n";
+    console() << "Комментарий: " << comment << "\n\n";
+    console() << "Результат: " << (threat ? "Потенциальная угроза" : "Угроз не обнаружено") << "\n";
+    console() << "========================================\n";
 
     // Формирование отчёта для одного файла
     reportLines.push_back("Фактический тип: " + format);
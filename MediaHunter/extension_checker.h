@@ -1,4 +1,4 @@
-#ifndef EXTENSION_CHECKER_H
+﻿#ifndef EXTENSION_CHECKER_H
 #define EXTENSION_CHECKER_H
 
 #include <string>
@@ -7,6 +7,8 @@
 class ExtensionChecker {
 public:
     std::vector<std::string> analyzeFile(const std::string& filePath);
+    // Проверка имени при уже известном типе содержимого (элементы архивов)
+    std::vector<std::string> analyzeName(const std::string& filePath, const std::string& format);
     std::vector<std::pair<std::string, std::vector<std::string>>> analyzeDirectory(const std::string& dirPath);
 };
 
@@ -0,0 +1,396 @@
+﻿#include "file_prefetcher.h"
+#include "random_access_file.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+
+#if defined(__linux__) && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#    define MH_IO_URING 1
+#  endif
+#endif
+
+#if defined(MH_IO_URING)
+#  include <cerrno>
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <sys/uio.h>
+#  include <unistd.h>
+#  if !defined(__NR_io_uring_setup) || !defined(__NR_io_uring_enter) || !defined(__NR_io_uring_register)
+#    undef MH_IO_URING
+#  endif
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const size_t kReadSize = 1024 * 1024;
+
+} // namespace
+
+// Способ выполнения чтений: у каждого из slotCount чтений в полёте свой
+// буфер kReadSize; содержимое не используется — важно, что страницы файла
+// попадают в кэш
+class ReadBackend {
+public:
+    explicit ReadBackend(size_t slotCount) {
+        for (size_t i = 0; i < slotCount; ++i) buffers_.emplace_back(new uint8_t[kReadSize]);
+    }
+    virtual ~ReadBackend() = default;
+
+    virtual const char* name() const = 0;
+    // length не больше kReadSize; false — чтение не поставлено в очередь
+    virtual bool submit(size_t slot, const RandomAccessFile& file, uint64_t offset, size_t length) = 0;
+    // Ожидание одного завершённого чтения: номер буфера и число байтов.
+    // false — очередь отказала, завершений больше не будет
+    virtual bool wait(size_t& slot, int64_t& result) = 0;
+
+protected:
+    std::vector<std::unique_ptr<uint8_t[]>> buffers_;
+};
+
+namespace {
+
+// Запасной вариант: чтения выполняются собственным пулом из slotCount
+// потоков, чтобы блокирующий pread не занимал общий пул анализа
+class PoolReadBackend : public ReadBackend {
+public:
+    explicit PoolReadBackend(size_t slotCount) : ReadBackend(slotCount), pool_(slotCount) {}
+
+    const char* name() const override { return "пул потоков"; }
+
+    bool submit(size_t slot, const RandomAccessFile& file, uint64_t offset, size_t length) override {
+        pool_.submit([this, slot, &file, offset, length] {
+            size_t got = file.readAt(offset, buffers_[slot].get(), length);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                completed_.emplace_back(slot, static_cast<int64_t>(got));
+            }
+            done_.notify_one();
+        });
+        return true;
+    }
+
+    bool wait(size_t& slot, int64_t& result) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return !completed_.empty(); });
+        slot = completed_.front().first;
+        result = completed_.front().second;
+        completed_.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable done_;
+    std::deque<std::pair<size_t, int64_t>> completed_;
+    ThreadPool pool_;    // последним: потоки завершаются раньше очереди
+};
+
+#if defined(MH_IO_URING)
+
+// io_uring через системные вызовы без liburing: буферы регистрируются
+// один раз (IORING_REGISTER_BUFFERS), чтения идут операцией READ_FIXED
+class IoUringReadBackend : public ReadBackend {
+public:
+    explicit IoUringReadBackend(size_t slotCount) : ReadBackend(slotCount) {}
+
+    ~IoUringReadBackend() override {
+        if (sqes_) munmap(sqes_, sqesSize_);
+        if (cqRing_ && cqRing_ != sqRing_) munmap(cqRing_, cqRingSize_);
+        if (sqRing_) munmap(sqRing_, sqRingSize_);
+        if (ring_ >= 0) close(ring_);
+    }
+
+    // false — ядро или ограничения процесса не позволяют использовать io_uring
+    bool init() {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_ = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(buffers_.size()), &params));
+        if (ring_ < 0) return false;
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+        void* sq = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQ_RING);
+        if (sq == MAP_FAILED) return false;
+        sqRing_ = sq;
+        if (singleMap) {
+            cqRing_ = sqRing_;
+        }
+        else {
+            void* cq = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_CQ_RING);
+            if (cq == MAP_FAILED) return false;
+            cqRing_ = cq;
+        }
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        uint8_t* sqBase = static_cast<uint8_t*>(sqRing_);
+        sqTail_ = reinterpret_cast<unsigned*>(sqBase + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sqBase + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sqBase + params.sq_off.array);
+        uint8_t* cqBase = static_cast<uint8_t*>(cqRing_);
+        cqHead_ = reinterpret_cast<unsigned*>(cqBase + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cqBase + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cqBase + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cqBase + params.cq_off.cqes);
+
+        std::vector<iovec> vectors(buffers_.size());
+        for (size_t i = 0; i < buffers_.size(); ++i) {
+            vectors[i].iov_base = buffers_[i].get();
+            vectors[i].iov_len = kReadSize;
+        }
+        return syscall(__NR_io_uring_register, ring_, IORING_REGISTER_BUFFERS, vectors.data(),
+            static_cast<unsigned>(vectors.size())) == 0;
+    }
+
+    const char* name() const override { return "io_uring"; }
+
+    bool submit(size_t slot, const RandomAccessFile& file, uint64_t offset, size_t length) override {
+        // Очередь заполняет только поток упреждения, поэтому хвост читается
+        // без синхронизации, а публикуется с release
+        unsigned tail = *sqTail_;
+        unsigned index = tail & sqMask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ_FIXED;
+        sqe.fd = file.descriptor();
+        sqe.off = offset;
+        sqe.addr = reinterpret_cast<uint64_t>(buffers_[slot].get());
+        sqe.len = static_cast<uint32_t>(length);
+        sqe.buf_index = static_cast<uint16_t>(slot);
+        sqe.user_data = slot;
+        sqArray_[index] = index;
+        __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+
+        while (true) {
+            long submitted = syscall(__NR_io_uring_enter, ring_, 1u, 0u, 0u, nullptr, 0);
+            if (submitted >= 0) return submitted == 1;
+            if (errno != EINTR && errno != EAGAIN) return false;
+        }
+    }
+
+    bool wait(size_t& slot, int64_t& result) override {
+        while (true) {
+            unsigned head = *cqHead_;
+            if (head != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+                const io_uring_cqe& cqe = cqes_[head & cqMask_];
+                slot = static_cast<size_t>(cqe.user_data);
+                result = cqe.res;
+                __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+            long waited = syscall(__NR_io_uring_enter, ring_, 0u, 1u, static_cast<unsigned>(IORING_ENTER_GETEVENTS),
+                nullptr, 0);
+            if (waited < 0 && errno != EINTR && errno != EAGAIN) return false;
+        }
+    }
+
+private:
+    int ring_ = -1;
+    void* sqRing_ = nullptr;
+    void* cqRing_ = nullptr;
+    size_t sqRingSize_ = 0;
+    size_t cqRingSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned* sqArray_ = nullptr;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+#endif
+
+std::unique_ptr<ReadBackend> createBackend(size_t slotCount) {
+#if defined(MH_IO_URING)
+    std::unique_ptr<IoUringReadBackend> ring(new IoUringReadBackend(slotCount));
+    if (ring->init()) return ring;
+#endif
+    return std::unique_ptr<ReadBackend>(new PoolReadBackend(slotCount));
+}
+
+} // namespace
+
+FilePrefetcher::FilePrefetcher(std::vector<std::string> paths, size_t queueDepth, uint64_t aheadBytes)
+    : queueDepth_(queueDepth), aheadBytes_(aheadBytes) {
+    files_.reserve(paths.size());
+    for (auto& path : paths) {
+        FileState state;
+        state.path = std::move(path);
+        files_.push_back(std::move(state));
+    }
+    if (queueDepth_ == 0 || files_.empty()) return;
+    backend_ = createBackend(queueDepth_);
+    thread_ = std::thread([this] { run(); });
+}
+
+FilePrefetcher::~FilePrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void FilePrefetcher::advance(size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_ = index;
+    }
+    changed_.notify_all();
+}
+
+const char* FilePrefetcher::backendName() const {
+    return backend_ ? backend_->name() : "отключено";
+}
+
+uint64_t FilePrefetcher::bytesPrefetched() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return prefetched_;
+}
+
+bool FilePrefetcher::nextRead(size_t& file, uint64_t& offset, size_t& length) {
+    if (cursorFile_ < current_) {
+        cursorFile_ = current_;
+        cursorOffset_ = 0;
+    }
+    while (cursorFile_ < files_.size()) {
+        FileState& state = files_[cursorFile_];
+        if (!state.sized) {
+            std::error_code error;
+            uintmax_t size = fs::file_size(state.path, error);
+            state.size = error ? 0 : static_cast<uint64_t>(size);
+            state.sized = true;
+        }
+        if (cursorOffset_ >= state.size) {
+            cursorFile_++;
+            cursorOffset_ = 0;
+            continue;
+        }
+        uint64_t ahead = cursorOffset_;
+        for (size_t i = current_; i < cursorFile_; ++i) ahead += files_[i].size;
+        if (ahead >= aheadBytes_) return false;
+
+        file = cursorFile_;
+        offset = cursorOffset_;
+        length = static_cast<size_t>(std::min<uint64_t>(kReadSize, state.size - cursorOffset_));
+        cursorOffset_ += length;
+        return true;
+    }
+    return false;
+}
+
+void FilePrefetcher::run() {
+    std::vector<size_t> freeSlots;
+    for (size_t slot = queueDepth_; slot > 0; --slot) freeSlots.push_back(slot - 1);
+    std::vector<size_t> slotFile(queueDepth_, 0);
+    std::vector<std::unique_ptr<RandomAccessFile>> open(files_.size());
+    std::vector<size_t> openFiles;
+    std::vector<size_t> outstanding(files_.size(), 0);
+    size_t inFlight = 0;
+    bool failed = false;      // очередь отказала: упреждение прекращается
+
+    // Файлы, до которых курсор уже не вернётся, закрываются после
+    // завершения их чтений
+    auto closePassed = [&] {
+        size_t cursor;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cursor = cursorFile_;
+        }
+        auto passed = [&](size_t file) { return file < cursor && outstanding[file] == 0; };
+        for (size_t file : openFiles) {
+            if (passed(file)) open[file].reset();
+        }
+        openFiles.erase(std::remove_if(openFiles.begin(), openFiles.end(), passed), openFiles.end());
+    };
+
+    while (true) {
+        bool stop = false;
+        while (!freeSlots.empty() && !failed) {
+            size_t file = 0;
+            uint64_t offset = 0;
+            size_t length = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) {
+                    stop = true;
+                    break;
+                }
+                if (!nextRead(file, offset, length)) break;
+            }
+            if (!open[file]) {
+                std::unique_ptr<RandomAccessFile> handle(new RandomAccessFile());
+                if (!handle->open(files_[file].path)) {
+                    // Недоступный файл пропускается, анализ сообщит об ошибке сам
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (cursorFile_ == file) {
+                        cursorFile_++;
+                        cursorOffset_ = 0;
+                    }
+                    continue;
+                }
+                open[file] = std::move(handle);
+                openFiles.push_back(file);
+            }
+            size_t slot = freeSlots.back();
+            if (!backend_->submit(slot, *open[file], offset, length)) {
+                failed = true;
+                break;
+            }
+            freeSlots.pop_back();
+            slotFile[slot] = file;
+            outstanding[file]++;
+            inFlight++;
+        }
+        closePassed();
+
+        if (inFlight == 0) {
+            if (stop) break;
+            std::unique_lock<std::mutex> lock(mutex_);
+            // Окно прочитано: оно сдвигается только при переходе к следующему файлу
+            size_t seen = current_;
+            changed_.wait(lock, [&] { return stopping_ || current_ != seen; });
+            if (stopping_) break;
+            continue;
+        }
+
+        size_t slot = 0;
+        int64_t result = 0;
+        if (!backend_->wait(slot, result)) {
+            // Незавершённых чтений уже не дождаться, упреждение прекращается
+            inFlight = 0;
+            break;
+        }
+        inFlight--;
+        freeSlots.push_back(slot);
+        outstanding[slotFile[slot]]--;
+        if (result > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            prefetched_ += static_cast<uint64_t>(result);
+        }
+        if (stop && inFlight == 0) break;
+    }
+
+    // Буферы принадлежат backend_, поэтому перед выходом дожидаемся всех чтений
+    while (inFlight > 0) {
+        size_t slot = 0;
+        int64_t result = 0;
+        if (!backend_->wait(slot, result)) break;
+        inFlight--;
+    }
+}
@@ -0,0 +1,67 @@
+﻿#ifndef FILE_PREFETCHER_H
+#define FILE_PREFETCHER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ReadBackend;
+
+// Упреждающее чтение файлов каталога, пока анализируется текущий: отдельный
+// поток держит queueDepth чтений в полёте (io_uring с зарегистрированными
+// буферами, а где он недоступен — собственный пул потоков с pread), и
+// следующие файлы оказываются в кэше страниц к началу их анализа. Чтение
+// идёт не дальше aheadBytes от начала текущего файла, чтобы упреждение не
+// вытесняло из кэша то, что ещё анализируется
+class FilePrefetcher {
+public:
+    static constexpr size_t kDefaultQueueDepth = 8;
+    static constexpr uint64_t kDefaultAheadBytes = 512ULL * 1024ULL * 1024ULL;
+
+    // queueDepth == 0 — упреждение отключено
+    explicit FilePrefetcher(std::vector<std::string> paths, size_t queueDepth = kDefaultQueueDepth,
+        uint64_t aheadBytes = kDefaultAheadBytes);
+    ~FilePrefetcher();
+
+    FilePrefetcher(const FilePrefetcher&) = delete;
+    FilePrefetcher& operator=(const FilePrefetcher&) = delete;
+
+    // Начинается анализ файла index (в порядке paths)
+    void advance(size_t index);
+
+    // "io_uring", "пул потоков" или "отключено"
+    const char* backendName() const;
+    uint64_t bytesPrefetched() const;
+
+private:
+    struct FileState {
+        std::string path;
+        uint64_t size = 0;
+        bool sized = false;
+    };
+
+    void run();
+    // Следующий участок для чтения в пределах окна; false — окно прочитано
+    bool nextRead(size_t& file, uint64_t& offset, size_t& length);
+
+    std::vector<FileState> files_;
+    size_t queueDepth_;
+    uint64_t aheadBytes_;
+    std::unique_ptr<ReadBackend> backend_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    size_t current_ = 0;         // анализируемый файл
+    size_t cursorFile_ = 0;      // следующий участок для упреждения
+    uint64_t cursorOffset_ = 0;
+    uint64_t prefetched_ = 0;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+#endif // FILE_PREFETCHER_H
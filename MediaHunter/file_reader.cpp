@@ -36,35 +36,64 @@ std::string FileReader::detectFileType(const std::vector<uint8_t>& buf) const {
         {"JPEG",   {0xFF, 0xD8, 0xFF}, 0},
         {"PNG",    {0x89, 0x50, 0x4E, 0x47}, 0},
         {"BMP",    {0x42, 0x4D}, 0},
+        {"GIF",    {'G', 'I', 'F', '8'}, 0},
         {"MP3",    {0x49, 0x44, 0x33}, 0},
+        {"MP3",    {0xFF, 0xFB}, 0},  // кадр MPEG-1 Layer III без тега ID3v2
+        {"MP3",    {0xFF, 0xFA}, 0},
+        {"MP3",    {0xFF, 0xF3}, 0},  // MPEG-2 Layer III
+        {"MP3",    {0xFF, 0xF2}, 0},
         {"MP4",    {'f', 't', 'y', 'p'}, 4},
+        {"MOV",    {'m', 'o', 'o', 'v'}, 4},  // QuickTime без ftyp
+        {"MOV",    {'w', 'i', 'd', 'e'}, 4},
+        {"MOV",    {'m', 'd', 'a', 't'}, 4},
         {"WebM",   {'w', 'e', 'b', 'm'}, 31},
         {"MKV",    {0x1A, 0x45, 0xDF, 0xA3}, 0},
         {"PSD",    {0x38, 0x42, 0x50, 0x53}, 0},
         {"HEVC",   {0x00, 0x00, 0x00, 0x01, 0x40}, 0}, // NAL Unit for HEVC
         {"AV1",    {'A', 'V', '1'}, 4},
+        {"CR2",    {0x49, 0x49, 0x2A, 0x00, 0x10, 0x00, 0x00, 0x00, 'C', 'R'}, 0},
         {"TIFF",   {0x49, 0x49, 0x2A, 0x00}, 0},
         {"TIFF",   {0x4D, 0x4D, 0x00, 0x2A}, 0},
-        {"CR2",    {0x49, 0x49, 0x2A, 0x00, 0x10, 0x00, 0x00, 0x00, 'C', 'R'}, 0},
+        {"TIFF",   {0x49, 0x49, 0x2B, 0x00}, 0}, // BigTIFF
+        {"TIFF",   {0x4D, 0x4D, 0x00, 0x2B}, 0},
         {"NEF",    {0x49, 0x49, 0x2A, 0x00}, 0},
         {"DNG",    {0x49, 0x49, 0x2A, 0x00}, 0},
         {"EMF",    {0x01, 0x00, 0x00, 0x00}, 40},
         {"WMF",    {0xD7, 0xCD, 0xC6, 0x9A}, 0},
-        {"RIFF",   {'R', 'I', 'F', 'F'}, 0} // Общее распознавание RIFF-файлов (AVI/WebP)
+        {"ZIP",    {'P', 'K', 0x03, 0x04}, 0},    // в том числе DOCX, XLSX, PPTX, ODF, JAR
+        {"GZIP",   {0x1F, 0x8B, 0x08}, 0},        // в том числе .tar.gz
+        {"RIFF",   {'R', 'I', 'F', 'F'}, 0} // Общее распознавание RIFF-файлов (AVI/WebP/WAV)
     };
 
     for (const auto& s : signatures) {
         if (buf.size() >= s.offset + s.sig.size() &&
             std::equal(s.sig.begin(), s.sig.end(), buf.begin() + s.offset)) {
-            // Специальная обработка RIFF: отличить WebP от AVI
+            // Специальная обработка RIFF: отличить WebP и WAV от AVI
             if (s.type == "RIFF") {
                 if (buf.size() >= 12 && std::equal(buf.begin() + 8, buf.begin() + 12, reinterpret_cast<const uint8_t*>("WEBP"))) {
                     return "WEBP";
                 }
+                else if (buf.size() >= 12 && std::equal(buf.begin() + 8, buf.begin() + 12, reinterpret_cast<const uint8_t*>("WAVE"))) {
+                    return "WAV";
+                }
                 else {
                     return "AVI";
                 }
             }
+            // EBML: WebM отличается от Matroska значением DocType в заголовке
+            if (s.type == "MKV") {
+                const char webm[] = "webm";
+                auto headerEnd = buf.begin() + std::min<size_t>(buf.size(), 64);
+                if (std::search(buf.begin(), headerEnd, webm, webm + 4) != headerEnd) return "WebM";
+            }
+            // ISO-BMFF: MOV, HEIF и AVIF различаются основным брендом ftyp
+            if (s.type == "MP4" && buf.size() >= 12) {
+                std::string brand(buf.begin() + 8, buf.begin() + 12);
+                if (brand == "qt  ") return "MOV";
+                if (brand == "heic" || brand == "heix" || brand == "heim" || brand == "heis" ||
+                    brand == "hevc" || brand == "mif1" || brand == "msf1") return "HEIF";
+                if (brand == "avif" || brand == "avis") return "AVIF";
+            }
             return s.type;
         }
     }
@@ -0,0 +1,64 @@
+﻿#ifndef FOURCC_H
+#define FOURCC_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Четырёхсимвольный код (тип чанка PNG, идентификатор чанка RIFF) как число:
+// первый символ — старший байт, поэтому порядок чисел совпадает с порядком строк
+constexpr uint32_t fourCC(const char (&name)[5]) {
+    return (uint32_t(uint8_t(name[0])) << 24) | (uint32_t(uint8_t(name[1])) << 16) |
+        (uint32_t(uint8_t(name[2])) << 8) | uint32_t(uint8_t(name[3]));
+}
+
+// Код из четырёх байтов файла в том же порядке
+inline uint32_t readFourCC(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+// Текст для отчёта; непечатаемые байты заменяются на '?'
+inline std::string fourCCName(uint32_t code) {
+    std::string name(4, '?');
+    for (int i = 0; i < 4; ++i) {
+        char c = static_cast<char>((code >> (24 - 8 * i)) & 0xFF);
+        if (c >= 0x20 && c < 0x7F) name[i] = c;
+    }
+    return name;
+}
+
+// Упорядоченный набор кодов, собираемый при компиляции: сортировка вставками
+// в constexpr, поиск — двоичный, без выделения памяти
+template <size_t N>
+class FourCCSet {
+public:
+    constexpr explicit FourCCSet(const std::array<uint32_t, N>& codes) : codes_(codes) {
+        for (size_t i = 1; i < N; ++i) {
+            uint32_t key = codes_[i];
+            size_t j = i;
+            for (; j > 0 && codes_[j - 1] > key; --j) codes_[j] = codes_[j - 1];
+            codes_[j] = key;
+        }
+    }
+
+    constexpr bool contains(uint32_t code) const {
+        size_t lo = 0, hi = N;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (codes_[mid] < code) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < N && codes_[lo] == code;
+    }
+
+private:
+    std::array<uint32_t, N> codes_;
+};
+
+template <size_t N>
+constexpr FourCCSet<N> makeFourCCSet(const std::array<uint32_t, N>& codes) {
+    return FourCCSet<N>(codes);
+}
+
+#endif // FOURCC_H
@@ -3,13 +3,14 @@
 #include "metadata_checker.h"
 #include "steganography_checker.h"
 #include "extension_checker.h"
+#include "archive_analyzer.h"
 #include <iostream>
 #include <filesystem>
 
 namespace fs = std::filesystem;
 
-FullAnalyzer::FullAnalyzer(const std::string& rulesPath)
-    : scanner_(rulesPath) {
+FullAnalyzer::FullAnalyzer(const std::string& rulesPath, size_t prefetchDepth)
+    : scanner_(rulesPath), prefetchDepth_(prefetchDepth) {
 }
 
 std::vector<std::string> FullAnalyzer::analyzeFile(const std::string& filePath) {
@@ -51,13 +52,18 @@ std::vector<std::string> FullAnalyzer::analyzeFile(const std::string& filePath)
     lines.insert(lines.end(), metaLines.begin(), metaLines.end());
 
     SteganographyChecker stegoChecker;
+    stegoChecker.setSignatureScanner(&scanner_);  // вложенные файлы повторно сканируются правилами YARA
     std::vector<std::string> stegLines = stegoChecker.analyzeFile(filePath);
     lines.insert(lines.end(), stegLines.begin(), stegLines.end());
 
     ExtensionChecker extChecker;
     std::vector<std::string> extLines = extChecker.analyzeFile(filePath);
     lines.insert(lines.end(), extLines.begin(), extLines.end());
-    
+
+    // Элементы архивов проходят те же проверки в памяти
+    ArchiveAnalyzer archiveAnalyzer(scanner_);
+    std::vector<std::string> archiveLines = archiveAnalyzer.analyzeFile(filePath);
+    lines.insert(lines.end(), archiveLines.begin(), archiveLines.end());
 
     return lines;
 }
@@ -70,12 +76,17 @@ std::vector<std::pair<std::string, std::vector<std::string>>> FullAnalyzer::anal
         return reports;
     }
 
+    std::vector<std::string> paths;
     for (const auto& entry : fs::directory_iterator(dirPath)) {
-        if (!entry.is_regular_file()) continue;
-        std::string filePath = entry.path().string();
+        if (entry.is_regular_file()) paths.push_back(entry.path().string());
+    }
 
-        auto lines = analyzeFile(filePath);
-        reports.emplace_back(filePath, lines);
+    // Пока анализируется один файл, следующие читаются в кэш страниц
+    FilePrefetcher prefetcher(paths, prefetchDepth_);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        prefetcher.advance(i);
+        auto lines = analyzeFile(paths[i]);
+        reports.emplace_back(paths[i], lines);
         std::cout << "\n";
     }
 
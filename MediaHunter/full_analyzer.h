@@ -6,16 +6,24 @@
 #include "signature_scanner.h"
 #include "file_reader.h"
 #include "report_generator.h"
+#include "file_prefetcher.h"
 
 class FullAnalyzer {
 public:
-    explicit FullAnalyzer(const std::string& rulesPath = "rules.yar");
+    // prefetchDepth — сколько чтений следующих файлов каталога держится в
+    // полёте во время анализа текущего (0 — без упреждения)
+    explicit FullAnalyzer(const std::string& rulesPath = "rules.yar",
+        size_t prefetchDepth = FilePrefetcher::kDefaultQueueDepth);
 
     std::vector<std::string> analyzeFile(const std::string& filePath);
     std::vector<std::pair<std::string, std::vector<std::string>>> analyzeDirectory(const std::string& dirPath);
 
+    // Сканер с загруженными правилами для модулей, которые проверяют части файла
+    SignatureScanner& signatureScanner() { return scanner_; }
+
 private:
     SignatureScanner scanner_;  // YARA-based signature scanner
+    size_t prefetchDepth_;
 };
 
 #endif
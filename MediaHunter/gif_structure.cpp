@@ -0,0 +1,144 @@
+﻿#include "gif_structure.h"
+#include <utility>
+#include <cstring>
+
+namespace {
+
+inline uint16_t readLE16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+// Цепочка подблоков до нулевого включительно; false — цепочка обрывается
+// концом данных (pos = size)
+bool skipSubBlocks(const uint8_t* data, size_t size, size_t& pos, uint64_t& dataBytes) {
+    while (pos < size) {
+        uint8_t length = data[pos];
+        if (length == 0) {
+            pos++;
+            return true;
+        }
+        if (length >= size - pos) break;
+        dataBytes += length;
+        pos += 1 + size_t(length);
+    }
+    pos = size;
+    return false;
+}
+
+// Может ли с позиции pos начинаться блок: расширение известного типа с
+// правильным размером первого подблока, кадр в пределах логического экрана
+// или трейлер последним байтом файла
+bool looksLikeBlock(const uint8_t* data, size_t size, size_t pos, const GifStructure& gif) {
+    if (data[pos] == 0x3B) return pos + 1 == size;
+    if (data[pos] == 0x21 && pos + 2 < size) {
+        switch (data[pos + 1]) {
+        case 0xF9: return data[pos + 2] == 4;
+        case 0xFF: return data[pos + 2] == 11;
+        case 0x01: return data[pos + 2] == 12;
+        case 0xFE: return true;
+        default: return false;
+        }
+    }
+    if (data[pos] == 0x2C && pos + 10 <= size) {
+        uint32_t left = readLE16(data + pos + 1), top = readLE16(data + pos + 3);
+        uint32_t width = readLE16(data + pos + 5), height = readLE16(data + pos + 7);
+        return width > 0 && height > 0 && left + width <= gif.width && top + height <= gif.height;
+    }
+    return false;
+}
+
+size_t findNextBlock(const uint8_t* data, size_t size, size_t from, const GifStructure& gif) {
+    for (size_t pos = from; pos < size; ++pos) {
+        uint8_t b = data[pos];
+        if ((b == 0x21 || b == 0x2C || b == 0x3B) && looksLikeBlock(data, size, pos, gif)) return pos;
+    }
+    return size;
+}
+
+} // namespace
+
+bool parseGifStructure(const uint8_t* data, size_t size, GifStructure& gif) {
+    gif = GifStructure();
+    if (size < 13 || (std::memcmp(data, "GIF87a", 6) != 0 && std::memcmp(data, "GIF89a", 6) != 0)) {
+        return false;
+    }
+
+    // Логический экран и глобальная палитра
+    gif.width = readLE16(data + 6);
+    gif.height = readLE16(data + 8);
+    size_t pos = 13;
+    if (data[10] & 0x80) {
+        gif.globalColors = size_t(2) << (data[10] & 7);
+        pos += 3 * gif.globalColors;
+    }
+    if (pos > size) {
+        gif.blocks.push_back({ 0, size });
+        gif.truncated = true;
+        return true;
+    }
+    gif.blocks.push_back({ 0, pos });
+
+    while (pos < size) {
+        const size_t start = pos;
+        const uint8_t introducer = data[pos];
+
+        if (introducer == 0x3B) {
+            gif.blocks.push_back({ pos, 1 });
+            gif.trailerFound = true;
+            gif.trailerEnd = pos + 1;
+            break;
+        }
+
+        if (introducer == 0x21 && pos + 2 <= size) {
+            GifExtension extension;
+            extension.label = data[pos + 1];
+            pos += 2;
+            // Первый подблок расширения приложения — идентификатор (8 байт) и код (3 байта)
+            if (extension.label == 0xFF && pos + 12 <= size && data[pos] == 11) {
+                extension.application.assign(reinterpret_cast<const char*>(data + pos + 1), 11);
+                pos += 12;
+            }
+            bool complete = skipSubBlocks(data, size, pos, extension.dataBytes);
+            extension.range = { start, pos - start };
+            gif.blocks.push_back(extension.range);
+            gif.extensions.push_back(std::move(extension));
+            if (!complete) {
+                gif.truncated = true;
+                break;
+            }
+            continue;
+        }
+
+        if (introducer == 0x2C && pos + 10 <= size) {
+            // Дескриптор кадра, локальная палитра, размер кода LZW и подблоки
+            uint8_t flags = data[pos + 9];
+            pos += 10;
+            if (flags & 0x80) pos += 3 * (size_t(2) << (flags & 7));
+            if (pos >= size) {
+                gif.blocks.push_back({ start, size - start });
+                gif.truncated = true;
+                break;
+            }
+            uint8_t codeSize = data[pos++];
+            if (codeSize < 2 || codeSize > 8) gif.badCodeSizes++;
+            uint64_t lzwBytes = 0;
+            bool complete = skipSubBlocks(data, size, pos, lzwBytes);
+            gif.blocks.push_back({ start, pos - start });
+            gif.frames++;
+            if (!complete) {
+                gif.truncated = true;
+                break;
+            }
+            continue;
+        }
+
+        if (introducer == 0x21 || introducer == 0x2C) {
+            gif.truncated = true;
+            break;
+        }
+
+        // Байт не начинает блок: его и всё до следующего блока оставляем вне структуры
+        pos = findNextBlock(data, size, pos + 1, gif);
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+﻿#ifndef GIF_STRUCTURE_H
+#define GIF_STRUCTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "byte_ranges.h"
+
+// Блок расширения GIF (0x21): метка и суммарный объём данных подблоков
+struct GifExtension {
+    uint8_t label = 0;            // 0xF9 управление, 0xFE комментарий, 0xFF приложение, 0x01 текст
+    ByteRange range;              // от байта 0x21 до нулевого подблока включительно
+    uint64_t dataBytes = 0;       // данные подблоков без байтов длины
+    std::string application;      // идентификатор и код аутентификации (для 0xFF)
+};
+
+// Структура GIF: каждый разобранный блок попадает в blocks, поэтому
+// байты, не вошедшие ни в один блок, — данные вне структуры файла
+struct GifStructure {
+    uint16_t width = 0;
+    uint16_t height = 0;
+    size_t globalColors = 0;          // 0 — нет глобальной палитры
+    size_t frames = 0;
+    std::vector<GifExtension> extensions;
+    std::vector<ByteRange> blocks;    // заголовок, палитры, кадры, расширения, трейлер
+    size_t badCodeSizes = 0;          // кадры с недопустимым начальным размером кода LZW
+    bool trailerFound = false;
+    uint64_t trailerEnd = 0;          // позиция после байта 0x3B
+    bool truncated = false;           // блок обрывается концом файла
+};
+
+// Обход блоков GIF без декодирования LZW: подблоки данных кадров
+// пропускаются по байтам длины. Встретив байт, который не начинает блок,
+// обход продолжается со следующего правдоподобного блока, а пропущенные
+// байты не попадают в blocks. false — нет корректного заголовка
+bool parseGifStructure(const uint8_t* data, size_t size, GifStructure& gif);
+
+#endif // GIF_STRUCTURE_H
@@ -0,0 +1,78 @@
+﻿#include "huffman_code.h"
+
+namespace {
+
+inline uint32_t reverseBits(uint32_t code, int length) {
+    uint32_t r = 0;
+    for (int i = 0; i < length; ++i) {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+} // namespace
+
+bool CanonicalHuffman::build(const uint8_t* lengths, size_t count) {
+    int histogram[kMaxLength + 1] = {};
+    codes_ = 0;
+    maxLength_ = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (lengths[i] > kMaxLength) return false;
+        histogram[lengths[i]]++;
+        if (lengths[i]) {
+            codes_++;
+            if (lengths[i] > maxLength_) maxLength_ = lengths[i];
+        }
+    }
+
+    // Неравенство Крафта: left — число свободных последовательностей длины len
+    int left = 1;
+    for (int len = 1; len <= kMaxLength; ++len) {
+        left <<= 1;
+        left -= histogram[len];
+        if (left < 0) return false;
+    }
+    complete_ = codes_ > 0 && left == 0;
+
+    // Первый канонический код каждой длины
+    uint32_t nextCode[kMaxLength + 2] = {};
+    uint32_t code = 0;
+    histogram[0] = 0;
+    for (int len = 1; len <= kMaxLength; ++len) {
+        code = (code + histogram[len - 1]) << 1;
+        nextCode[len] = code;
+    }
+
+    const uint32_t primarySize = 1u << kPrimaryBits;
+    const int subBits = maxLength_ > kPrimaryBits ? maxLength_ - kPrimaryBits : 0;
+    table_.assign(primarySize, Entry());
+
+    for (size_t symbol = 0; symbol < count; ++symbol) {
+        int len = lengths[symbol];
+        if (len == 0) continue;
+        uint32_t reversed = reverseBits(nextCode[len]++, len);
+        Entry entry;
+        entry.value = static_cast<uint32_t>(symbol);
+        entry.length = static_cast<uint8_t>(len);
+
+        if (len <= kPrimaryBits) {
+            for (uint32_t i = reversed; i < primarySize; i += 1u << len) table_[i] = entry;
+            continue;
+        }
+
+        // Коды длиннее kPrimaryBits делят подтаблицу по первым kPrimaryBits битам
+        Entry& head = table_[reversed & (primarySize - 1)];
+        if (head.subBits == 0) {
+            head.value = static_cast<uint32_t>(table_.size());
+            head.subBits = static_cast<uint8_t>(subBits);
+            table_.resize(table_.size() + (size_t(1) << subBits));
+        }
+        uint32_t base = table_[reversed & (primarySize - 1)].value;
+        uint32_t step = 1u << (len - kPrimaryBits);
+        for (uint32_t i = reversed >> kPrimaryBits; i < (1u << subBits); i += step) {
+            table_[base + i] = entry;
+        }
+    }
+    return true;
+}
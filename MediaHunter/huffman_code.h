@@ -0,0 +1,53 @@
+﻿#ifndef HUFFMAN_CODE_H
+#define HUFFMAN_CODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Символ, декодированный по таблице; length == 0 — битам не соответствует ни один код
+struct HuffmanSymbol {
+    uint16_t symbol = 0;
+    uint8_t length = 0;
+};
+
+// Канонический код Хаффмана для потоков, где биты кода идут начиная с
+// младшего (DEFLATE, VP8L). Двухуровневая таблица: первые kPrimaryBits
+// битов дают символ сразу, более длинные коды — через подтаблицу.
+class CanonicalHuffman {
+public:
+    static constexpr int kPrimaryBits = 9;
+    static constexpr int kMaxLength = 15;
+
+    // lengths[i] — длина кода символа i (0 — символ не используется).
+    // false, если длины превышают неравенство Крафта (over-subscribed)
+    bool build(const uint8_t* lengths, size_t count);
+
+    // Сумма Крафта равна единице: каждой последовательности битов
+    // соответствует код. У неполных кодов часть последовательностей «пустые»
+    bool complete() const { return complete_; }
+    size_t codeCount() const { return codes_; }
+    int maxLength() const { return maxLength_; }
+
+    // bits — не менее maxLength() следующих битов потока
+    HuffmanSymbol decode(uint32_t bits) const {
+        const Entry& e = table_[bits & ((1u << kPrimaryBits) - 1)];
+        if (e.subBits == 0) return { static_cast<uint16_t>(e.value), e.length };
+        const Entry& s = table_[e.value + ((bits >> kPrimaryBits) & ((1u << e.subBits) - 1))];
+        return { static_cast<uint16_t>(s.value), s.length };
+    }
+
+private:
+    struct Entry {
+        uint32_t value = 0;    // символ или начало подтаблицы
+        uint8_t length = 0;    // длина кода
+        uint8_t subBits = 0;   // ненулевое — запись ссылается на подтаблицу
+    };
+
+    std::vector<Entry> table_;
+    bool complete_ = false;
+    size_t codes_ = 0;
+    int maxLength_ = 0;
+};
+
+#endif // HUFFMAN_CODE_H
@@ -0,0 +1,120 @@
+﻿#include "image_decoder.h"
+#include "buffer_pool.h"
+#include <climits>
+#include <cstring>
+
+namespace {
+
+// stb_image выделяет память под пиксели и распакованные данные при каждом
+// декодировании; блоки берутся из пула потока, а размер блока хранится в
+// заголовке перед данными, потому что STBI_FREE получает только указатель
+struct alignas(16) BlockHeader {
+    size_t capacity;     // размер блока пула вместе с заголовком
+    size_t reserved;
+};
+
+void* pixelPoolMalloc(size_t size) {
+    size_t capacity = 0;
+    uint8_t* block = BufferPool::allocate(sizeof(BlockHeader) + size, capacity);
+    if (!block) return nullptr;
+    auto* h = reinterpret_cast<BlockHeader*>(block);
+    h->capacity = capacity;
+    return h + 1;
+}
+
+void pixelPoolFree(void* p) {
+    if (!p) return;
+    BlockHeader* h = static_cast<BlockHeader*>(p) - 1;
+    BufferPool::release(reinterpret_cast<uint8_t*>(h), h->capacity);
+}
+
+void* pixelPoolRealloc(void* p, size_t size) {
+    if (!p) return pixelPoolMalloc(size);
+    BlockHeader* h = static_cast<BlockHeader*>(p) - 1;
+    const size_t usable = h->capacity - sizeof(BlockHeader);
+    if (usable >= size) return p;
+    void* grown = pixelPoolMalloc(size);
+    if (!grown) return nullptr;
+    std::memcpy(grown, p, usable);
+    pixelPoolFree(p);
+    return grown;
+}
+
+// Ограничение на объём декодированных пикселей одного изображения
+constexpr size_t kMaxDecodedBytes = 512ULL * 1024ULL * 1024ULL;
+
+} // namespace
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_STDIO
+#define STBI_NO_HDR
+#define STBI_MALLOC(sz) pixelPoolMalloc(sz)
+#define STBI_REALLOC(p, newsz) pixelPoolRealloc(p, newsz)
+#define STBI_FREE(p) pixelPoolFree(p)
+#include "stb_image.h"
+
+DecodedImage::~DecodedImage() {
+    release();
+}
+
+void DecodedImage::release() {
+    if (pixels_) {
+        stbi_image_free(pixels_);
+        pixels_ = nullptr;
+    }
+    width_ = height_ = channels_ = 0;
+}
+
+bool DecodedImage::decode(const uint8_t* data, size_t size, std::string& error) {
+    release();
+    if (!data || size == 0 || size > static_cast<size_t>(INT_MAX)) {
+        error = "неподдерживаемый размер данных";
+        return false;
+    }
+    int len = static_cast<int>(size);
+
+    int w = 0, h = 0, comp = 0;
+    if (!stbi_info_from_memory(data, len, &w, &h, &comp)) {
+        error = stbi_failure_reason() ? stbi_failure_reason() : "неизвестная ошибка";
+        return false;
+    }
+    // stb_image приводит 16-битные изображения к 8 битам, младшие биты теряются
+    if (stbi_is_16_bit_from_memory(data, len)) {
+        error = "16-битные изображения не поддерживаются пиксельным анализом";
+        return false;
+    }
+    if (static_cast<size_t>(w) * static_cast<size_t>(h) * static_cast<size_t>(comp) > kMaxDecodedBytes) {
+        error = "изображение слишком велико для декодирования";
+        return false;
+    }
+
+    pixels_ = stbi_load_from_memory(data, len, &width_, &height_, &channels_, 0);
+    if (!pixels_) {
+        error = stbi_failure_reason() ? stbi_failure_reason() : "неизвестная ошибка";
+        width_ = height_ = channels_ = 0;
+        return false;
+    }
+    return true;
+}
+
+const char* DecodedImage::channelName(int c) const {
+    if (channels_ <= 2) return c == 0 ? "Y" : "A";
+    static const char* names[] = { "R", "G", "B", "A" };
+    return (c >= 0 && c < 4) ? names[c] : "?";
+}
+
+SampleView DecodedImage::channel(int c) const {
+    SampleView view;
+    if (!pixels_ || c < 0 || c >= channels_) return view;
+    view.base = pixels_ + c;
+    view.width = static_cast<size_t>(width_);
+    view.height = static_cast<size_t>(height_);
+    view.step = static_cast<size_t>(channels_);
+    view.rowStride = static_cast<size_t>(width_) * channels_;
+    return view;
+}
+
+bool isDecodableImageFormat(const std::string& format) {
+    return format == "JPEG" || format == "PNG" || format == "BMP" ||
+        format == "GIF" || format == "PSD";
+}
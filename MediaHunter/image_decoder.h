@@ -0,0 +1,45 @@
+﻿#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "pixel_statistics.h"
+
+// Декодирование изображения в пиксели через stb_image (JPEG, PNG, BMP, GIF, PSD).
+// Буферы пикселей берутся из пула потока и возвращаются в него при уничтожении.
+class DecodedImage {
+public:
+    DecodedImage() = default;
+    ~DecodedImage();
+
+    DecodedImage(const DecodedImage&) = delete;
+    DecodedImage& operator=(const DecodedImage&) = delete;
+
+    // false и текст ошибки, если формат не поддерживается или изображение повреждено
+    bool decode(const uint8_t* data, size_t size, std::string& error);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int channels() const { return channels_; }
+
+    // Количество цветовых каналов без альфа-канала
+    int colorChannels() const { return (channels_ == 2 || channels_ == 4) ? channels_ - 1 : channels_; }
+    const char* channelName(int c) const;
+
+    // Канал c без копирования
+    SampleView channel(int c) const;
+
+private:
+    void release();
+
+    uint8_t* pixels_ = nullptr;
+    int width_ = 0;
+    int height_ = 0;
+    int channels_ = 0;
+};
+
+// Поддерживает ли декодер формат, определённый FileReader
+bool isDecodableImageFormat(const std::string& format);
+
+#endif // IMAGE_DECODER_H
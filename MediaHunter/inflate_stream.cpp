@@ -0,0 +1,512 @@
+﻿#include "inflate_stream.h"
+#include "huffman_code.h"
+#include "crc32.h"
+#include "buffer_pool.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kWindowSize = 32768;
+constexpr size_t kBufferSize = 2 * kWindowSize;
+constexpr size_t kMaxMatch = 258;
+
+const uint16_t kLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t kLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t kDistanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t kDistanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+const uint8_t kCodeLengthOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// Фиксированные коды блоков типа 1 (RFC 1951, 3.2.6)
+struct FixedCodes {
+    CanonicalHuffman literals;
+    CanonicalHuffman distances;
+
+    FixedCodes() {
+        uint8_t lengths[288];
+        std::fill(lengths, lengths + 144, uint8_t(8));
+        std::fill(lengths + 144, lengths + 256, uint8_t(9));
+        std::fill(lengths + 256, lengths + 280, uint8_t(7));
+        std::fill(lengths + 280, lengths + 288, uint8_t(8));
+        literals.build(lengths, 288);
+        std::fill(lengths, lengths + 30, uint8_t(5));
+        distances.build(lengths, 30);
+    }
+};
+
+const FixedCodes& fixedCodes() {
+    static const FixedCodes codes;
+    return codes;
+}
+
+class InflateState {
+public:
+    InflateState(const Inflater::Source& source, const Inflater::Sink& sink, uint64_t limit, Inflater::Format format)
+        : source_(source), sink_(sink), limit_(limit), format_(format), buffer_(kBufferSize) {}
+
+    Inflater::Result run();
+
+    uint64_t consumed() const { return fetched_ - static_cast<uint64_t>(count_ / 8); }
+    uint64_t produced() const { return std::min(produced_, limit_); }
+    uint64_t trailing() const { return trailing_; }
+    const std::string& error() const { return error_; }
+    const std::string& gzipName() const { return gzipName_; }
+    size_t gzipMembers() const { return members_; }
+
+private:
+    bool fail(Inflater::Result result, const char* message) {
+        result_ = result;
+        if (message) error_ = message;
+        return false;
+    }
+
+    // Подкачка битов из текущего и следующих фрагментов входа
+    void refill() {
+        while (count_ <= 56) {
+            if (cur_ == end_ && !nextFragment()) return;
+            bits_ |= static_cast<uint64_t>(*cur_++) << count_;
+            count_ += 8;
+            fetched_++;
+        }
+    }
+
+    bool nextFragment() {
+        if (eof_) return false;
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        while (source_(data, size)) {
+            if (data && size) {
+                cur_ = data;
+                end_ = data + size;
+                return true;
+            }
+        }
+        eof_ = true;
+        return false;
+    }
+
+    bool need(int n) {
+        if (count_ < n) refill();
+        return count_ >= n || fail(Inflater::Result::Truncated, "входные данные закончились раньше конца потока");
+    }
+
+    uint32_t take(int n) {
+        uint32_t v = static_cast<uint32_t>(bits_ & ((uint64_t(1) << n) - 1));
+        bits_ >>= n;
+        count_ -= n;
+        return v;
+    }
+
+    bool decodeSymbol(const CanonicalHuffman& code, int& symbol) {
+        if (count_ < CanonicalHuffman::kMaxLength) refill();
+        HuffmanSymbol s = code.decode(static_cast<uint32_t>(bits_));
+        if (s.length == 0 || s.length > count_) {
+            // Вход кончился посреди кода: недостающие биты читаются как нули
+            if (count_ < code.maxLength()) {
+                return fail(Inflater::Result::Truncated, "входные данные закончились раньше конца потока");
+            }
+            return fail(Inflater::Result::Error, "недопустимый код Хаффмана");
+        }
+        take(s.length);
+        symbol = s.symbol;
+        return true;
+    }
+
+    bool readHeader();
+    bool readTrailer();
+    bool readGzipHeader();
+    bool readGzipTrailer();
+    bool skipGzipString(std::string* text);
+    bool nextGzipMember();
+    bool storedBlock();
+    bool dynamicCodes(CanonicalHuffman& literals, CanonicalHuffman& distances);
+    bool codesBlock(const CanonicalHuffman& literals, const CanonicalHuffman& distances);
+    bool inflateBlocks();
+    bool flush();
+    bool slide();
+    void drainTrailing();
+
+    const Inflater::Source& source_;
+    const Inflater::Sink& sink_;
+    uint64_t limit_;
+    Inflater::Format format_;
+
+    const uint8_t* cur_ = nullptr;
+    const uint8_t* end_ = nullptr;
+    bool eof_ = false;
+    uint64_t bits_ = 0;
+    int count_ = 0;
+    uint64_t fetched_ = 0;
+
+    PooledBuffer buffer_;   // окно 32 КБ и текущая порция вывода
+    size_t pos_ = 0;
+    size_t flushed_ = 0;
+    uint64_t produced_ = 0;
+    uint64_t delivered_ = 0;
+    uint32_t adler_ = 1;
+    uint32_t crc_ = 0;
+    uint64_t memberStart_ = 0;  // вывод до текущего потока gzip
+    size_t members_ = 0;
+
+    uint64_t trailing_ = 0;
+    Inflater::Result result_ = Inflater::Result::Done;
+    std::string error_;
+    std::string gzipName_;
+};
+
+bool InflateState::flush() {
+    size_t n = pos_ - flushed_;
+    if (n == 0) return true;
+    bool overLimit = delivered_ + n > limit_;
+    if (overLimit) n = static_cast<size_t>(limit_ - delivered_);
+    if (format_ == Inflater::Format::Zlib) adler_ = computeAdler32(buffer_.data() + flushed_, n, adler_);
+    if (format_ == Inflater::Format::Gzip) crc_ = computeCrc32(buffer_.data() + flushed_, n, crc_);
+    if (n && sink_ && !sink_(buffer_.data() + flushed_, n)) {
+        return fail(Inflater::Result::Stopped, nullptr);
+    }
+    delivered_ += n;
+    flushed_ = pos_;
+    return !overLimit || fail(Inflater::Result::OutputLimit, "превышен допустимый объём распакованных данных");
+}
+
+// Отдаёт накопленный вывод и сохраняет последние 32 КБ как окно
+bool InflateState::slide() {
+    if (!flush()) return false;
+    size_t keep = std::min(pos_, kWindowSize);
+    std::memmove(buffer_.data(), buffer_.data() + pos_ - keep, keep);
+    pos_ = keep;
+    flushed_ = keep;
+    return true;
+}
+
+bool InflateState::readHeader() {
+    if (!need(16)) return false;
+    uint32_t cmf = take(8);
+    uint32_t flg = take(8);
+    if ((cmf & 15) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31 != 0) {
+        return fail(Inflater::Result::Error, "неверный заголовок zlib");
+    }
+    if (flg & 0x20) return fail(Inflater::Result::Error, "zlib-поток требует внешнего словаря");
+    return true;
+}
+
+bool InflateState::readTrailer() {
+    take(count_ & 7);
+    if (!need(32)) return false;
+    uint32_t stored = 0;
+    for (int i = 0; i < 4; ++i) stored = (stored << 8) | take(8);
+    if (stored != adler_) return fail(Inflater::Result::Error, "контрольная сумма Adler-32 не совпадает");
+    return true;
+}
+
+// Строка FNAME или FCOMMENT заголовка gzip до нулевого байта
+bool InflateState::skipGzipString(std::string* text) {
+    const size_t maxStored = 1024;
+    while (true) {
+        if (!need(8)) return false;
+        char c = static_cast<char>(take(8));
+        if (c == 0) return true;
+        if (text && text->size() < maxStored) text->push_back(c);
+    }
+}
+
+bool InflateState::readGzipHeader() {
+    if (!need(32)) return false;
+    uint32_t id1 = take(8);
+    uint32_t id2 = take(8);
+    uint32_t method = take(8);
+    uint32_t flags = take(8);
+    if (id1 != 0x1F || id2 != 0x8B || method != 8) return fail(Inflater::Result::Error, "неверный заголовок gzip");
+    if (flags & 0xE0) return fail(Inflater::Result::Error, "зарезервированные флаги заголовка gzip");
+    members_++;
+    // MTIME, XFL, OS
+    for (int i = 0; i < 6; ++i) {
+        if (!need(8)) return false;
+        take(8);
+    }
+    if (flags & 0x04) {
+        if (!need(16)) return false;
+        uint32_t extra = take(16);
+        for (uint32_t i = 0; i < extra; ++i) {
+            if (!need(8)) return false;
+            take(8);
+        }
+    }
+    if ((flags & 0x08) && !skipGzipString(members_ == 1 ? &gzipName_ : nullptr)) return false;
+    if ((flags & 0x10) && !skipGzipString(nullptr)) return false;
+    if (flags & 0x02) {
+        if (!need(16)) return false;
+        take(16);
+    }
+    return true;
+}
+
+// CRC-32 и длина вывода по модулю 2^32, обе в порядке little-endian
+bool InflateState::readGzipTrailer() {
+    take(count_ & 7);
+    if (!need(32)) return false;
+    uint32_t storedCrc = take(32);
+    if (!need(32)) return false;
+    uint32_t storedSize = take(32);
+    if (storedCrc != crc_) return fail(Inflater::Result::Error, "контрольная сумма CRC-32 gzip не совпадает");
+    if (storedSize != static_cast<uint32_t>(delivered_ - memberStart_)) return fail(Inflater::Result::Error, "длина данных gzip не совпадает");
+    return true;
+}
+
+// После трейлера может начинаться следующий поток gzip (cat a.gz b.gz):
+// его вывод продолжает тот же поток данных, а ссылки назад не выходят за
+// его начало
+bool InflateState::nextGzipMember() {
+    if (count_ < 16) refill();
+    if (count_ < 16 || (bits_ & 0xFFFF) != 0x8B1F) return false;
+    memberStart_ = produced_;
+    crc_ = 0;
+    return true;
+}
+
+bool InflateState::storedBlock() {
+    take(count_ & 7);
+    if (!need(32)) return false;
+    uint32_t len = take(16);
+    uint32_t nlen = take(16);
+    if (len != (~nlen & 0xFFFF)) return fail(Inflater::Result::Error, "повреждённая длина несжатого блока");
+
+    while (len > 0) {
+        if (pos_ == kBufferSize && !slide()) return false;
+        size_t room = std::min<size_t>(len, kBufferSize - pos_);
+        size_t n = 0;
+        // Сначала байты, уже загруженные в битовый буфер, затем — прямо из фрагмента
+        while (n < room && count_ >= 8) {
+            buffer_.data()[pos_ + n++] = static_cast<uint8_t>(take(8));
+        }
+        if (n < room) {
+            if (cur_ == end_ && !nextFragment()) {
+                return fail(Inflater::Result::Truncated, "входные данные закончились раньше конца потока");
+            }
+            size_t direct = std::min<size_t>(room - n, static_cast<size_t>(end_ - cur_));
+            std::memcpy(buffer_.data() + pos_ + n, cur_, direct);
+            cur_ += direct;
+            fetched_ += direct;
+            n += direct;
+        }
+        pos_ += n;
+        produced_ += n;
+        len -= static_cast<uint32_t>(n);
+        if (produced_ > limit_) return flush();
+    }
+    return true;
+}
+
+bool InflateState::dynamicCodes(CanonicalHuffman& literals, CanonicalHuffman& distances) {
+    if (!need(14)) return false;
+    int literalCount = static_cast<int>(take(5)) + 257;
+    int distanceCount = static_cast<int>(take(5)) + 1;
+    int codeLengthCount = static_cast<int>(take(4)) + 4;
+    if (literalCount > 286 || distanceCount > 30) {
+        return fail(Inflater::Result::Error, "неверное число кодов динамического блока");
+    }
+
+    uint8_t codeLengths[19] = {};
+    for (int i = 0; i < codeLengthCount; ++i) {
+        if (!need(3)) return false;
+        codeLengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(take(3));
+    }
+    CanonicalHuffman lengthCode;
+    if (!lengthCode.build(codeLengths, 19) || !lengthCode.complete()) {
+        return fail(Inflater::Result::Error, "неверный код длин кодов");
+    }
+
+    uint8_t lengths[286 + 30] = {};
+    int total = literalCount + distanceCount;
+    int n = 0;
+    while (n < total) {
+        int symbol = 0;
+        if (!decodeSymbol(lengthCode, symbol)) return false;
+        if (symbol < 16) {
+            lengths[n++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+        uint8_t value = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (n == 0) return fail(Inflater::Result::Error, "повтор длины без предыдущего кода");
+            if (!need(2)) return false;
+            value = lengths[n - 1];
+            repeat = 3 + static_cast<int>(take(2));
+        }
+        else if (symbol == 17) {
+            if (!need(3)) return false;
+            repeat = 3 + static_cast<int>(take(3));
+        }
+        else {
+            if (!need(7)) return false;
+            repeat = 11 + static_cast<int>(take(7));
+        }
+        if (n + repeat > total) return fail(Inflater::Result::Error, "повтор длин выходит за пределы таблицы");
+        std::fill(lengths + n, lengths + n + repeat, value);
+        n += repeat;
+    }
+    if (lengths[256] == 0) return fail(Inflater::Result::Error, "нет кода конца блока");
+
+    // Неполный код допустим только из единственного кода длины 1
+    auto valid = [](const CanonicalHuffman& code) {
+        return code.complete() || (code.codeCount() <= 1 && code.maxLength() <= 1);
+    };
+    if (!literals.build(lengths, literalCount) || !valid(literals) ||
+        !distances.build(lengths + literalCount, distanceCount) || !valid(distances)) {
+        return fail(Inflater::Result::Error, "неверные длины кодов литералов или расстояний");
+    }
+    return true;
+}
+
+bool InflateState::codesBlock(const CanonicalHuffman& literals, const CanonicalHuffman& distances) {
+    uint8_t* out = buffer_.data();
+    for (;;) {
+        if (pos_ > kBufferSize - kMaxMatch) {
+            if (!slide()) return false;
+            if (produced_ > limit_) return flush();
+        }
+        int symbol = 0;
+        if (!decodeSymbol(literals, symbol)) return false;
+        if (symbol < 256) {
+            out[pos_++] = static_cast<uint8_t>(symbol);
+            produced_++;
+            continue;
+        }
+        if (symbol == 256) return true;
+
+        symbol -= 257;
+        if (symbol >= 29) return fail(Inflater::Result::Error, "недопустимый код длины");
+        if (!need(kLengthExtra[symbol])) return false;
+        size_t length = kLengthBase[symbol] + take(kLengthExtra[symbol]);
+
+        int distSymbol = 0;
+        if (!decodeSymbol(distances, distSymbol)) return false;
+        if (distSymbol >= 30) return fail(Inflater::Result::Error, "недопустимый код расстояния");
+        if (!need(kDistanceExtra[distSymbol])) return false;
+        size_t distance = kDistanceBase[distSymbol] + take(kDistanceExtra[distSymbol]);
+        if (distance > produced_ - memberStart_ || distance > kWindowSize) {
+            return fail(Inflater::Result::Error, "ссылка за пределы окна");
+        }
+
+        uint8_t* dst = out + pos_;
+        const uint8_t* src = dst - distance;
+        if (distance >= length) {
+            std::memcpy(dst, src, length);
+        }
+        else {
+            for (size_t i = 0; i < length; ++i) dst[i] = src[i];
+        }
+        pos_ += length;
+        produced_ += length;
+    }
+}
+
+// Всё, что осталось во входе после конца потока
+void InflateState::drainTrailing() {
+    trailing_ = static_cast<uint64_t>(count_ / 8) + static_cast<uint64_t>(end_ - cur_);
+    cur_ = end_;
+    while (nextFragment()) {
+        trailing_ += static_cast<uint64_t>(end_ - cur_);
+        cur_ = end_;
+    }
+}
+
+// Блоки DEFLATE до последнего включительно
+bool InflateState::inflateBlocks() {
+    bool last = false;
+    while (!last) {
+        if (!need(3)) return false;
+        last = take(1) != 0;
+        uint32_t type = take(2);
+        bool ok;
+        if (type == 0) {
+            ok = storedBlock();
+        }
+        else if (type == 1) {
+            ok = codesBlock(fixedCodes().literals, fixedCodes().distances);
+        }
+        else if (type == 2) {
+            CanonicalHuffman literals;
+            CanonicalHuffman distances;
+            ok = dynamicCodes(literals, distances) && codesBlock(literals, distances);
+        }
+        else {
+            ok = fail(Inflater::Result::Error, "недопустимый тип блока");
+        }
+        if (!ok) {
+            if (result_ != Inflater::Result::Stopped) flush();
+            return false;
+        }
+    }
+    return flush();
+}
+
+Inflater::Result InflateState::run() {
+    if (format_ == Inflater::Format::Zlib && !readHeader()) return result_;
+    do {
+        if (format_ == Inflater::Format::Gzip && !readGzipHeader()) return result_;
+        if (!inflateBlocks()) return result_;
+        if (format_ == Inflater::Format::Zlib && !readTrailer()) return result_;
+        if (format_ == Inflater::Format::Gzip && !readGzipTrailer()) return result_;
+    } while (format_ == Inflater::Format::Gzip && nextGzipMember());
+    drainTrailing();
+    return Inflater::Result::Done;
+}
+
+} // namespace
+
+Inflater::Result Inflater::run(const Source& source, const Sink& sink) {
+    InflateState state(source, sink, outputLimit_, format_);
+    Result result = state.run();
+    consumed_ = state.consumed();
+    produced_ = state.produced();
+    trailing_ = state.trailing();
+    error_ = state.error();
+    gzipName_ = state.gzipName();
+    gzipMembers_ = state.gzipMembers();
+    return result;
+}
+
+Inflater::Result Inflater::run(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    bool given = false;
+    Source source = [&](const uint8_t*& chunk, size_t& chunkSize) {
+        if (given) return false;
+        given = true;
+        chunk = data;
+        chunkSize = size;
+        return true;
+    };
+    Sink sink = [&](const uint8_t* chunk, size_t chunkSize) {
+        out.insert(out.end(), chunk, chunk + chunkSize);
+        return true;
+    };
+    return run(source, sink);
+}
+
+uint32_t computeAdler32(const uint8_t* data, size_t size, uint32_t adler) {
+    const uint32_t mod = 65521;
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        // 5552 — наибольшее n, при котором сумма b не переполняет 32 бита
+        size_t n = std::min<size_t>(size, 5552);
+        size -= n;
+        while (n--) {
+            a += *data++;
+            b += a;
+        }
+        a %= mod;
+        b %= mod;
+    }
+    return (b << 16) | a;
+}
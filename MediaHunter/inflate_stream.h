@@ -0,0 +1,60 @@
+﻿#ifndef INFLATE_STREAM_H
+#define INFLATE_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Потоковая распаковка DEFLATE (RFC 1951), zlib (RFC 1950) и gzip (RFC 1952)
+// с ограничением объёма вывода. Вход читается фрагментами из источника без копирования,
+// вывод передаётся приёмнику порциями; в памяти держится только окно 32 КБ,
+// поэтому распаковка «бомб» не требует памяти сверх фиксированного буфера.
+class Inflater {
+public:
+    enum class Format { Raw, Zlib, Gzip };
+
+    enum class Result {
+        Done,          // поток завершён (и контрольная сумма совпала для zlib)
+        Truncated,     // входные данные закончились раньше конца потока
+        OutputLimit,   // превышен допустимый объём вывода
+        Stopped,       // приёмник прервал распаковку
+        Error          // повреждённый поток, см. error()
+    };
+
+    // Следующий фрагмент входа; false — данных больше нет
+    using Source = std::function<bool(const uint8_t*& data, size_t& size)>;
+    // Очередная порция вывода; false — остановить распаковку
+    using Sink = std::function<bool(const uint8_t* data, size_t size)>;
+
+    Inflater(Format format, uint64_t outputLimit) : format_(format), outputLimit_(outputLimit) {}
+
+    // sink может быть пустым: вывод только подсчитывается
+    Result run(const Source& source, const Sink& sink);
+
+    // Распаковка одного буфера с добавлением вывода в out
+    Result run(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+    uint64_t inputConsumed() const { return consumed_; }     // байтов потока, включая заголовок и сумму
+    uint64_t outputProduced() const { return produced_; }
+    uint64_t trailingInput() const { return trailing_; }     // байтов входа после конца потока
+    const std::string& error() const { return error_; }
+    const std::string& gzipName() const { return gzipName_; } // поле FNAME первого заголовка gzip
+    size_t gzipMembers() const { return gzipMembers_; }       // потоков gzip, идущих подряд
+
+private:
+    Format format_;
+    uint64_t outputLimit_;
+    uint64_t consumed_ = 0;
+    uint64_t produced_ = 0;
+    uint64_t trailing_ = 0;
+    std::string error_;
+    std::string gzipName_;
+    size_t gzipMembers_ = 0;
+};
+
+// Контрольная сумма Adler-32 (RFC 1950); adler — значение предыдущей части
+uint32_t computeAdler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+
+#endif // INFLATE_STREAM_H
@@ -0,0 +1,478 @@
+﻿#include "isobmff_structure.h"
+#include <algorithm>
+#include <array>
+#include <map>
+#include "fourcc.h"
+
+namespace {
+
+// Глубже вложенность боксов в реальных файлах не встречается
+const int kMaxDepth = 24;
+
+inline uint16_t readBE16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t readBE32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline uint64_t readBE64(const uint8_t* p) {
+    return (uint64_t(readBE32(p)) << 32) | readBE32(p + 4);
+}
+
+// Боксы, данные которых состоят только из вложенных боксов
+constexpr auto kContainers = makeFourCCSet(std::array<uint32_t, 15>{
+    fourCC("moov"), fourCC("trak"), fourCC("mdia"), fourCC("minf"), fourCC("stbl"),
+    fourCC("edts"), fourCC("dinf"), fourCC("udta"), fourCC("mvex"), fourCC("moof"),
+    fourCC("traf"), fourCC("mfra"), fourCC("iprp"), fourCC("ipco"), fourCC("sinf") });
+
+// Последовательное чтение полей полного бокса с проверкой границ
+class FieldReader {
+public:
+    FieldReader(const uint8_t* data, uint64_t size) : data_(data), left_(size) {}
+
+    // Целое длиной bytes (0–8) байт; при выходе за границу ok() станет false
+    uint64_t read(size_t bytes) {
+        if (bytes > left_) {
+            ok_ = false;
+            left_ = 0;
+            return 0;
+        }
+        uint64_t v = 0;
+        for (size_t i = 0; i < bytes; ++i) v = (v << 8) | data_[i];
+        data_ += bytes;
+        left_ -= bytes;
+        return v;
+    }
+
+    const uint8_t* position() const { return data_; }
+    uint64_t left() const { return left_; }
+    bool ok() const { return ok_; }
+
+private:
+    const uint8_t* data_;
+    uint64_t left_;
+    bool ok_ = true;
+};
+
+// Таблицы сэмплов дорожки. Записи читаются прямо из отображения файла
+struct TrackTables {
+    const uint8_t* offsets = nullptr;    // stco или co64
+    uint32_t chunkCount = 0;
+    size_t offsetSize = 0;
+    const uint8_t* stsc = nullptr;
+    uint32_t stscCount = 0;
+    const uint8_t* sizes = nullptr;      // stsz или stz2; nullptr — размер постоянный
+    uint32_t sampleCount = 0;
+    uint32_t constantSize = 0;
+    unsigned sizeBits = 0;
+    bool haveOffsets = false;
+    bool haveStsc = false;
+    bool haveSizes = false;
+    bool broken = false;                 // таблица не помещается в бокс
+
+    uint64_t sampleSize(uint64_t i) const {
+        if (!sizes) return constantSize;
+        switch (sizeBits) {
+        case 32: return readBE32(sizes + 4 * i);
+        case 16: return readBE16(sizes + 2 * i);
+        case 8: return sizes[i];
+        default: return (i & 1) ? (sizes[i / 2] & 0x0F) : (sizes[i / 2] >> 4);
+        }
+    }
+
+    uint64_t chunkOffset(uint32_t i) const {
+        return offsetSize == 8 ? readBE64(offsets + 8 * uint64_t(i)) : readBE32(offsets + 4 * uint64_t(i));
+    }
+};
+
+class IsoWalker {
+public:
+    IsoWalker(const uint8_t* data, size_t size, IsoBmffStructure& iso)
+        : data_(data), size_(size), iso_(iso) {}
+
+    void walkTopLevel() {
+        uint64_t pos = 0;
+        IsoBox box;
+        while (readHeader(pos, size_, box)) {
+            if (box.range.length > size_ - pos) {
+                iso_.truncated = true;
+                box.range.length = size_ - pos;
+            }
+            iso_.topLevel.push_back(box);
+            iso_.boxes++;
+            iso_.boxesEnd = box.range.end();
+            if (box.range.length < box.headerSize) break;   // файл обрывается внутри заголовка
+            handle(box, 0);
+            pos = box.range.end();
+        }
+        resolveOpenExtents();
+    }
+
+    // Заголовок бокса в [pos, end); длина может выходить за end — проверяет вызывающий
+    bool readHeader(uint64_t pos, uint64_t end, IsoBox& box) const {
+        if (pos > end || end - pos < 8) return false;
+        const uint8_t* p = data_ + pos;
+        uint64_t length = readBE32(p);
+        box.type = readBE32(p + 4);
+        box.headerSize = 8;
+        if (length == 1) {
+            if (end - pos < 16) return false;
+            length = readBE64(p + 8);
+            box.headerSize = 16;
+        }
+        else if (length == 0) {
+            length = end - pos;                 // до конца файла или родителя
+        }
+        if (box.type == fourCC("uuid")) box.headerSize += 16;
+        if (length < box.headerSize) return false;
+        box.range = { pos, length };
+        return true;
+    }
+
+private:
+    void walk(uint64_t begin, uint64_t end, int depth) {
+        if (depth >= kMaxDepth) return;
+        uint64_t pos = begin;
+        while (end - pos >= 8) {
+            IsoBox box;
+            if (!readHeader(pos, end, box) || box.range.length > end - pos) {
+                iso_.malformedBoxes++;
+                return;
+            }
+            iso_.boxes++;
+            handle(box, depth);
+            pos = box.range.end();
+        }
+    }
+
+    void handle(const IsoBox& box, int depth) {
+        const uint32_t type = box.type;
+        const uint64_t payload = box.payload();
+        const uint64_t end = box.range.end();
+        const uint8_t* p = data_ + payload;
+        const uint64_t n = end - payload;
+
+        if (type == fourCC("mdat")) {
+            iso_.mediaData.push_back({ payload, n });
+        }
+        else if (type == fourCC("free") || type == fourCC("skip") || type == fourCC("wide")) {
+            iso_.freeBoxes.push_back(box);
+        }
+        else if (type == fourCC("ftyp") && depth == 0) {
+            if (n >= 8) {
+                iso_.majorBrand = readBE32(p);
+                for (uint64_t i = 8; i + 4 <= n && iso_.compatibleBrands.size() < 64; i += 4) {
+                    iso_.compatibleBrands.push_back(readBE32(p + i));
+                }
+            }
+        }
+        else if (type == fourCC("trak")) {
+            if (inTrack_) return;
+            iso_.tracks++;
+            inTrack_ = true;
+            tables_ = TrackTables();
+            walk(payload, end, depth + 1);
+            resolveTrack();
+            inTrack_ = false;
+        }
+        else if (type == fourCC("moof")) {
+            iso_.fragments++;
+            moofStart_ = box.range.offset;
+            trafIndex_ = 0;
+            prevTrafEnd_ = moofStart_;
+            walk(payload, end, depth + 1);
+        }
+        else if (type == fourCC("traf")) {
+            haveTfhd_ = false;
+            haveDefaultSize_ = false;
+            trafBroken_ = false;
+            nextDataPos_ = prevTrafEnd_;
+            walk(payload, end, depth + 1);
+            prevTrafEnd_ = nextDataPos_;
+            trafIndex_++;
+        }
+        else if (type == fourCC("meta")) {
+            // В ISO meta — полный бокс, в QuickTime данные сразу начинаются с hdlr
+            uint64_t skip = (n >= 8 && readBE32(p + 4) == fourCC("hdlr")) ? 0 : 4;
+            if (n >= skip) walk(payload + skip, end, depth + 1);
+        }
+        else if (kContainers.contains(type)) {
+            walk(payload, end, depth + 1);
+        }
+        else if (inTrack_) {
+            parseSampleTable(type, p, n);
+        }
+        else if (type == fourCC("trex")) {
+            FieldReader r(p, n);
+            r.read(4);
+            uint32_t trackId = static_cast<uint32_t>(r.read(4));
+            r.read(8);
+            uint32_t defaultSize = static_cast<uint32_t>(r.read(4));
+            if (r.ok()) trexSizes_[trackId] = defaultSize;
+        }
+        else if (type == fourCC("tfhd")) {
+            parseTfhd(p, n);
+        }
+        else if (type == fourCC("trun")) {
+            parseTrun(p, n);
+        }
+        else if (type == fourCC("iloc")) {
+            parseIloc(p, n);
+        }
+    }
+
+    void parseSampleTable(uint32_t type, const uint8_t* p, uint64_t n) {
+        TrackTables& t = tables_;
+        if (n < 8) {
+            if (type == fourCC("stco") || type == fourCC("co64") || type == fourCC("stsc") ||
+                type == fourCC("stsz") || type == fourCC("stz2")) t.broken = true;
+            return;
+        }
+        uint32_t count = readBE32(p + 4);
+        if (type == fourCC("stco") || type == fourCC("co64")) {
+            t.offsetSize = type == fourCC("co64") ? 8 : 4;
+            t.haveOffsets = true;
+            t.chunkCount = count;
+            t.offsets = p + 8;
+            if (uint64_t(count) * t.offsetSize > n - 8) t.broken = true;
+        }
+        else if (type == fourCC("stsc")) {
+            t.haveStsc = true;
+            t.stscCount = count;
+            t.stsc = p + 8;
+            if (uint64_t(count) * 12 > n - 8) t.broken = true;
+        }
+        else if (type == fourCC("stsz")) {
+            if (n < 12) {
+                t.broken = true;
+                return;
+            }
+            t.haveSizes = true;
+            t.constantSize = count;
+            t.sampleCount = readBE32(p + 8);
+            t.sizeBits = 32;
+            t.sizes = t.constantSize == 0 ? p + 12 : nullptr;
+            if (t.sizes && uint64_t(t.sampleCount) * 4 > n - 12) t.broken = true;
+        }
+        else if (type == fourCC("stz2")) {
+            if (n < 12) {
+                t.broken = true;
+                return;
+            }
+            t.haveSizes = true;
+            t.sizeBits = p[7];
+            t.sampleCount = readBE32(p + 8);
+            t.sizes = p + 12;
+            if ((t.sizeBits != 4 && t.sizeBits != 8 && t.sizeBits != 16) ||
+                (uint64_t(t.sampleCount) * t.sizeBits + 7) / 8 > n - 12) t.broken = true;
+        }
+    }
+
+    // Чанк i содержит samples_per_chunk сэмплов из записи stsc, к которой он
+    // относится; их размеры дают длину чанка, начинающегося по смещению из stco
+    void resolveTrack() {
+        const TrackTables& t = tables_;
+        if (t.chunkCount == 0 && t.sampleCount == 0 && !t.broken) return;   // дорожка фрагментированного файла
+        if (t.broken || !t.haveOffsets || !t.haveStsc || !t.haveSizes || t.stscCount == 0 ||
+            readBE32(t.stsc) != 1) {
+            iso_.incompleteTables++;
+            return;
+        }
+        uint64_t sample = 0;
+        uint32_t entry = 0;
+        for (uint64_t chunk = 1; chunk <= t.chunkCount; ++chunk) {
+            while (entry + 1 < t.stscCount && readBE32(t.stsc + 12 * uint64_t(entry + 1)) <= chunk) ++entry;
+            uint64_t perChunk = std::min<uint64_t>(readBE32(t.stsc + 12 * uint64_t(entry) + 4), t.sampleCount - sample);
+            uint64_t length = 0;
+            if (t.sizes) {
+                for (uint64_t k = 0; k < perChunk; ++k) length += t.sampleSize(sample + k);
+            }
+            else {
+                length = perChunk * t.constantSize;
+            }
+            sample += perChunk;
+            addReference(t.chunkOffset(static_cast<uint32_t>(chunk - 1)), length);
+        }
+        iso_.chunks += t.chunkCount;
+        iso_.samples += sample;
+    }
+
+    void parseTfhd(const uint8_t* p, uint64_t n) {
+        FieldReader r(p, n);
+        uint32_t flags = static_cast<uint32_t>(r.read(4)) & 0xFFFFFF;
+        uint32_t trackId = static_cast<uint32_t>(r.read(4));
+        uint64_t baseOffset = (flags & 0x01) ? r.read(8) : 0;
+        if (flags & 0x02) r.read(4);
+        if (flags & 0x08) r.read(4);
+        uint64_t defaultSize = (flags & 0x10) ? r.read(4) : 0;
+        if (!r.ok()) return;
+
+        haveTfhd_ = true;
+        // Базовое смещение: явное, начало moof или конец данных предыдущего traf
+        if (flags & 0x01) baseDataOffset_ = baseOffset;
+        else if ((flags & 0x20000) || trafIndex_ == 0) baseDataOffset_ = moofStart_;
+        else baseDataOffset_ = prevTrafEnd_;
+        nextDataPos_ = baseDataOffset_;
+
+        haveDefaultSize_ = (flags & 0x10) != 0;
+        defaultSize_ = static_cast<uint32_t>(defaultSize);
+        if (!haveDefaultSize_) {
+            auto it = trexSizes_.find(trackId);
+            if (it != trexSizes_.end()) {
+                haveDefaultSize_ = true;
+                defaultSize_ = it->second;
+            }
+        }
+    }
+
+    void parseTrun(const uint8_t* p, uint64_t n) {
+        FieldReader r(p, n);
+        uint32_t flags = static_cast<uint32_t>(r.read(4)) & 0xFFFFFF;
+        uint32_t count = static_cast<uint32_t>(r.read(4));
+        int32_t dataOffset = static_cast<int32_t>(static_cast<uint32_t>((flags & 0x01) ? r.read(4) : 0));
+        if (flags & 0x04) r.read(4);
+        size_t entrySize = 0, sizeField = 0;
+        if (flags & 0x100) entrySize += 4;
+        if (flags & 0x200) {
+            sizeField = entrySize;
+            entrySize += 4;
+        }
+        if (flags & 0x400) entrySize += 4;
+        if (flags & 0x800) entrySize += 4;
+
+        if (!r.ok() || !haveTfhd_ || trafBroken_ || uint64_t(count) * entrySize > r.left() ||
+            (!(flags & 0x200) && !haveDefaultSize_)) {
+            iso_.incompleteTables++;
+            trafBroken_ = true;
+            return;
+        }
+
+        uint64_t pos = nextDataPos_;
+        if (flags & 0x01) {
+            if (dataOffset < 0 && uint64_t(-int64_t(dataOffset)) > baseDataOffset_) {
+                iso_.badReferences++;
+                trafBroken_ = true;
+                return;
+            }
+            pos = baseDataOffset_ + dataOffset;
+        }
+        uint64_t length = 0;
+        if (flags & 0x200) {
+            const uint8_t* entries = r.position();
+            for (uint32_t i = 0; i < count; ++i) length += readBE32(entries + uint64_t(i) * entrySize + sizeField);
+        }
+        else {
+            length = uint64_t(count) * defaultSize_;
+        }
+        addReference(pos, length);
+        nextDataPos_ = pos + length;
+        iso_.samples += count;
+    }
+
+    // Экстенты элементов HEIF/AVIF. Учитываются только данные в этом же файле
+    // (construction_method 0, data_reference_index 0); idat-экстенты лежат в meta
+    void parseIloc(const uint8_t* p, uint64_t n) {
+        FieldReader r(p, n);
+        unsigned version = static_cast<unsigned>(r.read(4) >> 24);
+        unsigned sizes = static_cast<unsigned>(r.read(2));
+        size_t offsetSize = (sizes >> 12) & 0xF, lengthSize = (sizes >> 8) & 0xF;
+        size_t baseOffsetSize = (sizes >> 4) & 0xF, indexSize = version >= 1 ? (sizes & 0xF) : 0;
+        if (version > 2 || offsetSize > 8 || lengthSize > 8 || baseOffsetSize > 8 || indexSize > 8) {
+            iso_.incompleteTables++;
+            return;
+        }
+        uint64_t itemCount = r.read(version < 2 ? 2 : 4);
+        for (uint64_t i = 0; i < itemCount && r.ok(); ++i) {
+            r.read(version < 2 ? 2 : 4);
+            unsigned method = version >= 1 ? static_cast<unsigned>(r.read(2) & 0xF) : 0;
+            uint64_t dataRef = r.read(2);
+            uint64_t baseOffset = r.read(baseOffsetSize);
+            uint64_t extentCount = r.read(2);
+            bool local = method == 0 && dataRef == 0 && extentCount > 0;
+            for (uint64_t e = 0; e < extentCount && r.ok(); ++e) {
+                r.read(indexSize);
+                uint64_t offset = r.read(offsetSize);
+                uint64_t length = r.read(lengthSize);
+                if (!local || !r.ok()) continue;
+                if (baseOffset > UINT64_MAX - offset) {
+                    iso_.badReferences++;
+                }
+                else if (length == 0) {
+                    openExtents_.push_back(baseOffset + offset);   // до конца mdat
+                }
+                else {
+                    addReference(baseOffset + offset, length);
+                }
+            }
+            if (local && r.ok()) iso_.items++;
+        }
+        if (!r.ok()) iso_.incompleteTables++;
+    }
+
+    void resolveOpenExtents() {
+        for (uint64_t offset : openExtents_) {
+            for (const ByteRange& mdat : iso_.mediaData) {
+                if (offset >= mdat.offset && offset < mdat.end()) {
+                    addReference(offset, mdat.end() - offset);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Соседние чанки одной дорожки обычно идут подряд, поэтому смежные
+    // диапазоны объединяются сразу — список остаётся коротким
+    void addReference(uint64_t offset, uint64_t length) {
+        if (length == 0) return;
+        if (offset > size_ || length > size_ - offset) {
+            iso_.badReferences++;
+            return;
+        }
+        if (!iso_.referenced.empty() && iso_.referenced.back().end() == offset) {
+            iso_.referenced.back().length += length;
+        }
+        else {
+            iso_.referenced.push_back({ offset, length });
+        }
+    }
+
+    const uint8_t* data_;
+    uint64_t size_;
+    IsoBmffStructure& iso_;
+
+    bool inTrack_ = false;
+    TrackTables tables_;
+
+    std::map<uint32_t, uint32_t> trexSizes_;     // track_ID → размер сэмпла по умолчанию
+    uint64_t moofStart_ = 0;
+    size_t trafIndex_ = 0;
+    uint64_t prevTrafEnd_ = 0;
+    bool haveTfhd_ = false;
+    bool haveDefaultSize_ = false;
+    uint32_t defaultSize_ = 0;
+    uint64_t baseDataOffset_ = 0;
+    uint64_t nextDataPos_ = 0;
+    bool trafBroken_ = false;
+
+    std::vector<uint64_t> openExtents_;
+};
+
+bool isBoxTypeChar(uint8_t c) {
+    return (c >= 0x20 && c < 0x7F) || c == 0xA9;     // © в типах QuickTime
+}
+
+} // namespace
+
+bool parseIsoBmffStructure(const uint8_t* data, size_t size, IsoBmffStructure& iso) {
+    iso = IsoBmffStructure();
+    IsoWalker walker(data, size, iso);
+    IsoBox first;
+    if (!walker.readHeader(0, size, first)) return false;
+    for (int i = 0; i < 4; ++i) {
+        if (!isBoxTypeChar(data[4 + i])) return false;
+    }
+    walker.walkTopLevel();
+    return true;
+}
@@ -0,0 +1,49 @@
+﻿#ifndef ISOBMFF_STRUCTURE_H
+#define ISOBMFF_STRUCTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "byte_ranges.h"
+
+// Бокс ISO-BMFF: заголовок (8 байт, 16 с 64-битным размером, ещё 16 для uuid) и данные
+struct IsoBox {
+    uint32_t type = 0;
+    ByteRange range;              // весь бокс вместе с заголовком
+    uint32_t headerSize = 0;
+
+    uint64_t payload() const { return range.offset + headerSize; }
+};
+
+// Структура MP4/MOV/HEIF/AVIF. В referenced собраны байты, на которые
+// ссылаются таблицы сэмплов (stco/co64 + stsc + stsz/stz2), фрагменты
+// (tfhd + trun) и экстенты элементов (iloc); с mediaData они сравниваются
+// для поиска участков mdat, не принадлежащих ни одному сэмплу
+struct IsoBmffStructure {
+    uint32_t majorBrand = 0;
+    std::vector<uint32_t> compatibleBrands;
+    std::vector<IsoBox> topLevel;
+    std::vector<IsoBox> freeBoxes;        // free, skip и wide на любом уровне
+    std::vector<ByteRange> mediaData;     // данные боксов mdat
+    std::vector<ByteRange> referenced;
+
+    size_t boxes = 0;
+    size_t tracks = 0;
+    size_t chunks = 0;
+    uint64_t samples = 0;
+    size_t fragments = 0;                 // боксов moof
+    size_t items = 0;                     // элементов iloc с данными в файле
+    size_t badReferences = 0;             // сэмплы и экстенты за пределами файла
+    size_t incompleteTables = 0;          // дорожки и фрагменты без размеров сэмплов
+    size_t malformedBoxes = 0;            // вложенный бокс выходит за пределы родителя
+    bool truncated = false;               // бокс верхнего уровня обрывается концом файла
+    uint64_t boxesEnd = 0;                // конец последнего бокса верхнего уровня
+};
+
+// Обход боксов по заголовкам с 64-битными размерами и вложенностью. Данные
+// mdat не читаются: затрагиваются только заголовки и таблицы сэмплов, поэтому
+// многогигабайтный файл, отображённый в память, разбирается без чтения
+// медиаданных. false — файл не начинается с бокса
+bool parseIsoBmffStructure(const uint8_t* data, size_t size, IsoBmffStructure& iso);
+
+#endif // ISOBMFF_STRUCTURE_H
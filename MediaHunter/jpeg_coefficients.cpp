@@ -0,0 +1,535 @@
+﻿#include "jpeg_coefficients.h"
+#include "jpeg_segments.h"
+#include "pixel_statistics.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+constexpr int kFastBits = 9;
+constexpr int kFastSize = 1 << kFastBits;
+
+// Каноническая таблица Хаффмана. Первые kFastBits битов потока дают символ
+// одним обращением к fast; для AC-таблиц fastAc сразу содержит и серию
+// нулей, и значение коэффициента, если код вместе с битами значения
+// укладывается в kFastBits.
+struct HuffmanTable {
+    bool defined = false;
+    int symbolCount = 0;
+    uint8_t fast[kFastSize];
+    int16_t fastAc[kFastSize];     // (значение << 8) | (серия << 4) | длина; 0 — нет записи
+    uint16_t code[256];
+    uint8_t size[257];
+    uint8_t values[256];
+    uint32_t maxCode[18];          // граница кодов длины l, выровненная к 16 битам
+    int delta[17];                 // индекс символа минус код для длины l
+};
+
+bool buildHuffmanTable(HuffmanTable& h, const uint8_t counts[16], const uint8_t* symbols) {
+    int k = 0;
+    for (int i = 0; i < 16; ++i) {
+        for (int j = 0; j < counts[i]; ++j) {
+            if (k >= 256) return false;
+            h.size[k++] = static_cast<uint8_t>(i + 1);
+        }
+    }
+    h.size[k] = 0;
+    h.symbolCount = k;
+    std::memcpy(h.values, symbols, k);
+
+    uint32_t code = 0;
+    k = 0;
+    for (int len = 1; len <= 16; ++len) {
+        h.delta[len] = k - static_cast<int>(code);
+        if (h.size[k] == len) {
+            while (h.size[k] == len) {
+                h.code[k++] = static_cast<uint16_t>(code++);
+            }
+            // Коды длины len не должны выходить за len битов
+            if (code - 1 >= (1u << len)) return false;
+        }
+        h.maxCode[len] = code << (16 - len);
+        code <<= 1;
+    }
+    h.maxCode[17] = 0xFFFFFFFFu;
+
+    std::memset(h.fast, 255, sizeof(h.fast));
+    for (int i = 0; i < h.symbolCount; ++i) {
+        int len = h.size[i];
+        if (len > kFastBits) continue;
+        int first = h.code[i] << (kFastBits - len);
+        int span = 1 << (kFastBits - len);
+        for (int j = 0; j < span; ++j) h.fast[first + j] = static_cast<uint8_t>(i);
+    }
+
+    for (int i = 0; i < kFastSize; ++i) {
+        h.fastAc[i] = 0;
+        int idx = h.fast[i];
+        if (idx == 255) continue;
+        int rs = h.values[idx];
+        int run = rs >> 4;
+        int magnitude = rs & 15;
+        int len = h.size[idx];
+        if (magnitude == 0 || len + magnitude > kFastBits) continue;
+        int v = ((i << len) & (kFastSize - 1)) >> (kFastBits - magnitude);
+        if (v < (1 << (magnitude - 1))) v -= (1 << magnitude) - 1;
+        if (v >= -128 && v <= 127) {
+            h.fastAc[i] = static_cast<int16_t>(v * 256 + run * 16 + len + magnitude);
+        }
+    }
+    h.defined = true;
+    return true;
+}
+
+// Битовый поток энтропийных данных: снимает байт-стаффинг FF 00 и
+// останавливается на маркере, дальше подставляя нули
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    void reset(size_t pos) {
+        pos_ = pos;
+        bits_ = 0;
+        count_ = 0;
+        marker_ = false;
+        padding_ = 0;
+    }
+
+    // Позиция первого непрочитанного байта (на маркере, если он достигнут)
+    size_t position() const { return pos_; }
+
+    // Декодер ушёл за маркер дальше, чем может занимать выравнивание
+    bool exhausted() const { return padding_ > 16; }
+
+    int decode(const HuffmanTable& h) {
+        if (count_ < 16) fill();
+        int idx = h.fast[peek(kFastBits)];
+        if (idx < 255) {
+            consume(h.size[idx]);
+            return h.values[idx];
+        }
+        uint32_t word = peek(16);
+        int len = kFastBits + 1;
+        while (word >= h.maxCode[len]) ++len;
+        if (len > 16) return -1;
+        int symbol = static_cast<int>(peek(len)) + h.delta[len];
+        if (symbol < 0 || symbol >= h.symbolCount) return -1;
+        consume(len);
+        return h.values[symbol];
+    }
+
+    // Значение коэффициента из s дополнительных битов (F.2.2.1, EXTEND)
+    int receiveExtend(int s) {
+        if (count_ < s) fill();
+        int v = static_cast<int>(peek(s));
+        consume(s);
+        return v < (1 << (s - 1)) ? v - (1 << s) + 1 : v;
+    }
+
+    uint32_t peekFast() {
+        if (count_ < 16) fill();
+        return peek(kFastBits);
+    }
+
+    void consume(int n) {
+        bits_ <<= n;
+        count_ -= n;
+    }
+
+private:
+    uint32_t peek(int n) const { return static_cast<uint32_t>(bits_ >> (64 - n)); }
+
+    void fill() {
+        while (count_ <= 56) {
+            bits_ |= static_cast<uint64_t>(nextByte()) << (56 - count_);
+            count_ += 8;
+        }
+    }
+
+    uint8_t nextByte() {
+        if (!marker_ && pos_ < size_) {
+            uint8_t b = data_[pos_];
+            if (b != 0xFF) {
+                pos_++;
+                return b;
+            }
+            if (pos_ + 1 < size_ && data_[pos_ + 1] == 0x00) {
+                pos_ += 2;
+                return 0xFF;
+            }
+        }
+        marker_ = true;
+        padding_++;
+        return 0;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    uint64_t bits_ = 0;
+    int count_ = 0;
+    bool marker_ = false;
+    size_t padding_ = 0;
+};
+
+struct FrameComponent {
+    int id = 0;
+    int h = 1;
+    int v = 1;
+    int blocksPerLine = 0;
+    int blocksPerColumn = 0;
+};
+
+inline bool isRestartMarker(uint8_t m) { return m >= 0xD0 && m <= 0xD7; }
+
+class CoefficientDecoder {
+public:
+    CoefficientDecoder(const uint8_t* data, size_t size, JpegCoefficientStats& stats)
+        : data_(data), size_(size), stats_(stats), reader_(data, size) {}
+
+    bool run(std::string& error);
+
+private:
+    bool parseFrame(const uint8_t* p, size_t len, std::string& error);
+    bool parseHuffman(const uint8_t* p, size_t len, std::string& error);
+    // Энтропийные данные начинаются сразу после заголовка SOS
+    bool decodeScan(const JpegSegment& sos, std::string& error);
+    bool decodeBlock(const HuffmanTable& dc, const HuffmanTable& ac);
+    bool restart();
+    void recordCheckpoint();
+
+    const uint8_t* data_;
+    size_t size_;
+    JpegCoefficientStats& stats_;
+    BitReader reader_;
+
+    HuffmanTable dcTables_[4];
+    HuffmanTable acTables_[4];
+    std::vector<FrameComponent> components_;
+    int maxH_ = 1;
+    int maxV_ = 1;
+    int mcusPerLine_ = 0;
+    int mcusPerColumn_ = 0;
+    int restartInterval_ = 0;
+    uint64_t expectedBlocks_ = 0;
+    uint64_t nextCheckpoint_ = 0;
+};
+
+bool CoefficientDecoder::parseFrame(const uint8_t* p, size_t len, std::string& error) {
+    if (!components_.empty()) {
+        error = "несколько кадров SOF";
+        return false;
+    }
+    if (len < 6 || p[0] != 8) {
+        error = "поддерживается только точность 8 бит";
+        return false;
+    }
+    int height = (p[1] << 8) | p[2];
+    int width = (p[3] << 8) | p[4];
+    int count = p[5];
+    if (height == 0 || width == 0) {
+        error = "высота задаётся маркером DNL или нулевой размер кадра";
+        return false;
+    }
+    if (count < 1 || count > 4 || len < 6 + 3 * static_cast<size_t>(count)) {
+        error = "неверное число компонент кадра";
+        return false;
+    }
+    for (int i = 0; i < count; ++i) {
+        FrameComponent c;
+        c.id = p[6 + i * 3];
+        c.h = p[7 + i * 3] >> 4;
+        c.v = p[7 + i * 3] & 15;
+        if (c.h < 1 || c.h > 4 || c.v < 1 || c.v > 4) {
+            error = "неверные коэффициенты прореживания";
+            return false;
+        }
+        maxH_ = std::max(maxH_, c.h);
+        maxV_ = std::max(maxV_, c.v);
+        components_.push_back(c);
+    }
+    mcusPerLine_ = (width + 8 * maxH_ - 1) / (8 * maxH_);
+    mcusPerColumn_ = (height + 8 * maxV_ - 1) / (8 * maxV_);
+    for (auto& c : components_) {
+        int w = (width * c.h + maxH_ - 1) / maxH_;
+        int h = (height * c.v + maxV_ - 1) / maxV_;
+        c.blocksPerLine = (w + 7) / 8;
+        c.blocksPerColumn = (h + 7) / 8;
+        expectedBlocks_ += static_cast<uint64_t>(c.blocksPerLine) * c.blocksPerColumn;
+    }
+    stats_.width = width;
+    stats_.height = height;
+    stats_.components = count;
+    nextCheckpoint_ = expectedBlocks_ / JpegCoefficientStats::kCurveSteps;
+    return true;
+}
+
+bool CoefficientDecoder::parseHuffman(const uint8_t* p, size_t len, std::string& error) {
+    size_t i = 0;
+    while (i < len) {
+        if (i + 17 > len) break;
+        int tableClass = p[i] >> 4;
+        int id = p[i] & 15;
+        const uint8_t* counts = p + i + 1;
+        size_t total = 0;
+        for (int k = 0; k < 16; ++k) total += counts[k];
+        if (tableClass > 1 || id > 3 || total > 256 || i + 17 + total > len) {
+            error = "повреждённая таблица Хаффмана";
+            return false;
+        }
+        HuffmanTable& table = tableClass == 0 ? dcTables_[id] : acTables_[id];
+        if (!buildHuffmanTable(table, counts, p + i + 17)) {
+            error = "неверные длины кодов Хаффмана";
+            return false;
+        }
+        i += 17 + total;
+    }
+    return true;
+}
+
+void CoefficientDecoder::recordCheckpoint() {
+    while (stats_.jstegCurve.size() < JpegCoefficientStats::kCurveSteps &&
+        stats_.blocks >= nextCheckpoint_) {
+        stats_.jstegCurve.push_back(jstegEmbeddingProbability(stats_.acHistogram));
+        nextCheckpoint_ = expectedBlocks_ * (stats_.jstegCurve.size() + 1) / JpegCoefficientStats::kCurveSteps;
+    }
+}
+
+bool CoefficientDecoder::decodeBlock(const HuffmanTable& dc, const HuffmanTable& ac) {
+    int t = reader_.decode(dc);
+    if (t < 0 || t > 11) return false;
+    if (t) reader_.receiveExtend(t);
+
+    uint64_t* zero = stats_.acHistogram + JpegCoefficientStats::kCoefficientLimit;
+    int nonZero = 0;
+    int k = 1;
+    while (k < 64) {
+        int fast = ac.fastAc[reader_.peekFast()];
+        int value;
+        if (fast) {
+            k += (fast >> 4) & 15;
+            reader_.consume(fast & 15);
+            value = fast >> 8;
+        }
+        else {
+            int rs = reader_.decode(ac);
+            if (rs < 0) return false;
+            int s = rs & 15;
+            if (s == 0) {
+                if (rs != 0xF0) break;  // EOB
+                k += 16;
+                continue;
+            }
+            k += rs >> 4;
+            value = reader_.receiveExtend(s);
+        }
+        if (k > 63) return false;
+        if (value >= -JpegCoefficientStats::kCoefficientLimit && value < JpegCoefficientStats::kCoefficientLimit) {
+            zero[value]++;
+        }
+        else {
+            stats_.acOutOfRange++;
+        }
+        nonZero++;
+        k++;
+    }
+    if (k > 64) return false;
+    zero[0] += 63 - nonZero;
+    stats_.blocks++;
+    return true;
+}
+
+bool CoefficientDecoder::restart() {
+    // После выравнивания ожидается RSTn; мусор перед ним пропускается
+    size_t pos = reader_.position();
+    while (pos + 1 < size_) {
+        const void* hit = std::memchr(data_ + pos, 0xFF, size_ - pos - 1);
+        if (!hit) return false;
+        pos = static_cast<const uint8_t*>(hit) - data_;
+        uint8_t m = data_[pos + 1];
+        if (isRestartMarker(m)) {
+            reader_.reset(pos + 2);
+            return true;
+        }
+        if (m != 0x00 && m != 0xFF) return false;
+        pos++;
+    }
+    return false;
+}
+
+bool CoefficientDecoder::decodeScan(const JpegSegment& sos, std::string& error) {
+    const uint8_t* p = sos.payload;
+    size_t len = sos.payloadSize;
+    if (components_.empty()) {
+        error = "SOS до SOF";
+        return false;
+    }
+    int count = len > 0 ? p[0] : 0;
+    if (count < 1 || count > 4 || len < 4 + 2 * static_cast<size_t>(count)) {
+        error = "повреждённый заголовок SOS";
+        return false;
+    }
+    struct ScanComponent {
+        const FrameComponent* frame;
+        const HuffmanTable* dc;
+        const HuffmanTable* ac;
+    };
+    std::vector<ScanComponent> scan;
+    for (int i = 0; i < count; ++i) {
+        int id = p[1 + i * 2];
+        int dcId = p[2 + i * 2] >> 4;
+        int acId = p[2 + i * 2] & 15;
+        auto it = std::find_if(components_.begin(), components_.end(),
+            [id](const FrameComponent& c) { return c.id == id; });
+        if (it == components_.end() || dcId > 3 || acId > 3 ||
+            !dcTables_[dcId].defined || !acTables_[acId].defined) {
+            error = "SOS ссылается на неизвестную компоненту или таблицу";
+            return false;
+        }
+        scan.push_back({ &*it, &dcTables_[dcId], &acTables_[acId] });
+    }
+    const uint8_t* sel = p + 1 + count * 2;
+    if (sel[0] != 0 || sel[1] != 63 || sel[2] != 0) {
+        error = "параметры скана не соответствуют последовательному режиму";
+        return false;
+    }
+
+    reader_.reset(sos.end());
+    // Один компонент кодируется без дополнения до MCU, несколько — чередуются
+    uint64_t units = count == 1 ?
+        static_cast<uint64_t>(scan[0].frame->blocksPerLine) * scan[0].frame->blocksPerColumn :
+        static_cast<uint64_t>(mcusPerLine_) * mcusPerColumn_;
+
+    for (uint64_t unit = 0; unit < units; ++unit) {
+        if (restartInterval_ && unit > 0 && unit % restartInterval_ == 0) {
+            if (!restart()) {
+                stats_.truncated = true;
+                break;
+            }
+        }
+        for (const auto& c : scan) {
+            int blocks = count == 1 ? 1 : c.frame->h * c.frame->v;
+            for (int b = 0; b < blocks; ++b) {
+                if (!decodeBlock(*c.dc, *c.ac)) {
+                    error = "ошибка энтропийного декодирования";
+                    return false;
+                }
+            }
+        }
+        if (reader_.exhausted()) {
+            stats_.truncated = unit + 1 < units;
+            break;
+        }
+        recordCheckpoint();
+    }
+    return true;
+}
+
+bool CoefficientDecoder::run(std::string& error) {
+    if (size_ < 4 || data_[0] != 0xFF || data_[1] != 0xD8) {
+        error = "нет маркера SOI";
+        return false;
+    }
+    JpegSegmentIterator segments(data_, size_, 2);
+    JpegSegment seg;
+    while (segments.next(seg)) {
+        switch (seg.marker) {
+        case 0xC0:
+        case 0xC1:
+            if (!parseFrame(seg.payload, seg.payloadSize, error)) return false;
+            break;
+        case 0xC2:
+        case 0xC6:
+            error = "прогрессивный JPEG";
+            return false;
+        case 0xC3: case 0xC5: case 0xC7:
+        case 0xC9: case 0xCA: case 0xCB:
+        case 0xCD: case 0xCE: case 0xCF:
+            error = "lossless или арифметическое кодирование";
+            return false;
+        case 0xC4:
+            if (!parseHuffman(seg.payload, seg.payloadSize, error)) return false;
+            break;
+        case 0xDD:
+            if (seg.payloadSize >= 2) restartInterval_ = (seg.payload[0] << 8) | seg.payload[1];
+            break;
+        case 0xFE:
+            if (stats_.comment.empty()) {
+                stats_.comment.assign(reinterpret_cast<const char*>(seg.payload),
+                    std::min<size_t>(seg.payloadSize, 256));
+            }
+            break;
+        case 0xDA:
+            if (!decodeScan(seg, error)) return false;
+            // Поиск следующего маркера продолжается с конца декодированных данных
+            segments.resumeScanAt(reader_.position());
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (stats_.blocks == 0) {
+        error = segments.truncated() ? "сегмент выходит за пределы файла" :
+            components_.empty() ? "нет кадра SOF" : "нет данных скана";
+        return false;
+    }
+    // Кривая дополняется до конца, если блоков оказалось меньше ожидаемого
+    while (stats_.jstegCurve.size() < JpegCoefficientStats::kCurveSteps) {
+        stats_.jstegCurve.push_back(jstegEmbeddingProbability(stats_.acHistogram));
+    }
+    return true;
+}
+
+} // namespace
+
+uint64_t JpegCoefficientStats::acTotal() const {
+    uint64_t total = acOutOfRange;
+    for (uint64_t n : acHistogram) total += n;
+    return total;
+}
+
+bool decodeJpegCoefficients(const uint8_t* data, size_t size, JpegCoefficientStats& stats,
+    std::string& error) {
+    if (!data) {
+        error = "нет данных";
+        return false;
+    }
+    // Таблицы Хаффмана занимают несколько десятков КБ, поэтому декодер в куче
+    auto decoder = std::make_unique<CoefficientDecoder>(data, size, stats);
+    return decoder->run(error);
+}
+
+double jstegEmbeddingProbability(const uint64_t acHistogram[2 * JpegCoefficientStats::kCoefficientLimit]) {
+    // Гистограмма отсчитывается от -kCoefficientLimit (чётного), поэтому пара
+    // (2k, 2k+1) — соседние ячейки с чётным индексом первой
+    const size_t pairedZero = JpegCoefficientStats::kCoefficientLimit;
+    double chi = 0.0;
+    int categories = 0;
+    for (size_t i = 0; i + 1 < 2 * JpegCoefficientStats::kCoefficientLimit; i += 2) {
+        if (i == pairedZero) continue;
+        double expected = (static_cast<double>(acHistogram[i]) + acHistogram[i + 1]) / 2.0;
+        if (expected < 5.0) continue;
+        double diff = acHistogram[i] - expected;
+        chi += diff * diff / expected;
+        categories++;
+    }
+    if (categories < 2) return 0.0;
+    return 1.0 - chiSquareCdf(chi, categories - 1);
+}
+
+double jstegEmbeddingEstimate(const JpegCoefficientStats& stats) {
+    // h'(-1) = a - q/2·(a - b), h'(-2) = b + q/2·(a - b), h'(1) = a, где
+    // a = h(±1), b = h(±2) исходного изображения
+    double a = static_cast<double>(stats.ac(1));
+    double m1 = static_cast<double>(stats.ac(-1));
+    double m2 = static_cast<double>(stats.ac(-2));
+    double spread = 2.0 * a - m1 - m2;   // a - b
+    if (a < 50.0 || spread < 0.05 * a) return -1.0;
+    return std::clamp(2.0 * (a - m1) / spread, 0.0, 1.0);
+}
+
+bool hasF5EncoderSignature(const JpegCoefficientStats& stats) {
+    return stats.comment.find("James R. Weeks") != std::string::npos;
+}
@@ -0,0 +1,57 @@
+﻿#ifndef JPEG_COEFFICIENTS_H
+#define JPEG_COEFFICIENTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Статистика квантованных DCT-коэффициентов JPEG, собранная без
+// восстановления пикселей (только энтропийное декодирование)
+struct JpegCoefficientStats {
+    // AC-коэффициенты 8-битного JPEG лежат в [-1023, 1023]
+    static constexpr int kCoefficientLimit = 1024;
+    // Число контрольных точек кривой JSteg по доле декодированных блоков
+    static constexpr size_t kCurveSteps = 20;
+
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    uint64_t blocks = 0;
+
+    // acHistogram[v + kCoefficientLimit] — число AC-коэффициентов со значением v
+    uint64_t acHistogram[2 * kCoefficientLimit] = {};
+    uint64_t acOutOfRange = 0;
+
+    // χ² JSteg для растущей доли блоков в порядке файла
+    std::vector<double> jstegCurve;
+
+    bool truncated = false;   // данные скана закончились раньше последнего блока
+    std::string comment;      // первый сегмент COM
+
+    uint64_t ac(int value) const {
+        return (value >= -kCoefficientLimit && value < kCoefficientLimit) ?
+            acHistogram[value + kCoefficientLimit] : 0;
+    }
+    uint64_t acTotal() const;
+};
+
+// Энтропийное декодирование baseline / extended sequential JPEG (Хаффман, 8 бит).
+// Прогрессивные, lossless и арифметически кодированные файлы не поддерживаются:
+// false и текст причины в error
+bool decodeJpegCoefficients(const uint8_t* data, size_t size, JpegCoefficientStats& stats,
+    std::string& error);
+
+// Вероятность встраивания JSteg: χ² по парам значений (2k, 2k+1) гистограммы
+// AC-коэффициентов без пары (0, 1), которую JSteg не использует
+double jstegEmbeddingProbability(const uint64_t acHistogram[2 * JpegCoefficientStats::kCoefficientLimit]);
+
+// Оценка доли изменённых JSteg коэффициентов по асимметрии гистограммы:
+// JSteg не трогает значение 1, но меняет -1 в паре с -2, тогда как у
+// исходного изображения h(1) ≈ h(-1). Отрицательное — оценка невозможна
+double jstegEmbeddingEstimate(const JpegCoefficientStats& stats);
+
+// Комментарий, который оставляет эталонная реализация F5
+bool hasF5EncoderSignature(const JpegCoefficientStats& stats);
+
+#endif // JPEG_COEFFICIENTS_H
@@ -0,0 +1,82 @@
+﻿#include "jpeg_segments.h"
+#include <cstring>
+
+size_t JpegSegmentIterator::findMarker(size_t from) const {
+    // В энтропийных данных 0xFF редок, memchr проходит их векторно
+    size_t pos = from;
+    while (pos + 1 < size_) {
+        const void* hit = std::memchr(data_ + pos, 0xFF, size_ - pos - 1);
+        if (!hit) return size_;
+        pos = static_cast<const uint8_t*>(hit) - data_;
+        uint8_t m = data_[pos + 1];
+        if (m != 0x00 && m != 0xFF && !(m >= 0xD0 && m <= 0xD7)) return pos;
+        pos++;
+    }
+    return size_;
+}
+
+void JpegSegmentIterator::resumeScanAt(size_t pos) {
+    if (inScan_ && pos > pos_) pos_ = pos < size_ ? pos : size_;
+}
+
+bool JpegSegmentIterator::next(JpegSegment& segment) {
+    if (done_) return false;
+    if (inScan_) {
+        inScan_ = false;
+        pos_ = findMarker(pos_);
+    }
+
+    // Между сегментами допустимы только байты-заполнители 0xFF
+    for (;;) {
+        if (pos_ + 1 >= size_) {
+            done_ = true;
+            return false;
+        }
+        if (data_[pos_] != 0xFF) {
+            const void* hit = std::memchr(data_ + pos_, 0xFF, size_ - pos_);
+            pos_ = hit ? static_cast<size_t>(static_cast<const uint8_t*>(hit) - data_) : size_;
+            continue;
+        }
+        uint8_t m = data_[pos_ + 1];
+        if (m == 0xFF) {
+            pos_++;
+            continue;
+        }
+        if (m == 0x00) {
+            pos_ += 2;
+            continue;
+        }
+        break;
+    }
+
+    segment = JpegSegment();
+    segment.marker = data_[pos_ + 1];
+    segment.offset = pos_;
+
+    if (isStandaloneJpegMarker(segment.marker)) {
+        pos_ += 2;
+        if (segment.marker == 0xD9) {
+            eoiEnd_ = pos_;
+            done_ = true;
+        }
+        return true;
+    }
+
+    if (pos_ + 4 > size_) {
+        truncated_ = true;
+        done_ = true;
+        return false;
+    }
+    uint16_t length = static_cast<uint16_t>((data_[pos_ + 2] << 8) | data_[pos_ + 3]);
+    if (length < 2 || pos_ + 2 + length > size_) {
+        truncated_ = true;
+        done_ = true;
+        return false;
+    }
+    segment.length = length;
+    segment.payload = data_ + pos_ + 4;
+    segment.payloadSize = length - 2u;
+    pos_ += 2 + static_cast<size_t>(length);
+    if (segment.marker == 0xDA) inScan_ = true;
+    return true;
+}
@@ -0,0 +1,57 @@
+﻿#ifndef JPEG_SEGMENTS_H
+#define JPEG_SEGMENTS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Сегмент JPEG, указывающий на исходный буфер без копирования
+struct JpegSegment {
+    uint8_t marker = 0;
+    size_t offset = 0;               // позиция байта 0xFF маркера
+    uint16_t length = 0;             // поле длины (0 у маркеров без длины)
+    const uint8_t* payload = nullptr;
+    size_t payloadSize = 0;
+
+    // Позиция сразу после сегмента; у SOS — начало энтропийных данных
+    size_t end() const { return offset + 2 + length; }
+};
+
+// Обход сегментов JPEG: переход по полям длины, а энтропийные данные после
+// SOS пропускаются поиском 0xFF через memchr (FF 00, RSTn и байты-заполнители
+// FF не считаются концом скана). Используется анализом структуры (сегменты
+// APPn и COM, данные после EOI) и DCT-декодером.
+class JpegSegmentIterator {
+public:
+    JpegSegmentIterator(const uint8_t* data, size_t size, size_t start = 0)
+        : data_(data), size_(size), pos_(start) {}
+
+    // Следующий сегмент; false после EOI, в конце данных или на сегменте,
+    // длина которого выходит за пределы буфера
+    bool next(JpegSegment& segment);
+
+    // Вызывающий уже прошёл энтропийные данные скана до pos
+    // (например, декодер), поиск следующего маркера продолжится оттуда
+    void resumeScanAt(size_t pos);
+
+    bool reachedEoi() const { return eoiEnd_ != 0; }
+    size_t eoiEnd() const { return eoiEnd_; }       // позиция сразу после EOI
+    bool truncated() const { return truncated_; }   // сегмент обрезан концом данных
+
+private:
+    size_t findMarker(size_t from) const;
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+    bool inScan_ = false;
+    bool done_ = false;
+    bool truncated_ = false;
+    size_t eoiEnd_ = 0;
+};
+
+// Маркеры без поля длины: SOI, EOI, RSTn, TEM
+inline bool isStandaloneJpegMarker(uint8_t marker) {
+    return marker == 0xD8 || marker == 0xD9 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7);
+}
+
+#endif // JPEG_SEGMENTS_H
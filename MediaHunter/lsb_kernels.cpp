@@ -0,0 +1,202 @@
+﻿#include "lsb_kernels.h"
+#include "cpu_features.h"
+#include <algorithm>
+
+#if defined(MH_X86)
+#  include <immintrin.h>
+#endif
+
+namespace {
+
+using PlaneKernel = void (*)(const uint8_t* data, size_t size, uint64_t ones[8]);
+
+// Скалярная версия: 8 байтов за шаг, сумма байтов 0/1 через умножение
+void countScalar(const uint8_t* data, size_t size, uint64_t ones[8]) {
+    const uint64_t lowBits = 0x0101010101010101ULL;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w = 0;
+        for (int k = 0; k < 8; ++k) w |= static_cast<uint64_t>(data[i + k]) << (8 * k);
+        for (int b = 0; b < 8; ++b) {
+            ones[b] += (((w >> b) & lowBits) * lowBits) >> 56;
+        }
+    }
+    for (; i < size; ++i) {
+        for (int b = 0; b < 8; ++b) ones[b] += (data[i] >> b) & 1u;
+    }
+}
+
+#if defined(MH_X86)
+
+// Хвостовое ядро: старший бит байта проверяется знаковым сравнением с нулём,
+// затем байт сдвигается влево сложением с самим собой. Счётчики-байты
+// вычитают маску 0xFF и не более чем через 255 итераций сворачиваются
+// через psadbw в 64-битные суммы.
+#define MH_PLANE_STEP(add, sub, cmpgt, acc) \
+    acc = sub(acc, cmpgt(zero, v));         \
+    v = add(v, v);
+
+MH_TARGET("sse2")
+void countTailSse2(const uint8_t* data, size_t size, uint64_t ones[8]) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    while (size - i >= 16) {
+        size_t blocks = std::min<size_t>((size - i) / 16, 255);
+        __m128i a0 = zero, a1 = zero, a2 = zero, a3 = zero;
+        __m128i a4 = zero, a5 = zero, a6 = zero, a7 = zero;
+        for (size_t k = 0; k < blocks; ++k, i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            MH_PLANE_STEP(_mm_add_epi8, _mm_sub_epi8, _mm_cmpgt_epi8, a7)
+            MH_PLANE_STEP(_mm_add_epi8, _mm_sub_epi8, _mm_cmpgt_epi8, a6)
+            MH_PLANE_STEP(_mm_add_epi8, _mm_sub_epi8, _mm_cmpgt_epi8, a5)
+            MH_PLANE_STEP(_mm_add_epi8, _mm_sub_epi8, _mm_cmpgt_epi8, a4)
+            MH_PLANE_STEP(_mm_add_epi8, _mm_sub_epi8, _mm_cmpgt_epi8, a3)
+            MH_PLANE_STEP(_mm_add_epi8, _mm_sub_epi8, _mm_cmpgt_epi8, a2)
+            MH_PLANE_STEP(_mm_add_epi8, _mm_sub_epi8, _mm_cmpgt_epi8, a1)
+            MH_PLANE_STEP(_mm_add_epi8, _mm_sub_epi8, _mm_cmpgt_epi8, a0)
+        }
+        const __m128i acc[8] = { a0, a1, a2, a3, a4, a5, a6, a7 };
+        for (int b = 0; b < 8; ++b) {
+            alignas(16) uint64_t lanes[2];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_sad_epu8(acc[b], zero));
+            ones[b] += lanes[0] + lanes[1];
+        }
+    }
+    countScalar(data + i, size - i, ones);
+}
+
+#undef MH_PLANE_STEP
+
+// Основное ядро — вертикальное SWAR-суммирование без сравнений:
+//  1) три вектора складываются в 2-битные поля (чётные и нечётные плоскости, <= 3);
+//  2) пять таких троек складываются в 4-битные поля (<= 15);
+//  3) до 17 групп складываются в байтовые счётчики (<= 255), которые
+//     сворачиваются psadbw. Итого около 10 векторных операций на вектор
+//     вместо 23 у хвостового ядра.
+// Сдвиги выполняются по 16-битным словам: перешедшие из соседнего байта
+// биты отсекаются последующей маской.
+#define MH_DEFINE_PLANE_KERNEL(NAME, ISA, VEC, WIDTH, LOAD, AND, SRLI16, ADD, SET1, ZERO, REDUCE, TAIL) \
+MH_TARGET(ISA)                                                                          \
+void NAME(const uint8_t* data, size_t size, uint64_t ones[8]) {                        \
+    const VEC m55 = SET1(0x55), m33 = SET1(0x33), m0f = SET1(0x0F), zero = ZERO();     \
+    const size_t groupBytes = 15 * (WIDTH);                                             \
+    size_t i = 0;                                                                       \
+    while (size - i >= groupBytes) {                                                    \
+        size_t groups = std::min<size_t>((size - i) / groupBytes, 17);                  \
+        VEC b0 = zero, b1 = zero, b2 = zero, b3 = zero;                                 \
+        VEC b4 = zero, b5 = zero, b6 = zero, b7 = zero;                                 \
+        for (size_t g = 0; g < groups; ++g) {                                           \
+            VEC p04 = zero, p26 = zero, p15 = zero, p37 = zero;                         \
+            for (int t = 0; t < 5; ++t, i += 3 * (WIDTH)) {                             \
+                VEC v1 = LOAD(data + i);                                                \
+                VEC v2 = LOAD(data + i + (WIDTH));                                      \
+                VEC v3 = LOAD(data + i + 2 * (WIDTH));                                  \
+                VEC e = ADD(ADD(AND(v1, m55), AND(v2, m55)), AND(v3, m55));             \
+                VEC o = ADD(ADD(AND(SRLI16(v1, 1), m55), AND(SRLI16(v2, 1), m55)),      \
+                    AND(SRLI16(v3, 1), m55));                                           \
+                p04 = ADD(p04, AND(e, m33));                                            \
+                p26 = ADD(p26, AND(SRLI16(e, 2), m33));                                 \
+                p15 = ADD(p15, AND(o, m33));                                            \
+                p37 = ADD(p37, AND(SRLI16(o, 2), m33));                                 \
+            }                                                                           \
+            b0 = ADD(b0, AND(p04, m0f));                                                \
+            b4 = ADD(b4, AND(SRLI16(p04, 4), m0f));                                     \
+            b2 = ADD(b2, AND(p26, m0f));                                                \
+            b6 = ADD(b6, AND(SRLI16(p26, 4), m0f));                                     \
+            b1 = ADD(b1, AND(p15, m0f));                                                \
+            b5 = ADD(b5, AND(SRLI16(p15, 4), m0f));                                     \
+            b3 = ADD(b3, AND(p37, m0f));                                                \
+            b7 = ADD(b7, AND(SRLI16(p37, 4), m0f));                                     \
+        }                                                                               \
+        const VEC acc[8] = { b0, b1, b2, b3, b4, b5, b6, b7 };                          \
+        for (int b = 0; b < 8; ++b) ones[b] += REDUCE(acc[b], zero);                    \
+    }                                                                                   \
+    TAIL(data + i, size - i, ones);                                                     \
+}
+
+MH_TARGET("sse2")
+inline uint64_t reduceSse2(__m128i acc, __m128i zero) {
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_sad_epu8(acc, zero));
+    return lanes[0] + lanes[1];
+}
+
+MH_TARGET("sse2")
+inline __m128i loadSse2(const uint8_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+MH_DEFINE_PLANE_KERNEL(countSse2, "sse2", __m128i, 16, loadSse2, _mm_and_si128, _mm_srli_epi16,
+    _mm_add_epi8, _mm_set1_epi8, _mm_setzero_si128, reduceSse2, countTailSse2)
+
+MH_TARGET("avx2")
+inline uint64_t reduceAvx2(__m256i acc, __m256i zero) {
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_sad_epu8(acc, zero));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+MH_TARGET("avx2")
+inline __m256i loadAvx2(const uint8_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+MH_DEFINE_PLANE_KERNEL(countAvx2, "avx2", __m256i, 32, loadAvx2, _mm256_and_si256, _mm256_srli_epi16,
+    _mm256_add_epi8, _mm256_set1_epi8, _mm256_setzero_si256, reduceAvx2, countTailSse2)
+
+#if defined(MH_X64)
+MH_TARGET("avx512f,avx512bw")
+inline uint64_t reduceAvx512(__m512i acc, __m512i zero) {
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(reinterpret_cast<void*>(lanes), _mm512_sad_epu8(acc, zero));
+    uint64_t sum = 0;
+    for (uint64_t lane : lanes) sum += lane;
+    return sum;
+}
+
+MH_TARGET("avx512f,avx512bw")
+inline __m512i loadAvx512(const uint8_t* p) {
+    return _mm512_loadu_si512(reinterpret_cast<const void*>(p));
+}
+
+MH_DEFINE_PLANE_KERNEL(countAvx512, "avx512f,avx512bw", __m512i, 64, loadAvx512, _mm512_and_si512,
+    _mm512_srli_epi16, _mm512_add_epi8, _mm512_set1_epi8, _mm512_setzero_si512, reduceAvx512, countAvx2)
+#endif
+
+#undef MH_DEFINE_PLANE_KERNEL
+
+#endif // MH_X86
+
+struct KernelChoice {
+    PlaneKernel fn;
+    const char* name;
+};
+
+KernelChoice selectKernel() {
+#if defined(MH_X86)
+    const CpuFeatures& cpu = cpuFeatures();
+#if defined(MH_X64)
+    if (cpu.avx512bw) return { countAvx512, "AVX-512BW" };
+#endif
+    if (cpu.avx2) return { countAvx2, "AVX2" };
+    if (cpu.sse2) return { countSse2, "SSE2" };
+#endif
+    return { countScalar, "scalar" };
+}
+
+const KernelChoice& kernel() {
+    static const KernelChoice choice = selectKernel();
+    return choice;
+}
+
+} // namespace
+
+void countBitPlanes(const uint8_t* data, size_t size, BitPlaneCounts& counts) {
+    if (!data || size == 0) return;
+    kernel().fn(data, size, counts.ones);
+    counts.total += size;
+}
+
+const char* bitPlaneKernelName() {
+    return kernel().name;
+}
@@ -0,0 +1,25 @@
+﻿#ifndef LSB_KERNELS_H
+#define LSB_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Количество единичных битов в каждой из восьми битовых плоскостей (0 — младший бит)
+struct BitPlaneCounts {
+    uint64_t ones[8] = {};
+    uint64_t total = 0;  // количество обработанных байтов
+
+    double percent(int plane) const {
+        return total ? (static_cast<double>(ones[plane]) / total) * 100.0 : 0.0;
+    }
+};
+
+// Подсчёт битовых плоскостей за один проход; результат добавляется к counts,
+// что позволяет накапливать статистику по строкам или блокам файла.
+// Реализация (SSE2 / AVX2 / AVX-512BW / скалярная) выбирается при первом вызове.
+void countBitPlanes(const uint8_t* data, size_t size, BitPlaneCounts& counts);
+
+// Название выбранной реализации (для отчёта)
+const char* bitPlaneKernelName();
+
+#endif // LSB_KERNELS_H
@@ -19,6 +19,7 @@
 #include "steganography_checker.h"
 #include "extension_checker.h"
 #include "full_analyzer.h"
+#include "sampling_analyzer.h"
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -42,6 +43,7 @@ void showMenu() {
         << "4) Проверка скрытых расширений файлов\n"
         << "5) Анализ PDF-файлов\n"
         << "6) Общий анализ\n"
+        << "7) Выборочный анализ больших файлов\n"
         << "0) Выход\n"
         << "Введите номер пункта: ";
 }
@@ -81,7 +83,7 @@ int main() {
             continue;
         }
         if (choice == 0) break;
-        if (choice < 1 || choice > 6) {
+        if (choice < 1 || choice > 7) {
             std::cout << "Ошибка: выберите корректный пункт.\n";
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
             cin.get();
@@ -255,7 +257,7 @@ int main() {
             break;
         }
 
-        case 6:
+        case 6: {
             FullAnalyzer analyzer("rules.yar");
 
             if (fileChoice == 1) {
@@ -272,6 +274,37 @@ int main() {
             break;
         }
 
+        case 7: {  // Выборочный анализ: заголовок, хвост и блоки из страт
+            std::cout << "Бюджет чтения на файл, МБ (0 — " << SamplingAnalyzer::kDefaultIoBudget / (1024 * 1024) << "): ";
+            unsigned long long budgetMb = 0;
+            if (!(cin >> budgetMb)) {
+                cin.clear();
+                budgetMb = 0;
+            }
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            uint64_t budget = budgetMb ? budgetMb * 1024ULL * 1024ULL : SamplingAnalyzer::kDefaultIoBudget;
+
+            try {
+                SamplingAnalyzer analyzer("rules.yar", budget);
+                if (fileChoice == 1) {
+                    auto result = analyzer.analyzeFile(path);
+                    std::cout << "\n";
+                    ReportGenerator report;
+                    report.generateSingleReport(path, result);
+                }
+                else {
+                    auto reports = analyzer.analyzeDirectory(path);
+                    ReportGenerator report;
+                    report.generateDirectoryReport(path, reports);
+                }
+            }
+            catch (const std::runtime_error& ex) {
+                cerr << "Ошибка сканирования: " << ex.what() << "\n";
+            }
+            break;
+        }
+        }
+
         std::cout << "\nНажмите Enter для возврата в меню...";
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
         cin.get();
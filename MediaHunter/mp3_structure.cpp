@@ -0,0 +1,375 @@
+﻿#include "mp3_structure.h"
+#include <algorithm>
+#include <cstring>
+#include "byte_search.h"
+
+namespace {
+
+const size_t kMaxStoredGaps = 1000;
+
+inline uint32_t readBE32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline uint32_t readLE32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+// Синхробезопасное целое ID3v2: 4 байта по 7 значащих битов
+bool readSyncSafe(const uint8_t* p, uint32_t& value) {
+    if ((p[0] | p[1] | p[2] | p[3]) & 0x80) return false;
+    value = (uint32_t(p[0]) << 21) | (uint32_t(p[1]) << 14) | (uint32_t(p[2]) << 7) | uint32_t(p[3]);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Кадры MPEG-аудио
+
+struct FrameHeader {
+    int version = 0;
+    int layer = 0;
+    uint32_t sampleRate = 0;
+    uint32_t length = 0;
+
+    bool sameStream(const FrameHeader& other) const {
+        return version == other.version && layer == other.layer && sampleRate == other.sampleRate;
+    }
+};
+
+// Битрейты в кбит/с по индексам 1–14: MPEG-1 слои I–III, MPEG-2/2.5 слой I и слои II–III
+const uint16_t kBitrates[5][14] = {
+    { 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+    { 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+    { 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+    { 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+    { 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }
+};
+const uint32_t kSampleRates[3][3] = {
+    { 44100, 48000, 32000 }, { 22050, 24000, 16000 }, { 11025, 12000, 8000 }
+};
+
+// Свободный битрейт (индекс 0) не поддерживается: длину кадра нельзя вычислить из заголовка
+bool parseFrameHeader(const uint8_t* p, FrameHeader& h) {
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) return false;
+    int versionBits = (p[1] >> 3) & 3;
+    int layerBits = (p[1] >> 1) & 3;
+    int bitrateIndex = p[2] >> 4;
+    int rateIndex = (p[2] >> 2) & 3;
+    if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3 ||
+        (p[3] & 3) == 2) return false;
+
+    h.version = versionBits == 3 ? 1 : versionBits == 2 ? 2 : 25;
+    h.layer = 4 - layerBits;
+    h.sampleRate = kSampleRates[h.version == 1 ? 0 : h.version == 2 ? 1 : 2][rateIndex];
+    int table = h.version == 1 ? h.layer - 1 : (h.layer == 1 ? 3 : 4);
+    uint32_t bitrate = kBitrates[table][bitrateIndex - 1] * 1000u;
+    uint32_t padding = (p[2] >> 1) & 1;
+    if (h.layer == 1) h.length = (12 * bitrate / h.sampleRate + padding) * 4;
+    else if (h.layer == 3 && h.version != 1) h.length = 72 * bitrate / h.sampleRate + padding;
+    else h.length = 144 * bitrate / h.sampleRate + padding;
+    return true;
+}
+
+class FrameWalker {
+public:
+    FrameWalker(const uint8_t* data, uint64_t limit) : data_(data), limit_(limit) {}
+
+    // Заголовок в pos, подтверждённый следующим кадром того же потока
+    // (или концом области); ref — параметры уже найденного потока
+    bool frameAt(uint64_t pos, const FrameHeader* ref, FrameHeader& h) const {
+        if (limit_ - pos < 4 || !parseFrameHeader(data_ + pos, h)) return false;
+        if (ref && !h.sameStream(*ref)) return false;
+        if (h.length > limit_ - pos) return false;
+        uint64_t next = pos + h.length;
+        if (next == limit_) return true;
+        FrameHeader following;
+        return limit_ - next >= 4 && parseFrameHeader(data_ + next, following) && following.sameStream(h);
+    }
+
+    // Следующий подтверждённый кадр начиная с from; limit_, если его нет
+    uint64_t findFrame(uint64_t from, const FrameHeader* ref, FrameHeader& h) const {
+        uint64_t pos = from;
+        while (pos + 4 <= limit_) {
+            pos += findSyncWord(data_ + pos, static_cast<size_t>(limit_ - pos));
+            if (pos + 4 > limit_) break;
+            if (frameAt(pos, ref, h)) return pos;
+            ++pos;
+        }
+        return limit_;
+    }
+
+    void walk(uint64_t begin, MpegAudioStream& audio) const {
+        FrameHeader first;
+        uint64_t pos = findFrame(begin, nullptr, first);
+        if (pos >= limit_) return;
+        audio.version = first.version;
+        audio.layer = first.layer;
+        audio.sampleRate = first.sampleRate;
+        audio.firstFrame = pos;
+
+        FrameHeader h;
+        while (pos < limit_) {
+            if (limit_ - pos >= 4 && parseFrameHeader(data_ + pos, h) && h.sameStream(first) &&
+                h.length <= limit_ - pos) {
+                audio.frames++;
+                pos += h.length;
+                audio.end = pos;
+                continue;
+            }
+            // Поток прерван: продолжение ищется по синхрослову, пропущенные
+            // байты — разрыв. Без продолжения остаток считается хвостом
+            uint64_t next = findFrame(pos + 1, &first, h);
+            if (next >= limit_) break;
+            audio.gapCount++;
+            audio.gapBytes += next - pos;
+            if (audio.gaps.size() < kMaxStoredGaps) audio.gaps.push_back({ pos, next - pos });
+            pos = next;
+        }
+    }
+
+private:
+    const uint8_t* data_;
+    uint64_t limit_;
+};
+
+// ---------------------------------------------------------------------------
+// ID3v2
+
+// Конец строки с завершающим нулём (двумя нулями для UTF-16) начиная с pos
+size_t skipString(const uint8_t* c, size_t n, size_t pos, bool wide) {
+    if (!wide) {
+        while (pos < n && c[pos] != 0) ++pos;
+        return std::min(pos + 1, n);
+    }
+    while (pos + 1 < n && (c[pos] != 0 || c[pos + 1] != 0)) pos += 2;
+    return std::min(pos + 2, n);
+}
+
+std::string latinString(const uint8_t* c, size_t begin, size_t end) {
+    std::string s(reinterpret_cast<const char*>(c + begin), std::min<size_t>(end - begin, 128));
+    s.erase(std::find(s.begin(), s.end(), '\0'), s.end());
+    return s;
+}
+
+bool isPictureSignature(const uint8_t* p, size_t n) {
+    if (n < 4) return false;
+    return (p[0] == 0xFF && p[1] == 0xD8 && p[2] == 0xFF) || readBE32(p) == 0x89504E47 ||
+        std::memcmp(p, "GIF8", 4) == 0 || (p[0] == 'B' && p[1] == 'M') || std::memcmp(p, "RIFF", 4) == 0;
+}
+
+// Поля APIC/PIC, GEOB и PRIV: описание и начало самого объекта
+void parseFrameContent(Id3Frame& frame, int version, const uint8_t* c, size_t n) {
+    if (n == 0) return;
+    bool wide = c[0] == 1 || c[0] == 2;
+    size_t pos = 0;
+    if (frame.id == "APIC" || frame.id == "PIC") {
+        if (version == 2) {
+            if (n < 5) return;
+            frame.mimeType = latinString(c, 1, 4);
+            pos = 5;
+        }
+        else {
+            size_t mimeEnd = skipString(c, n, 1, false);
+            frame.mimeType = latinString(c, 1, mimeEnd);
+            pos = mimeEnd + 1;                   // тип изображения
+        }
+        if (pos > n) return;
+        size_t descriptionEnd = skipString(c, n, pos, wide);
+        if (!wide) frame.description = latinString(c, pos, descriptionEnd);
+        frame.objectSize = n - descriptionEnd;
+        // "-->" — вместо изображения хранится ссылка
+        frame.knownPicture = frame.mimeType == "-->" || isPictureSignature(c + descriptionEnd, n - descriptionEnd);
+    }
+    else if (frame.id == "GEOB" || frame.id == "GEO") {
+        size_t mimeEnd = skipString(c, n, 1, false);
+        frame.mimeType = latinString(c, 1, mimeEnd);
+        size_t nameEnd = skipString(c, n, mimeEnd, wide);
+        size_t descriptionEnd = skipString(c, n, nameEnd, wide);
+        if (!wide) frame.description = latinString(c, nameEnd, descriptionEnd);
+        frame.objectSize = n - descriptionEnd;
+    }
+    else if (frame.id == "PRIV") {
+        size_t ownerEnd = skipString(c, n, 0, false);
+        frame.description = latinString(c, 0, ownerEnd);
+        frame.objectSize = n - ownerEnd;
+    }
+}
+
+bool isFrameIdChar(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+// Обратная несинхронизация: после каждого 0xFF удаляется вставленный 0x00.
+// В removed — позиции удалённых байтов в восстановленных данных
+void undoUnsynchronisation(const uint8_t* data, size_t size, std::vector<uint8_t>& out,
+    std::vector<size_t>* removed = nullptr) {
+    out.clear();
+    out.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        out.push_back(data[i]);
+        if (data[i] == 0xFF && i + 1 < size && data[i + 1] == 0x00) {
+            if (removed) removed->push_back(out.size());
+            ++i;
+        }
+    }
+}
+
+// Тег в [pos, limit); false — в pos нет заголовка ID3v2
+bool parseId3v2(const uint8_t* data, uint64_t pos, uint64_t limit, Id3Tag& tag) {
+    if (limit - pos < 10 || std::memcmp(data + pos, "ID3", 3) != 0) return false;
+    const uint8_t* h = data + pos;
+    uint32_t bodySize;
+    if (h[3] < 2 || h[3] > 4 || !readSyncSafe(h + 6, bodySize)) return false;
+
+    tag.version = h[3];
+    uint8_t flags = h[5];
+    uint64_t bodyStart = pos + 10;
+    uint64_t bodyEnd = std::min<uint64_t>(bodyStart + bodySize, limit);
+    uint64_t tagEnd = bodyEnd + ((tag.version == 4 && (flags & 0x10)) ? 10 : 0);
+    tag.range = { pos, std::min(tagEnd, limit) - pos };
+    tag.unsynchronised = (flags & 0x80) != 0;
+
+    // Несинхронизация всего тега в v2.2/v2.3; removed нужен, чтобы
+    // пересчитывать смещения кадров в позиции файла. В v2.4 несинхронизация
+    // задаётся флагом каждого кадра и снимается с его данных
+    const uint8_t* body = data + bodyStart;
+    size_t n = static_cast<size_t>(bodyEnd - bodyStart);
+    std::vector<uint8_t> decoded;
+    std::vector<size_t> removed;
+    if (tag.unsynchronised && tag.version < 4) {
+        undoUnsynchronisation(body, n, decoded, &removed);
+        body = decoded.data();
+        n = decoded.size();
+    }
+    auto fileOffset = [&](size_t q) {
+        return bodyStart + q + (std::upper_bound(removed.begin(), removed.end(), q) - removed.begin());
+    };
+
+    size_t q = 0;
+    if (flags & 0x40) {
+        tag.extendedHeader = tag.version > 2;
+        uint32_t extSize = 0;
+        if (tag.version == 2 || n < 4) {
+            tag.unparsed = { bodyStart, bodyEnd - bodyStart };     // v2.2: сжатие всего тега
+            return true;
+        }
+        if (tag.version == 3) q = 4 + static_cast<size_t>(readBE32(body));
+        else q = readSyncSafe(body, extSize) ? extSize : n;
+        if (q > n) q = n;
+    }
+
+    const size_t idLength = tag.version == 2 ? 3 : 4;
+    const size_t headerLength = tag.version == 2 ? 6 : 10;
+    while (q + headerLength <= n) {
+        if (body[q] == 0) {
+            tag.padding = { fileOffset(q), bodyEnd - fileOffset(q) };
+            tag.paddingNonZero = std::any_of(body + q, body + n, [](uint8_t b) { return b != 0; });
+            break;
+        }
+        bool validId = std::all_of(body + q, body + q + idLength, isFrameIdChar);
+        uint64_t frameSize = 0;
+        if (tag.version == 2) {
+            frameSize = (uint32_t(body[q + 3]) << 16) | (uint32_t(body[q + 4]) << 8) | body[q + 5];
+        }
+        else if (tag.version == 3) {
+            frameSize = readBE32(body + q + 4);
+        }
+        else {
+            // Часть кодировщиков пишет в v2.4 обычные 32-битные размеры:
+            // выбирается тот вариант, после которого следует корректный кадр
+            uint32_t syncSafe;
+            uint64_t plain = readBE32(body + q + 4);
+            frameSize = readSyncSafe(body + q + 4, syncSafe) ? syncSafe : plain;
+            uint64_t next = q + headerLength + frameSize;
+            if (frameSize != plain && (next > n || (next + 4 <= n && body[next] != 0 &&
+                !std::all_of(body + next, body + next + 4, isFrameIdChar)))) frameSize = plain;
+        }
+        if (!validId || frameSize > n - q - headerLength) {
+            tag.unparsed = { fileOffset(q), bodyEnd - fileOffset(q) };
+            break;
+        }
+
+        Id3Frame frame;
+        frame.id.assign(reinterpret_cast<const char*>(body + q), idLength);
+        frame.offset = fileOffset(q);
+        frame.size = frameSize;
+        const uint8_t* content = body + q + headerLength;
+        size_t contentSize = static_cast<size_t>(frameSize);
+        // Служебные поля перед данными; сжатые и зашифрованные кадры не разбираются
+        uint16_t frameFlags = tag.version == 2 ? 0 : static_cast<uint16_t>((body[q + 8] << 8) | body[q + 9]);
+        bool opaque = tag.version == 3 ? (frameFlags & 0x00C0) != 0 : (frameFlags & 0x000C) != 0;
+        size_t prefix = 0;
+        if (tag.version == 3 && (frameFlags & 0x0020)) prefix += 1;
+        if (tag.version == 4 && (frameFlags & 0x0040)) prefix += 1;
+        if (tag.version == 4 && (frameFlags & 0x0001)) prefix += 4;
+        if (!opaque && prefix <= contentSize) {
+            const uint8_t* frameData = content + prefix;
+            size_t frameDataSize = contentSize - prefix;
+            std::vector<uint8_t> frameDecoded;
+            if (tag.version == 4 && ((frameFlags & 0x0002) || tag.unsynchronised)) {
+                undoUnsynchronisation(frameData, frameDataSize, frameDecoded);
+                frameData = frameDecoded.data();
+                frameDataSize = frameDecoded.size();
+            }
+            parseFrameContent(frame, tag.version, frameData, frameDataSize);
+        }
+        tag.frames.push_back(std::move(frame));
+        q += headerLength + contentSize;
+    }
+    return true;
+}
+
+} // namespace
+
+bool parseMp3Structure(const uint8_t* data, size_t size, Mp3Structure& mp3) {
+    mp3 = Mp3Structure();
+    uint64_t begin = 0;
+    uint64_t limit = size;
+
+    // Теги в начале файла
+    Id3Tag tag;
+    while (parseId3v2(data, begin, limit, tag)) {
+        begin = tag.range.end();
+        mp3.id3v2.push_back(std::move(tag));
+        tag = Id3Tag();
+    }
+
+    // Теги в конце: ID3v1 (с расширением TAG+), APEv2, ID3v2.4 с колонтитулом
+    for (bool found = true; found && limit > begin;) {
+        found = false;
+        if (!mp3.id3v1 && limit - begin >= 128 && std::memcmp(data + limit - 128, "TAG", 3) == 0) {
+            mp3.id3v1 = true;
+            limit -= 128;
+            if (limit - begin >= 227 && std::memcmp(data + limit - 227, "TAG+", 4) == 0) limit -= 227;
+            found = true;
+        }
+        if (mp3.apeTag.length == 0 && limit - begin >= 32 && std::memcmp(data + limit - 32, "APETAGEX", 8) == 0) {
+            const uint8_t* footer = data + limit - 32;
+            uint64_t tagSize = readLE32(footer + 12) + ((readLE32(footer + 20) & 0x80000000u) ? 32 : 0);
+            if (tagSize >= 32 && tagSize <= limit - begin) {
+                mp3.apeTag = { limit - tagSize, tagSize };
+                limit -= tagSize;
+                found = true;
+            }
+        }
+        uint32_t bodySize;
+        if (limit - begin >= 20 && std::memcmp(data + limit - 10, "3DI", 3) == 0 &&
+            readSyncSafe(data + limit - 4, bodySize) && uint64_t(bodySize) + 20 <= limit - begin) {
+            uint64_t start = limit - 20 - bodySize;
+            Id3Tag appended;
+            if (parseId3v2(data, start, limit, appended)) {
+                mp3.id3v2.push_back(std::move(appended));
+                limit = start;
+                found = true;
+            }
+        }
+    }
+
+    FrameWalker walker(data, limit);
+    walker.walk(begin, mp3.audio);
+    if (mp3.audio.frames == 0) return !mp3.id3v2.empty();
+
+    mp3.leading = { begin, mp3.audio.firstFrame - begin };
+    mp3.trailing = { mp3.audio.end, limit - mp3.audio.end };
+    return true;
+}
@@ -0,0 +1,60 @@
+﻿#ifndef MP3_STRUCTURE_H
+#define MP3_STRUCTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "byte_ranges.h"
+
+// Кадр ID3v2. При несинхронизации всего тега (v2.2/v2.3) смещения
+// пересчитываются в позиции файла, размер — после восстановления байтов
+struct Id3Frame {
+    std::string id;
+    uint64_t offset = 0;          // заголовок кадра в файле
+    uint64_t size = 0;            // данные без заголовка
+    std::string mimeType;         // APIC, GEOB
+    std::string description;      // APIC, GEOB, PRIV (идентификатор владельца)
+    uint64_t objectSize = 0;      // изображение APIC или объект GEOB без полей-описаний
+    bool knownPicture = false;    // данные APIC начинаются с сигнатуры изображения
+};
+
+struct Id3Tag {
+    uint8_t version = 0;          // 2, 3 или 4
+    ByteRange range;              // весь тег, включая заголовок и нижний колонтитул
+    bool unsynchronised = false;
+    bool extendedHeader = false;
+    std::vector<Id3Frame> frames;
+    ByteRange padding;            // нули после последнего кадра
+    bool paddingNonZero = false;
+    ByteRange unparsed;           // байты после повреждённого заголовка кадра
+};
+
+// Поток кадров MPEG-аудио и данные, не принадлежащие ни одному кадру
+struct MpegAudioStream {
+    int version = 0;              // 1, 2 или 25 (MPEG 2.5)
+    int layer = 0;
+    uint32_t sampleRate = 0;
+    uint64_t firstFrame = 0;
+    uint64_t end = 0;             // конец последнего кадра
+    uint64_t frames = 0;
+    std::vector<ByteRange> gaps;  // разрывы между кадрами (не более 1000 первых)
+    size_t gapCount = 0;
+    uint64_t gapBytes = 0;
+};
+
+struct Mp3Structure {
+    std::vector<Id3Tag> id3v2;
+    bool id3v1 = false;                   // тег "TAG" из 128 байт в конце
+    ByteRange apeTag;                     // APEv2 в конце файла
+    MpegAudioStream audio;
+    ByteRange leading;                    // между тегами ID3v2 и первым кадром
+    ByteRange trailing;                   // между последним кадром и концевыми тегами
+};
+
+// Разбор тегов ID3v2.2–2.4 (несинхронизация, расширенный заголовок,
+// колонтитул), ID3v1 и APEv2 и проход по кадрам MPEG с поиском синхрослова
+// векторным ядром. false — не найдено ни тега ID3v2, ни двух подряд идущих кадров
+bool parseMp3Structure(const uint8_t* data, size_t size, Mp3Structure& mp3);
+
+#endif // MP3_STRUCTURE_H
@@ -1,6 +1,9 @@
 ﻿#include "pdf_analyzer.h"
 #include "file_reader.h"
 #include "report_generator.h"
+#include "entropy_profile.h"
+#include "mapped_file.h"
+#include "byte_ranges.h"
 
 #include <iostream>
 #include <filesystem>
@@ -9,6 +12,7 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <string_view>
 
 // ─── PoDoFo ─────────────────────────────────────────────────────────────────────
 #include <podofo/podofo.h>
@@ -41,13 +45,14 @@ PDFAnalyzer::PDFAnalyzer(const std::string& rulesPath, bool deepStreamAnalysis)
 
 std::vector<std::string> PDFAnalyzer::analyzeFile(const std::string& filePath) {
     std::vector<std::string> reportLines;
-    FileReader reader(filePath);
-    std::vector<uint8_t> buffer;
-    if (!reader.loadFile(buffer)) {
+    // Поиск xref и %%EOF идёт прямо по отображению файла без копии в память
+    MappedFile mapped;
+    if (!mapped.open(filePath)) {
         std::cerr << "Ошибка: не удалось открыть файл: " << filePath << "\n";
         reportLines.push_back("Ошибка: не удалось открыть файл.");
         return reportLines;
     }
+    ByteView buffer(mapped.data(), mapped.size());
     // Получение информации о файле
     uintmax_t fileSize = 0;
     try {
@@ -123,14 +128,14 @@ std::vector<std::string> PDFAnalyzer::analyzeFile(const std::string& filePath) {
         reportLines.push_back(encLine);
     }
     // Проверка таблицы кросс-ссылок (xref)
-    std::string bufferStr(reinterpret_cast<char*>(buffer.data()), buffer.size());
+    std::string_view bufferStr(reinterpret_cast<const char*>(buffer.data()), buffer.size());
     size_t xrefCount = 0;
     size_t pos = 0;
-    while ((pos = bufferStr.find("xref", pos)) != std::string::npos) {
+    while ((pos = bufferStr.find("xref", pos)) != std::string_view::npos) {
         xrefCount++;
         pos += 4;
     }
-    bool hasXRefStream = (bufferStr.find("/Type") != std::string::npos && bufferStr.find("/XRef") != std::string::npos);
+    bool hasXRefStream = (bufferStr.find("/Type") != std::string_view::npos && bufferStr.find("/XRef") != std::string_view::npos);
     if (xrefCount == 0) {
         if (hasXRefStream) {
             std::string line = "Cross-reference: используется поток XRef.";
@@ -156,7 +161,7 @@ std::vector<std::string> PDFAnalyzer::analyzeFile(const std::string& filePath) {
     // Проверка завершающего трейлера (%%EOF)
     bool validTrailer = false;
     size_t eofPos = bufferStr.rfind("%%EOF");
-    if (eofPos == std::string::npos) {
+    if (eofPos == std::string_view::npos) {
         std::string line = "- [!] Трейлер PDF (%%EOF) не найден.";
         std::cout << line << "\n";
         reportLines.push_back(line);
@@ -339,18 +344,7 @@ std::vector<std::string> PDFAnalyzer::analyzeFile(const std::string& filePath) {
                         const char* buf = buffer.c_str();
                         if (buf) {
                             size_t outLen = static_cast<size_t>(length);
-                            std::array<size_t, 256> freq{};
-                            freq.fill(0);
-                            for (size_t k = 0; k < outLen; ++k) {
-                                unsigned char c = static_cast<unsigned char>(buf[k]);
-                                freq[c]++;
-                            }
-                            double entropy = 0.0;
-                            for (size_t f : freq) {
-                                if (f == 0) continue;
-                                double p = static_cast<double>(f) / outLen;
-                                entropy -= p * std::log2(p);
-                            }
+                            double entropy = shannonEntropy(reinterpret_cast<const uint8_t*>(buf), outLen);
                             if (entropy > 7.5 && outLen > 100) {
                                 highEntropyFound = true;
                                 std::string line = "- [!] Обнаружен поток с высокой энтропией: " + std::to_string(entropy) + " бит.";
@@ -0,0 +1,351 @@
+﻿#include "pixel_statistics.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+// Значение отсчёта: байт без знака или 2–4 байта little-endian со знаком.
+// 32-битные отсчёты расширяются до 64 бит, чтобы разности не переполнялись
+template <size_t Bytes>
+inline auto loadSample(const uint8_t* p) {
+    if constexpr (Bytes == 1) {
+        return int(p[0]);
+    }
+    else if constexpr (Bytes == 2) {
+        return int(int16_t(uint16_t(p[0] | (p[1] << 8))));
+    }
+    else if constexpr (Bytes == 3) {
+        return int(int32_t((uint32_t(p[0]) << 8) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 24)) >> 8);
+    }
+    else {
+        return int64_t(int32_t(uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24)));
+    }
+}
+
+// Ячейка гистограммы χ²; -1 — широкий отсчёт вне окна вокруг нуля
+template <size_t Bytes, typename T>
+inline int histogramIndex(T v) {
+    if constexpr (Bytes == 1) return int(v);
+    else return (v >= -128 && v < 128) ? int(v) + 128 : -1;
+}
+
+// Гладкость группы: сумма модулей разностей соседних отсчётов
+template <typename T>
+inline T smoothness(T a, T b, T c, T d) {
+    return std::abs(b - a) + std::abs(c - b) + std::abs(d - c);
+}
+
+// F1 меняет LSB (2k <-> 2k+1), F-1 — сдвинутые пары (2k-1 <-> 2k)
+template <typename T>
+inline T flipPositive(T v) { return v ^ 1; }
+template <typename T>
+inline T flipNegative(T v) { return ((v + 1) ^ 1) - 1; }
+
+template <typename T>
+void classifyGroup(T x0, T x1, T x2, T x3, int idx, ChannelStatistics& s) {
+    T f = smoothness(x0, x1, x2, x3);
+    T fPos = smoothness(x0, flipPositive(x1), flipPositive(x2), x3);
+    T fNeg = smoothness(x0, flipNegative(x1), flipNegative(x2), x3);
+    if (fPos > f) s.regular[idx]++;
+    else if (fPos < f) s.singular[idx]++;
+    if (fNeg > f) s.regularNeg[idx]++;
+    else if (fNeg < f) s.singularNeg[idx]++;
+}
+
+// Регуляризованная нижняя неполная гамма-функция P(a, x)
+double gammaP(double a, double x) {
+    if (x <= 0.0) return 0.0;
+    const double eps = 1e-12;
+    const double tiny = 1e-300;
+    double logPrefix = -x + a * std::log(x) - std::lgamma(a);
+
+    if (x < a + 1.0) {
+        double ap = a;
+        double del = 1.0 / a;
+        double sum = del;
+        for (int n = 0; n < 1000; ++n) {
+            ap += 1.0;
+            del *= x / ap;
+            sum += del;
+            if (std::fabs(del) < std::fabs(sum) * eps) break;
+        }
+        return std::min(1.0, sum * std::exp(logPrefix));
+    }
+
+    // Цепная дробь для Q(a, x) (метод Лентца)
+    double b = x + 1.0 - a;
+    double c = 1.0 / tiny;
+    double d = 1.0 / b;
+    double h = d;
+    for (int i = 1; i < 1000; ++i) {
+        double an = -i * (i - a);
+        b += 2.0;
+        d = an * d + b;
+        if (std::fabs(d) < tiny) d = tiny;
+        c = b + an / c;
+        if (std::fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        double del = d * c;
+        h *= del;
+        if (std::fabs(del - 1.0) < eps) break;
+    }
+    return std::max(0.0, 1.0 - std::exp(logPrefix) * h);
+}
+
+// Последовательный обход отсчётов нескольких каналов в порядке растра
+class RasterCursor {
+public:
+    RasterCursor(const SampleView* channels, size_t count) : channels_(channels), count_(count) {}
+
+    // Ячейка гистограммы очередного отсчёта или -1
+    int next() {
+        const SampleView& v = channels_[c_];
+        const uint8_t* p = v.row(row_) + x_ * v.step;
+        int value;
+        switch (v.bytesPerSample) {
+        case 2: value = histogramIndex<2>(loadSample<2>(p)); break;
+        case 3: value = histogramIndex<3>(loadSample<3>(p)); break;
+        case 4: value = histogramIndex<4>(loadSample<4>(p)); break;
+        default: value = p[0]; break;
+        }
+        if (++c_ == count_) {
+            c_ = 0;
+            if (++x_ == channels_[0].width) {
+                x_ = 0;
+                ++row_;
+            }
+        }
+        return value;
+    }
+
+private:
+    const SampleView* channels_;
+    size_t count_;
+    size_t row_ = 0;
+    size_t x_ = 0;
+    size_t c_ = 0;
+};
+
+template <size_t Bytes>
+void accumulateRows(const SampleView& view, size_t rowBegin, size_t rowEnd, ChannelStatistics& s) {
+    using Value = decltype(loadSample<Bytes>(nullptr));
+    const size_t step = view.step;
+    for (size_t r = rowBegin; r < rowEnd && r < view.height; ++r) {
+        const uint8_t* p = view.row(r);
+
+        for (size_t x = 0; x < view.width; ++x) {
+            Value v = loadSample<Bytes>(p + x * step);
+            s.lsbOnes += v & 1;
+            int index = histogramIndex<Bytes>(v);
+            if (index >= 0) s.histogram[index]++;
+        }
+        s.samples += view.width;
+
+        // RS: неперекрывающиеся группы по 4 отсчёта
+        size_t groups = view.width / 4;
+        for (size_t g = 0; g < groups; ++g) {
+            const uint8_t* q = p + g * 4 * step;
+            Value x0 = loadSample<Bytes>(q), x1 = loadSample<Bytes>(q + step),
+                x2 = loadSample<Bytes>(q + 2 * step), x3 = loadSample<Bytes>(q + 3 * step);
+            classifyGroup<Value>(x0, x1, x2, x3, 0, s);
+            classifyGroup<Value>(x0 ^ 1, x1 ^ 1, x2 ^ 1, x3 ^ 1, 1, s);
+        }
+        s.rsGroups += groups;
+
+        // SPA: пары (r, s) соседних отсчётов
+        for (size_t x = 0; x + 1 < view.width; ++x) {
+            Value u = loadSample<Bytes>(p + x * step);
+            Value v = loadSample<Bytes>(p + (x + 1) * step);
+            bool vEven = (v & 1) == 0;
+            if ((vEven && u < v) || (!vEven && u > v)) s.spaX++;
+            if ((vEven && u > v) || (!vEven && u < v)) s.spaY++;
+            if ((u >> 1) == (v >> 1)) s.spaK++;
+        }
+        if (view.width > 1) s.pairs += view.width - 1;
+    }
+}
+
+} // namespace
+
+void ChannelStatistics::merge(const ChannelStatistics& other) {
+    for (int i = 0; i < 256; ++i) histogram[i] += other.histogram[i];
+    samples += other.samples;
+    lsbOnes += other.lsbOnes;
+    rsGroups += other.rsGroups;
+    for (int i = 0; i < 2; ++i) {
+        regular[i] += other.regular[i];
+        singular[i] += other.singular[i];
+        regularNeg[i] += other.regularNeg[i];
+        singularNeg[i] += other.singularNeg[i];
+    }
+    pairs += other.pairs;
+    spaX += other.spaX;
+    spaY += other.spaY;
+    spaK += other.spaK;
+}
+
+void accumulateChannelStatistics(const SampleView& view, size_t rowBegin, size_t rowEnd,
+    ChannelStatistics& s) {
+    switch (view.bytesPerSample) {
+    case 2: accumulateRows<2>(view, rowBegin, rowEnd, s); break;
+    case 3: accumulateRows<3>(view, rowBegin, rowEnd, s); break;
+    case 4: accumulateRows<4>(view, rowBegin, rowEnd, s); break;
+    default: accumulateRows<1>(view, rowBegin, rowEnd, s); break;
+    }
+}
+
+ChannelStatistics computeChannelStatistics(const SampleView& view) {
+    ChannelStatistics total;
+    if (!view.base || view.width == 0 || view.height == 0) return total;
+
+    // Небольшие каналы дешевле посчитать в текущем потоке
+    ThreadPool& pool = ThreadPool::shared();
+    const size_t minSamplesPerBand = 64 * 1024;
+    size_t maxBands = std::max<size_t>(1, view.sampleCount() / minSamplesPerBand);
+    size_t bands = std::min({ maxBands, pool.concurrency() * 4, view.height });
+    if (bands <= 1) {
+        accumulateChannelStatistics(view, 0, view.height, total);
+        return total;
+    }
+
+    size_t rowsPerBand = (view.height + bands - 1) / bands;
+    std::vector<ChannelStatistics> partial(bands);
+    pool.parallelFor(bands, [&](size_t b) {
+        size_t begin = b * rowsPerBand;
+        size_t end = std::min(view.height, begin + rowsPerBand);
+        accumulateChannelStatistics(view, begin, end, partial[b]);
+    });
+    for (const auto& p : partial) total.merge(p);
+    return total;
+}
+
+double chiSquareCdf(double x, double dof) {
+    if (dof <= 0.0) return 0.0;
+    return gammaP(dof / 2.0, x / 2.0);
+}
+
+double chiSquareEmbeddingProbability(const uint64_t histogram[256]) {
+    double chi = 0.0;
+    int categories = 0;
+    for (int k = 0; k < 128; ++k) {
+        double expected = (static_cast<double>(histogram[2 * k]) + histogram[2 * k + 1]) / 2.0;
+        // Пары с малым ожидаемым числом отсчётов искажают критерий
+        if (expected < 5.0) continue;
+        double diff = histogram[2 * k] - expected;
+        chi += diff * diff / expected;
+        categories++;
+    }
+    if (categories < 2) return 0.0;
+    return 1.0 - chiSquareCdf(chi, categories - 1);
+}
+
+double chiSquareAlignedPairsProbability(const uint64_t histogram[256]) {
+    uint64_t shifted[256] = {};
+    std::copy(histogram + 1, histogram + 256, shifted);
+    return std::min(chiSquareEmbeddingProbability(histogram), 1.0 - chiSquareEmbeddingProbability(shifted));
+}
+
+double rsEmbeddingEstimate(const ChannelStatistics& s) {
+    if (s.rsGroups == 0) return -1.0;
+    double n = static_cast<double>(s.rsGroups);
+    double d0 = (static_cast<double>(s.regular[0]) - s.singular[0]) / n;
+    double d1 = (static_cast<double>(s.regular[1]) - s.singular[1]) / n;
+    double dn0 = (static_cast<double>(s.regularNeg[0]) - s.singularNeg[0]) / n;
+    double dn1 = (static_cast<double>(s.regularNeg[1]) - s.singularNeg[1]) / n;
+
+    double a = 2.0 * (d1 + d0);
+    double b = dn0 - dn1 - d1 - 3.0 * d0;
+    double c = d0 - dn0;
+
+    double z;
+    if (std::fabs(a) < 1e-12) {
+        if (std::fabs(b) < 1e-12) return -1.0;
+        z = -c / b;
+    }
+    else {
+        double disc = b * b - 4.0 * a * c;
+        if (disc < 0.0) return -1.0;
+        double sq = std::sqrt(disc);
+        double z1 = (-b + sq) / (2.0 * a);
+        double z2 = (-b - sq) / (2.0 * a);
+        z = std::fabs(z1) < std::fabs(z2) ? z1 : z2;
+    }
+    if (std::fabs(z - 0.5) < 1e-12) return -1.0;
+    double p = z / (z - 0.5);
+    return std::clamp(p, 0.0, 1.0);
+}
+
+double spaEmbeddingEstimate(const ChannelStatistics& s) {
+    if (s.spaK == 0 || s.pairs == 0) return -1.0;
+    // 0.5·k·p² + (2X − P)·p + (Y − X) = 0, берётся меньший корень
+    double a = 0.5 * static_cast<double>(s.spaK);
+    double b = 2.0 * static_cast<double>(s.spaX) - static_cast<double>(s.pairs);
+    double c = static_cast<double>(s.spaY) - static_cast<double>(s.spaX);
+    double disc = b * b - 4.0 * a * c;
+    double p;
+    if (disc < 0.0) {
+        p = -b / (2.0 * a);
+    }
+    else {
+        double sq = std::sqrt(disc);
+        p = std::min((-b + sq) / (2.0 * a), (-b - sq) / (2.0 * a));
+    }
+    return std::clamp(p, 0.0, 1.0);
+}
+
+ChiSquareWindowCurve chiSquareWindowAttack(const SampleView* channels, size_t channelCount,
+    size_t steps, size_t windowSteps) {
+    ChiSquareWindowCurve curve;
+    if (!channels || channelCount == 0 || steps == 0 || windowSteps == 0) return curve;
+    for (size_t c = 0; c < channelCount; ++c) {
+        if (!channels[c].base || channels[c].width != channels[0].width ||
+            channels[c].height != channels[0].height) return curve;
+    }
+
+    auto probability = channels[0].bytesPerSample > 1 ? chiSquareAlignedPairsProbability : chiSquareEmbeddingProbability;
+    curve.totalSamples = channels[0].sampleCount() * channelCount;
+    if (curve.totalSamples < steps) return curve;
+    curve.steps = steps;
+    curve.windowSteps = std::min(windowSteps, steps);
+    curve.growing.reserve(steps);
+    curve.sliding.reserve(steps - curve.windowSteps + 1);
+
+    uint64_t growing[256] = {};
+    uint64_t sliding[256] = {};
+    RasterCursor head(channels, channelCount);
+    RasterCursor tail(channels, channelCount);
+
+    size_t pos = 0;
+    size_t tailPos = 0;
+    for (size_t k = 0; k < steps; ++k) {
+        size_t end = curve.checkpoint(k);
+        for (; pos < end; ++pos) {
+            int v = head.next();
+            if (v < 0) continue;
+            growing[v]++;
+            sliding[v]++;
+        }
+        curve.growing.push_back(probability(growing));
+
+        // Скользящее окно заканчивается на текущей точке; вышедшие отсчёты
+        // вычитаются вторым курсором, отстающим на ширину окна
+        if (k + 1 >= curve.windowSteps) {
+            size_t windowStart = (k + 1 == curve.windowSteps) ? 0 : curve.checkpoint(k - curve.windowSteps);
+            for (; tailPos < windowStart; ++tailPos) {
+                int v = tail.next();
+                if (v >= 0) sliding[v]--;
+            }
+            curve.sliding.push_back(probability(sliding));
+        }
+    }
+
+    // Последовательное встраивание от начала: вероятность остаётся высокой,
+    // пока растущее окно не выйдет за конец сообщения
+    for (size_t k = 0; k < steps && curve.growing[k] > 0.5; ++k) {
+        curve.estimatedPayloadSamples = curve.checkpoint(k);
+    }
+    return curve;
+}
@@ -0,0 +1,96 @@
+﻿#ifndef PIXEL_STATISTICS_H
+#define PIXEL_STATISTICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Представление одного канала без копирования: отсчёты строки идут с шагом
+// step байт, строки — с шагом rowStride. Подходит для чередующихся каналов
+// изображения (base = pixels + c, step = channels) и кадров PCM
+// (base = samples + c * bytesPerSample, step = blockAlign).
+// Отсчёты шире байта — little-endian со знаком, как в WAV
+struct SampleView {
+    const uint8_t* base = nullptr;
+    size_t width = 0;      // отсчётов в строке
+    size_t height = 0;     // количество строк
+    size_t step = 1;       // байт между соседними отсчётами строки
+    size_t rowStride = 0;  // байт между началами строк
+    size_t bytesPerSample = 1;  // 1 (без знака), 2, 3 или 4
+
+    const uint8_t* row(size_t r) const { return base + r * rowStride; }
+    size_t sampleCount() const { return width * height; }
+};
+
+// Накопленная статистика канала для χ²-атаки, RS-анализа и sample pair analysis.
+// У отсчётов шире байта младший байт почти равномерен и χ² по нему ничего не
+// различает, поэтому гистограмма строится по окну значений [-128, 128) вокруг
+// нуля (индекс v + 128, пары 2k/2k+1 сохраняются): тишина и тихие участки
+// дают там неравные пары, которые LSB-встраивание выравнивает
+struct ChannelStatistics {
+    uint64_t histogram[256] = {};
+    uint64_t samples = 0;              // все отсчёты канала
+    uint64_t lsbOnes = 0;              // из них с единичным LSB
+
+    // RS-анализ (Fridrich): группы по 4 отсчёта, маска [0 1 1 0].
+    // Индексы: 0 — исходные данные, 1 — данные с инвертированными LSB
+    uint64_t rsGroups = 0;
+    uint64_t regular[2] = {};          // R_M
+    uint64_t singular[2] = {};         // S_M
+    uint64_t regularNeg[2] = {};       // R_-M
+    uint64_t singularNeg[2] = {};      // S_-M
+
+    // Sample pair analysis (Dumitrescu): пары соседних отсчётов строки
+    uint64_t pairs = 0;
+    uint64_t spaX = 0;
+    uint64_t spaY = 0;
+    uint64_t spaK = 0;
+
+    void merge(const ChannelStatistics& other);
+};
+
+// Статистика по строкам [rowBegin, rowEnd)
+void accumulateChannelStatistics(const SampleView& view, size_t rowBegin, size_t rowEnd,
+    ChannelStatistics& stats);
+
+// Статистика по всему каналу; полосы строк обрабатываются параллельно в общем пуле
+ChannelStatistics computeChannelStatistics(const SampleView& view);
+
+// Вероятность встраивания по χ²-критерию пар значений (Westfeld–Pfitzmann)
+double chiSquareEmbeddingProbability(const uint64_t histogram[256]);
+
+// χ² для отсчётов шире байта: пары 2k/2k+1 выровнены, а сдвинутые пары
+// 2k-1/2k — нет. Гладкая гистограмма громкого сигнала выравнивает обе
+// разбивки одинаково и встраиванием не считается
+double chiSquareAlignedPairsProbability(const uint64_t histogram[256]);
+
+// Оценка доли изменённых LSB методом RS; отрицательное значение — оценка невозможна
+double rsEmbeddingEstimate(const ChannelStatistics& stats);
+
+// Оценка доли встраивания методом sample pair analysis; отрицательное — невозможна
+double spaEmbeddingEstimate(const ChannelStatistics& stats);
+
+// Кривая χ²-атаки по окнам. Отсчёты перебираются в порядке растра
+// (строка, пиксель, канал) — в том порядке, в котором их обходит
+// последовательное LSB-встраивание
+struct ChiSquareWindowCurve {
+    size_t totalSamples = 0;
+    size_t steps = 0;                  // число контрольных точек
+    size_t windowSteps = 0;            // ширина скользящего окна в шагах
+    std::vector<double> growing;       // growing[k]: окно [0, (k+1)/steps)
+    std::vector<double> sliding;       // sliding[k]: окно [k/steps, (k+windowSteps)/steps)
+    size_t estimatedPayloadSamples = 0;  // длина непрерывного встраивания от начала
+
+    size_t checkpoint(size_t k) const { return totalSamples * (k + 1) / steps; }
+};
+
+// Растущее и скользящее окна за один проход: гистограммы обновляются
+// инкрементально, на каждой контрольной точке χ² пересчитывается по 128 парам
+// (для отсчётов шире байта — chiSquareAlignedPairsProbability)
+ChiSquareWindowCurve chiSquareWindowAttack(const SampleView* channels, size_t channelCount,
+    size_t steps = 100, size_t windowSteps = 5);
+
+// Функция распределения χ² с dof степенями свободы
+double chiSquareCdf(double x, double dof);
+
+#endif // PIXEL_STATISTICS_H
@@ -0,0 +1,99 @@
+﻿#include "random_access_file.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+RandomAccessFile::~RandomAccessFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool RandomAccessFile::open(const std::string& filePath) {
+    close();
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    file_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        close();
+        return false;
+    }
+    size_ = static_cast<uint64_t>(size.QuadPart);
+    return true;
+}
+
+void RandomAccessFile::close() {
+    if (file_) CloseHandle(file_);
+    file_ = nullptr;
+    size_ = 0;
+    bytesRead_ = 0;
+}
+
+size_t RandomAccessFile::readAt(uint64_t offset, uint8_t* buffer, size_t size) const {
+    size_t done = 0;
+    while (done < size && offset + done < size_) {
+        DWORD request = static_cast<DWORD>(std::min<size_t>(size - done, 1u << 30));
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>((offset + done) & 0xFFFFFFFFu);
+        overlapped.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+        DWORD received = 0;
+        if (!ReadFile(file_, buffer + done, request, &received, &overlapped) || received == 0) break;
+        done += received;
+    }
+    bytesRead_.fetch_add(done, std::memory_order_relaxed);
+    return done;
+}
+
+#else
+
+bool RandomAccessFile::open(const std::string& filePath) {
+    close();
+    fd_ = ::open(filePath.c_str(), O_RDONLY);
+    if (fd_ < 0) return false;
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close();
+        return false;
+    }
+    size_ = static_cast<uint64_t>(st.st_size);
+#ifdef POSIX_FADV_RANDOM
+    // Блоки выборки разбросаны по файлу: упреждающее чтение только тратит бюджет
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_RANDOM);
+#endif
+    return true;
+}
+
+void RandomAccessFile::close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    size_ = 0;
+    bytesRead_ = 0;
+}
+
+size_t RandomAccessFile::readAt(uint64_t offset, uint8_t* buffer, size_t size) const {
+    size_t done = 0;
+    while (done < size && offset + done < size_) {
+        ssize_t received = pread(fd_, buffer + done, size - done, static_cast<off_t>(offset + done));
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) break;
+        done += static_cast<size_t>(received);
+    }
+    bytesRead_.fetch_add(done, std::memory_order_relaxed);
+    return done;
+}
+
+#endif
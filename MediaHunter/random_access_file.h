@@ -0,0 +1,47 @@
+﻿#ifndef RANDOM_ACCESS_FILE_H
+#define RANDOM_ACCESS_FILE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Файл для чтения по смещению (pread, ReadFile с OVERLAPPED) без общего
+// указателя позиции: несколько потоков читают разные участки одновременно,
+// а в память попадают только запрошенные байты
+class RandomAccessFile {
+public:
+    RandomAccessFile() = default;
+    ~RandomAccessFile();
+
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+    bool open(const std::string& filePath);
+    void close();
+
+    uint64_t size() const { return size_; }
+
+    // Число прочитанных байтов; меньше size только в конце файла или при
+    // ошибке чтения
+    size_t readAt(uint64_t offset, uint8_t* buffer, size_t size) const;
+
+    // Сколько байтов прочитано с момента открытия
+    uint64_t bytesRead() const { return bytesRead_.load(std::memory_order_relaxed); }
+
+#ifndef _WIN32
+    // Дескриптор для асинхронного чтения (io_uring)
+    int descriptor() const { return fd_; }
+#endif
+
+private:
+    uint64_t size_ = 0;
+    mutable std::atomic<uint64_t> bytesRead_{ 0 };
+#ifdef _WIN32
+    void* file_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+#endif // RANDOM_ACCESS_FILE_H
@@ -0,0 +1,300 @@
+﻿#include "sampling_analyzer.h"
+#include "random_access_file.h"
+#include "file_reader.h"
+#include "signature_scanner.h"
+#include "entropy_profile.h"
+#include "lsb_kernels.h"
+#include "embedded_files.h"
+#include "byte_ranges.h"
+#include "thread_pool.h"
+#include "buffer_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const size_t kBlockSize = 64 * 1024;
+const size_t kBlockAlignment = 4096;
+const uint64_t kEdgeBytes = 1024 * 1024;     // заголовок и хвост
+const double kHighEntropy = 7.9;             // тот же порог, что у энтропийной карты
+const double kZ = 1.96;                      // 95% доверительный интервал
+
+// Форматы без сжатия: высокоэнтропийный блок в них — признак вложения
+bool isUncompressedFormat(const std::string& format) {
+    return format == "BMP" || format == "PSD" || format == "EMF" || format == "WMF";
+}
+
+// Форматы, для которых полный анализ проверяет долю единиц в LSB
+bool isLsbFormat(const std::string& format) {
+    return format == "JPEG" || format == "PNG" || format == "BMP" || format == "GIF" ||
+        format == "TIFF" || format == "WEBP" || format == "PSD";
+}
+
+// Границы нормальной доли единиц в LSB — как в полном LSB-анализе
+const double kLsbLow = 48.0;
+const double kLsbHigh = 49.5;
+
+struct Interval {
+    double estimate = 0.0;
+    double low = 0.0;
+    double high = 0.0;
+};
+
+// Среднее по стратифицированной выборке с одним блоком на страту равного
+// размера. Дисперсия между страт оценивается по выборочной дисперсии (это
+// даёт консервативный интервал), fraction — доля прочитанной средней части
+// для поправки на конечную совокупность
+Interval meanInterval(const std::vector<double>& values, double fraction) {
+    Interval result;
+    size_t n = values.size();
+    if (n == 0) return result;
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    result.estimate = sum / n;
+    double variance = 0.0;
+    for (double v : values) variance += (v - result.estimate) * (v - result.estimate);
+    variance = n > 1 ? variance / (n - 1) : 0.0;
+    double se = std::sqrt(variance / n * std::max(0.0, 1.0 - fraction));
+    result.low = result.estimate - kZ * se;
+    result.high = result.estimate + kZ * se;
+    return result;
+}
+
+// Интервал Уилсона для доли: остаётся осмысленным при долях около 0 и 1
+Interval proportionInterval(size_t hits, size_t n) {
+    Interval result;
+    if (n == 0) return result;
+    double p = static_cast<double>(hits) / n;
+    double z2 = kZ * kZ;
+    double denominator = 1.0 + z2 / n;
+    double center = (p + z2 / (2.0 * n)) / denominator;
+    double half = kZ * std::sqrt(p * (1.0 - p) / n + z2 / (4.0 * n * n)) / denominator;
+    result.estimate = p;
+    result.low = std::max(0.0, center - half);
+    result.high = std::min(1.0, center + half);
+    return result;
+}
+
+void emit(std::vector<std::string>& lines, const std::string& line) {
+    lines.push_back(line);
+    std::cout << line << "\n";
+}
+
+} // namespace
+
+SamplingAnalyzer::SamplingAnalyzer(const std::string& rulesPath, uint64_t ioBudget)
+    : full_(rulesPath), ioBudget_(std::max<uint64_t>(ioBudget, 4 * kBlockSize)) {
+}
+
+std::vector<std::string> SamplingAnalyzer::analyzeFile(const std::string& filePath) {
+    std::vector<std::string> lines;
+
+    RandomAccessFile file;
+    if (!file.open(filePath)) {
+        std::cerr << "Ошибка: файл не найден или недоступен: " << filePath << "\n";
+        lines.push_back("Ошибка: файл не найден или недоступен.");
+        return lines;
+    }
+    const uint64_t size = file.size();
+
+    std::cout << "========================================\n";
+    std::cout << "Выборочный анализ файла: " << filePath << "\n";
+
+    if (size <= ioBudget_) {
+        emit(lines, "- Размер файла (" + std::to_string(size) + " байт) не больше бюджета чтения (" +
+            std::to_string(ioBudget_) + " байт): выполняется полный анализ");
+        file.close();
+        std::vector<std::string> fullLines = full_.analyzeFile(filePath);
+        lines.insert(lines.end(), fullLines.begin(), fullLines.end());
+        return lines;
+    }
+
+    // Заголовок и хвост читаются целиком, на них приходится не больше
+    // половины бюджета; остальное делится на блоки выборки
+    const uint64_t edgeBytes = std::min(kEdgeBytes, ioBudget_ / 4);
+    PooledBuffer header(static_cast<size_t>(edgeBytes));
+    PooledBuffer tail(static_cast<size_t>(edgeBytes));
+    const uint64_t tailOffset = size - edgeBytes;
+    header.resize(file.readAt(0, header.data(), header.size()));
+    tail.resize(file.readAt(tailOffset, tail.data(), tail.size()));
+
+    std::vector<uint8_t> signature(header.data(), header.data() + std::min<size_t>(header.size(), 64));
+    std::string format = FileReader(std::string()).detectFileType(signature);
+    emit(lines, "- Формат: " + format + ", размер " + std::to_string(size) + " байт");
+
+    bool anomaly = false;
+    std::vector<std::string> reasons;
+
+    // Вложенные файлы и данные после конца формата чаще всего оказываются
+    // в начале или в конце контейнера
+    bool embedded = false;
+    for (const EmbeddedFile& found : findEmbeddedFiles(header.data(), header.size())) {
+        emit(lines, "- [!] Вложенный файл " + found.type + " (" + found.detail + ") в заголовке: " + formatByteRange(found.range));
+        embedded = true;
+    }
+    for (const EmbeddedFile& found : findEmbeddedFiles(tail.data(), tail.size())) {
+        ByteRange range{ tailOffset + found.range.offset, found.range.length };
+        emit(lines, "- [!] Вложенный файл " + found.type + " (" + found.detail + ") в хвосте: " + formatByteRange(range));
+        embedded = true;
+    }
+    if (embedded) {
+        anomaly = true;
+        reasons.push_back("вложенные файлы в заголовке или хвосте");
+    }
+
+    try {
+        SignatureScanner& scanner = full_.signatureScanner();
+        std::string headerThreat = scanner.analyzeMemory(header.data(), header.size());
+        std::string tailThreat = scanner.analyzeMemory(tail.data(), tail.size());
+        if (headerThreat == "OK" && tailThreat == "OK") {
+            emit(lines, "- YARA (заголовок и хвост): угроз не обнаружено");
+        }
+        else {
+            emit(lines, "- [!] YARA (заголовок и хвост): обнаружена угроза " + (headerThreat != "OK" ? headerThreat : tailThreat));
+            anomaly = true;
+            reasons.push_back("сигнатура YARA");
+        }
+    }
+    catch (const std::exception& e) {
+        emit(lines, std::string("Ошибка при сигнатурном анализе выборки: ") + e.what());
+    }
+
+    // Средняя часть делится на равные страты, в каждой блок берётся со
+    // случайного выровненного смещения. Генератор зависит только от пути и
+    // размера, поэтому повторный запуск читает те же блоки
+    const uint64_t middleStart = edgeBytes;
+    const uint64_t middleSize = tailOffset > middleStart ? tailOffset - middleStart : 0;
+    const uint64_t sampleBudget = ioBudget_ - 2 * edgeBytes;
+    const size_t count = static_cast<size_t>(std::min(sampleBudget / kBlockSize, middleSize / kBlockSize));
+
+    std::vector<uint64_t> offsets(count);
+    std::mt19937_64 random(std::hash<std::string>()(filePath) ^ size);
+    const uint64_t stratum = count ? middleSize / count : 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t slack = stratum - kBlockSize;
+        uint64_t shift = slack ? random() % (slack + 1) : 0;
+        offsets[i] = (middleStart + i * stratum + shift) / kBlockAlignment * kBlockAlignment;
+        offsets[i] = std::max(offsets[i], middleStart);
+    }
+
+    std::vector<double> entropies(count, 0.0);
+    std::vector<double> lsbShares(count, 0.0);
+    std::vector<char> valid(count, 0);
+    ThreadPool::shared().parallelFor(count, [&](size_t i) {
+        PooledBuffer block(kBlockSize);
+        size_t got = file.readAt(offsets[i], block.data(), block.size());
+        if (got < kBlockSize) return;
+        BitPlaneCounts planes;
+        countBitPlanes(block.data(), got, planes);
+        entropies[i] = shannonEntropy(block.data(), got);
+        lsbShares[i] = planes.percent(0);
+        valid[i] = 1;
+    });
+
+    std::vector<double> entropyValues;
+    std::vector<double> lsbValues;
+    size_t highBlocks = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!valid[i]) continue;
+        entropyValues.push_back(entropies[i]);
+        lsbValues.push_back(lsbShares[i]);
+        if (entropies[i] >= kHighEntropy) highBlocks++;
+    }
+    const size_t sampled = entropyValues.size();
+    const double fraction = middleSize ? static_cast<double>(sampled) * kBlockSize / middleSize : 1.0;
+
+    std::ostringstream plan;
+    plan << std::fixed << std::setprecision(2)
+        << "- Выборка: блоков " << sampled << " по " << kBlockSize / 1024 << " КБ из " << count
+        << " страт, заголовок и хвост по " << edgeBytes << " байт; прочитано " << file.bytesRead()
+        << " из " << size << " байт (" << 100.0 * file.bytesRead() / size << "%), бюджет " << ioBudget_ << " байт";
+    emit(lines, plan.str());
+
+    if (sampled >= 2) {
+        Interval entropy = meanInterval(entropyValues, fraction);
+        Interval high = proportionInterval(highBlocks, sampled);
+        Interval lsb = meanInterval(lsbValues, fraction);
+
+        std::ostringstream entropyLine;
+        entropyLine << std::fixed << std::setprecision(3)
+            << "- Энтропия (выборка): средняя " << entropy.estimate << " бит/байт, 95% ДИ "
+            << entropy.low << "–" << entropy.high;
+        emit(lines, entropyLine.str());
+
+        std::ostringstream highLine;
+        highLine << std::fixed << std::setprecision(1)
+            << "- Высокоэнтропийные блоки (от " << kHighEntropy << " бит/байт): " << 100.0 * high.estimate
+            << "%, 95% ДИ " << 100.0 * high.low << "–" << 100.0 * high.high << "%";
+        emit(lines, highLine.str());
+
+        std::ostringstream lsbLine;
+        lsbLine << std::fixed << std::setprecision(2)
+            << "- LSB (выборка): доля единиц " << lsb.estimate << "%, 95% ДИ " << lsb.low << "–" << lsb.high << "%";
+        emit(lines, lsbLine.str());
+
+        if (isUncompressedFormat(format) && highBlocks > 0) {
+            anomaly = true;
+            reasons.push_back("высокоэнтропийные блоки в несжатом формате");
+        }
+        if (isLsbFormat(format)) {
+            if (lsb.estimate < kLsbLow || lsb.estimate > kLsbHigh) {
+                anomaly = true;
+                reasons.push_back("доля единиц в LSB вне нормы");
+            }
+            else if (lsb.low < kLsbLow || lsb.high > kLsbHigh) {
+                // Оценка в норме, но интервал выходит за её границы — выборки
+                // не хватает, чтобы исключить аномалию
+                anomaly = true;
+                reasons.push_back("доверительный интервал LSB выходит за границы нормы");
+            }
+        }
+    }
+    else {
+        emit(lines, "- Блоков выборки недостаточно для оценки");
+        anomaly = true;
+        reasons.push_back("недостаточно блоков выборки");
+    }
+
+    if (!anomaly) {
+        emit(lines, "- Оценка в пределах нормы, полный анализ не требуется");
+        return lines;
+    }
+
+    std::string reasonText;
+    for (size_t i = 0; i < reasons.size(); ++i) {
+        reasonText += (i ? ", " : "") + reasons[i];
+    }
+    emit(lines, "- [!] Выборочная оценка аномальна (" + reasonText + "): выполняется полный анализ");
+    file.close();
+    std::vector<std::string> fullLines = full_.analyzeFile(filePath);
+    lines.insert(lines.end(), fullLines.begin(), fullLines.end());
+    return lines;
+}
+
+std::vector<std::pair<std::string, std::vector<std::string>>> SamplingAnalyzer::analyzeDirectory(const std::string& dirPath) {
+    std::vector<std::pair<std::string, std::vector<std::string>>> reports;
+
+    if (!fs::exists(dirPath) || !fs::is_directory(dirPath)) {
+        std::cerr << "Ошибка: директория не найдена или недоступна: " << dirPath << "\n";
+        return reports;
+    }
+
+    for (const auto& entry : fs::directory_iterator(dirPath)) {
+        if (!entry.is_regular_file()) continue;
+        std::string filePath = entry.path().string();
+
+        auto lines = analyzeFile(filePath);
+        reports.emplace_back(filePath, lines);
+        std::cout << "\n";
+    }
+
+    return reports;
+}
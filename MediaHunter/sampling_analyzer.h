@@ -0,0 +1,32 @@
+﻿#ifndef SAMPLING_ANALYZER_H
+#define SAMPLING_ANALYZER_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "full_analyzer.h"
+
+// Выборочный анализ многогигабайтных файлов для быстрой сортировки: читаются
+// заголовок, хвост и по одному блоку из каждой равной страты средней части
+// файла. По блокам оцениваются энтропия и доля единиц в младших битах с
+// доверительными интервалами; полный анализ выполняется, только если оценка
+// аномальна или неопределённа, либо в заголовке и хвосте найдены вложенные
+// файлы или сигнатуры YARA
+class SamplingAnalyzer {
+public:
+    static constexpr uint64_t kDefaultIoBudget = 64ULL * 1024ULL * 1024ULL;
+
+    // ioBudget — сколько байт файла можно прочитать для выборки; файлы не
+    // больше бюджета сразу анализируются полностью
+    explicit SamplingAnalyzer(const std::string& rulesPath = "rules.yar", uint64_t ioBudget = kDefaultIoBudget);
+
+    std::vector<std::string> analyzeFile(const std::string& filePath);
+    std::vector<std::pair<std::string, std::vector<std::string>>> analyzeDirectory(const std::string& dirPath);
+
+private:
+    FullAnalyzer full_;
+    uint64_t ioBudget_;
+};
+
+#endif // SAMPLING_ANALYZER_H
@@ -73,6 +73,25 @@ std::string SignatureScanner::analyzeFile(const std::string& filePath) {
     return matchedRule.empty() ? "OK" : matchedRule;
 }
 
+std::string SignatureScanner::analyzeMemory(const uint8_t* data, size_t size) {
+    std::string matchedRule;
+    int res = yr_rules_scan_mem(
+        rules_,
+        data,
+        size,
+        0,
+        yaraCallback,
+        &matchedRule,
+        0
+    );
+
+    if (res != ERROR_SUCCESS && res != ERROR_SCAN_TIMEOUT) {
+        std::cerr << "YARA ошибка " << res << " при сканировании участка памяти" << std::endl;
+    }
+
+    return matchedRule.empty() ? "OK" : matchedRule;
+}
+
 int SignatureScanner::yaraCallback(
     YR_SCAN_CONTEXT* ctx,
     int message,
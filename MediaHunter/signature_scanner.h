@@ -4,6 +4,8 @@
 
 #include <string>
 #include <stdexcept>
+#include <cstddef>
+#include <cstdint>
 
 #ifdef _WIN32
 #define NOMINMAX
@@ -21,6 +23,8 @@ public:
     explicit SignatureScanner(const std::string& rulesPath = "rules.yar");
     ~SignatureScanner();
     std::string analyzeFile(const std::string& filePath);
+    // Сканирование участка памяти (например, файла, вырезанного из другого)
+    std::string analyzeMemory(const uint8_t* data, size_t size);
 
 private:
     YR_RULES* rules_;
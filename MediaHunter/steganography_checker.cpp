@@ -1,24 +1,263 @@
 ﻿#include "steganography_checker.h"
 #include "file_reader.h"
 #include "report_generator.h"
+#include "lsb_kernels.h"
+#include "image_decoder.h"
+#include "pixel_statistics.h"
+#include "entropy_profile.h"
+#include "jpeg_coefficients.h"
+#include "jpeg_segments.h"
+#include "crc32.h"
+#include "byte_ranges.h"
+#include "inflate_stream.h"
+#include "fourcc.h"
+#include "gif_structure.h"
+#include "tiff_structure.h"
+#include "bmp_structure.h"
+#include "webp_structure.h"
+#include "isobmff_structure.h"
+#include "ebml_structure.h"
+#include "mp3_structure.h"
+#include "wav_structure.h"
+#include "embedded_files.h"
+#include "signature_scanner.h"
+#include "byte_search.h"
+#include "mapped_file.h"
+#include "random_access_file.h"
+#include "chunk_source.h"
+#include "file_prefetcher.h"
+#include "thread_pool.h"
+#include "console_output.h"
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 #include <chrono>
 #include <ctime>
 #include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// Ограничения повторного анализа вложенных участков
+constexpr size_t kMaxChildDepth = 3;
+constexpr size_t kMaxChildJobs = 16;
+constexpr uint64_t kMinChildBytes = 16;
+constexpr uint64_t kMaxChildBytes = 512ULL * 1024ULL * 1024ULL;
+
+// Отступ вывода дочернего задания относительно родителя
+std::string indentLines(const std::string& text) {
+    std::string out;
+    out.reserve(text.size() + text.size() / 16);
+    bool lineStart = true;
+    for (char c : text) {
+        if (lineStart) out += "  ";
+        out += c;
+        lineStart = c == '\n';
+    }
+    return out;
+}
+
+// APP1 содержит EXIF либо XMP (основной пакет или расширение)
+bool isKnownApp1Header(const uint8_t* payload, size_t size) {
+    static const char exif[] = "Exif\0";
+    static const char xmp[] = "http://ns.adobe.com/xap/1.0/";
+    static const char xmpExtension[] = "http://ns.adobe.com/xmp/extension/";
+    auto startsWith = [&](const char* prefix, size_t length) {
+        return size >= length && std::memcmp(payload, prefix, length) == 0;
+    };
+    return startsWith(exif, sizeof(exif)) || startsWith(xmp, sizeof(xmp)) ||
+        startsWith(xmpExtension, sizeof(xmpExtension));
+}
+
+// Зарегистрированные типы чанков PNG: спецификация (включая APNG, eXIf,
+// cICP/mDCV/cLLI), общедоступные расширения и iDOT из снимков экрана macOS
+constexpr auto kPngChunks = makeFourCCSet(std::array<uint32_t, 35>{
+    fourCC("IHDR"), fourCC("PLTE"), fourCC("IDAT"), fourCC("IEND"),
+    fourCC("tRNS"), fourCC("cHRM"), fourCC("gAMA"), fourCC("iCCP"), fourCC("sBIT"), fourCC("sRGB"),
+    fourCC("cICP"), fourCC("mDCV"), fourCC("cLLI"),
+    fourCC("tEXt"), fourCC("zTXt"), fourCC("iTXt"),
+    fourCC("bKGD"), fourCC("hIST"), fourCC("pHYs"), fourCC("sPLT"), fourCC("eXIf"), fourCC("tIME"),
+    fourCC("acTL"), fourCC("fcTL"), fourCC("fdAT"),
+    fourCC("oFFs"), fourCC("pCAL"), fourCC("sCAL"), fourCC("gIFg"), fourCC("gIFt"), fourCC("gIFx"),
+    fourCC("sTER"), fourCC("dSIG"), fourCC("fRAc"), fourCC("iDOT") });
+
+// Чанки контейнера WebP (RIFF)
+constexpr auto kWebpChunks = makeFourCCSet(std::array<uint32_t, 9>{
+    fourCC("VP8 "), fourCC("VP8L"), fourCC("VP8X"), fourCC("ALPH"), fourCC("ANIM"),
+    fourCC("ANMF"), fourCC("ICCP"), fourCC("EXIF"), fourCC("XMP ") });
+
+// Боксы верхнего уровня ISO-BMFF (ISO/IEC 14496-12, QuickTime, HEIF)
+constexpr auto kIsoTopLevelBoxes = makeFourCCSet(std::array<uint32_t, 18>{
+    fourCC("ftyp"), fourCC("styp"), fourCC("moov"), fourCC("mdat"), fourCC("free"),
+    fourCC("skip"), fourCC("wide"), fourCC("meta"), fourCC("moof"), fourCC("mfra"),
+    fourCC("sidx"), fourCC("ssix"), fourCC("prft"), fourCC("emsg"), fourCC("pdin"),
+    fourCC("uuid"), fourCC("pnot"), fourCC("bloc") });
+
+// Чанки RIFF/WAVE: спецификация Microsoft, Broadcast Wave (bext, iXML),
+// метаданные сэмплеров и редакторов, заполнение (JUNK, PAD, FLLR)
+constexpr auto kWavChunks = makeFourCCSet(std::array<uint32_t, 28>{
+    fourCC("fmt "), fourCC("data"), fourCC("fact"), fourCC("LIST"), fourCC("cue "), fourCC("plst"),
+    fourCC("smpl"), fourCC("inst"), fourCC("labl"), fourCC("note"), fourCC("ltxt"), fourCC("wavl"),
+    fourCC("slnt"), fourCC("bext"), fourCC("iXML"), fourCC("cart"), fourCC("umid"), fourCC("PEAK"),
+    fourCC("DISP"), fourCC("acid"), fourCC("id3 "), fourCC("ID3 "), fourCC("_PMX"), fourCC("minf"),
+    fourCC("JUNK"), fourCC("junk"), fourCC("PAD "), fourCC("FLLR") });
+
+// Форматы на основе ISO-BMFF: разбираются по отображению файла без чтения mdat
+bool isIsoBmffFormat(const std::string& format) {
+    return format == "MP4" || format == "MOV" || format == "HEIF" || format == "AVIF";
+}
+
+// Matroska и WebM: разбираются по отображению файла без чтения кластеров
+bool isMatroskaFormat(const std::string& format) {
+    return format == "MKV" || format == "WebM";
+}
+
+// Форматы, для которых есть проверки структуры и статистики
+bool isSupportedFormat(const std::string& format) {
+    static const std::vector<std::string> supported = {
+        "JPEG", "PNG", "BMP", "GIF", "TIFF", "CR2", "NEF", "DNG", "PSD", "WEBP", "EMF", "WMF",
+        "MP4", "MOV", "HEIF", "AVIF", "MKV", "WebM", "MP3", "WAV"
+    };
+    return std::find(supported.begin(), supported.end(), format) != supported.end();
+}
+
+// Типичные вложения Matroska — шрифты для субтитров и обложки
+bool isFontMimeType(const std::string& mime) {
+    return mime.rfind("font/", 0) == 0 || mime.rfind("application/x-font", 0) == 0 ||
+        mime == "application/x-truetype-font" || mime == "application/vnd.ms-opentype" ||
+        mime == "application/font-sfnt" || mime == "application/font-woff";
+}
+
+// Сигнатура содержимого соответствует заявленному типу MIME;
+// для прочих типов проверка не выполняется
+bool attachmentMatchesMime(const std::string& mime, const uint8_t* data, size_t size) {
+    if (size < 4) return false;
+    uint32_t magic = readFourCC(data);
+    if (isFontMimeType(mime)) {
+        return magic == 0x00010000 || magic == fourCC("OTTO") || magic == fourCC("true") ||
+            magic == fourCC("ttcf") || magic == fourCC("wOFF") || magic == fourCC("wOF2");
+    }
+    if (mime == "image/jpeg" || mime == "image/jpg") return data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+    if (mime == "image/png") return magic == 0x89504E47;
+    return true;
+}
+
+inline uint32_t readBE32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+// Размер распакованных данных IDAT по заголовку IHDR (с байтом фильтра в каждой строке)
+uint64_t expectedPngRawSize(uint32_t width, uint32_t height, uint8_t bitDepth, uint8_t colorType, bool interlaced) {
+    static const int channelsByType[7] = { 1, 0, 3, 1, 2, 0, 4 };
+    if (colorType > 6 || channelsByType[colorType] == 0) return 0;
+    uint64_t bitsPerPixel = uint64_t(channelsByType[colorType]) * bitDepth;
+    auto passSize = [&](uint64_t w, uint64_t h) -> uint64_t {
+        if (w == 0 || h == 0) return 0;
+        return h * (1 + (w * bitsPerPixel + 7) / 8);
+    };
+    if (!interlaced) return passSize(width, height);
+
+    // Adam7: начало и шаг каждого из семи проходов
+    static const int passes[7][4] = {
+        { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 },
+        { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 } };
+    uint64_t total = 0;
+    for (const auto& p : passes) {
+        uint64_t w = width > uint32_t(p[0]) ? (width - p[0] + p[2] - 1) / p[2] : 0;
+        uint64_t h = height > uint32_t(p[1]) ? (height - p[1] + p[3] - 1) / p[3] : 0;
+        total += passSize(w, h);
+    }
+    return total;
+}
+
+// Доля управляющих символов (кроме табуляции и перевода строки) в тексте
+bool looksBinary(const std::vector<uint8_t>& text) {
+    if (text.empty()) return false;
+    size_t control = 0;
+    for (uint8_t c : text) {
+        if (c < 0x20 && c != '\t' && c != '\n' && c != '\r') control++;
+    }
+    return control * 20 > text.size();
+}
+
+// Расширения приложений, которые записывают распространённые кодировщики
+bool isKnownGifApplication(const std::string& id) {
+    static const char* const known[] = {
+        "NETSCAPE2.0", "ANIMEXTS1.0", "XMP DataXMP", "ICCRGBG1012",
+        "MGK8BIM0000", "MGKIPTC0000", "ImageMagick"
+    };
+    for (const char* name : known) {
+        if (id == name) return true;
+    }
+    return false;
+}
+
+std::string printableText(const std::string& text) {
+    std::string out = text;
+    for (char& c : out) {
+        if (static_cast<unsigned char>(c) < 0x20 || c == 0x7F) c = '?';
+    }
+    return out;
+}
+
+// Содержимое участков оценивается по первому мегабайту, чтобы не
+// подгружать с диска многогигабайтные области целиком
+const uint64_t kInspectLimit = 1 << 20;
+
+// Строки отчёта анализаторов структуры: report отмечает аномалию, inform
+// только выводит строку
+struct StructureReporter {
+    std::vector<std::string>& lines;
+    ByteView data;
+    bool anomaly = false;
+
+    void inform(const std::string& line) {
+        lines.push_back(line);
+        console() << line << "\n";
+    }
+    void report(const std::string& line) {
+        inform(line);
+        anomaly = true;
+    }
+    size_t inspected(const ByteRange& range) const {
+        return static_cast<size_t>(std::min(range.length, kInspectLimit));
+    }
+    // Участок и энтропия его начала
+    std::string describe(const ByteRange& range) const {
+        std::ostringstream line;
+        line << formatByteRange(range) << ", энтропия " << std::fixed << std::setprecision(2)
+            << shannonEntropy(data.data() + range.offset, inspected(range));
+        return line.str();
+    }
+    // Проверяется весь участок: ограничение kInspectLimit здесь позволило
+    // бы спрятать данные за мегабайтом нулей
+    bool zeroFilled(const ByteRange& range) const {
+        const size_t length = static_cast<size_t>(range.length);
+        return findNonZeroByte(data.data() + range.offset, length) == length;
+    }
+};
+} // namespace
+
 std::vector<std::string> SteganographyChecker::analyzeFile(const std::string& filePath) {
     std::vector<std::string> reportLines;
     FileReader reader(filePath);
-    std::vector<uint8_t> buffer;
-    if (!reader.loadFile(buffer)) {
-        std::cout << "Ошибка: не удалось открыть файл: " << filePath << "\n";
+    MappedFile mapped;
+    RandomAccessFile file;
+    if (!mapped.open(filePath) || !file.open(filePath)) {
+        console() << "Ошибка: не удалось открыть файл: " << filePath << "\n";
         reportLines.push_back("Ошибка: не удалось открыть файл.");
         return reportLines;
     }
-    std::string format = reader.detectFileType(buffer);
+    // Все форматы разбираются прямо по отображению: разборщики структуры
+    // затрагивают только нужные страницы, а проходы по всем байтам читают
+    // файл порциями через chunkSource, поэтому копия файла в памяти не нужна
+    const size_t signatureBytes = 64;
+    std::vector<uint8_t> signature(mapped.data(), mapped.data() + std::min(mapped.size(), signatureBytes));
+    std::string format = reader.detectFileType(signature);
 
     uintmax_t fileSize = 0;
     try {
@@ -52,49 +291,79 @@ std::vector<std::string> SteganographyChecker::analyzeFile(const std::string& fi
     reportLines.push_back("Размер: " + std::to_string(fileSize) + " байт");
     reportLines.push_back("Дата изменения: " + dateStr);
 
-    std::cout << "========================================\n";
-    std::cout << "Анализ файла: " << filePath << "\n";
-    std::cout << "Формат: " << format << "\n";
-    std::cout << "Размер: " << fileSize << " байт\n";
-    std::cout << "Дата изменения: " << dateStr << "\n";
-
-    static const std::vector<std::string> relevant = {
-        "JPEG", "PNG", "BMP", "GIF", "TIFF", "PSD", "WEBP", "EMF", "WMF"
-    };
-    bool isRelevant = false;
-    for (const auto& f : relevant) {
-        if (format == f) { isRelevant = true; break; }
-    }
+    console() << "========================================\n";
+    console() << "Анализ файла: " << filePath << "\n";
+    console() << "Формат: " << format << "\n";
+    console() << "Размер: " << fileSize << " байт\n";
+    console() << "Дата изменения: " << dateStr << "\n";
 
     bool threatDetected = false;
-    if (!isRelevant) {
+    if (!isSupportedFormat(format)) {
         reportLines.push_back("Формат не поддерживается для стеганографического анализа.");
-        std::cout << "Формат не поддерживается для стеганографического анализа.\n";
+        console() << "Формат не поддерживается для стеганографического анализа.\n";
     }
     else {
-        threatDetected = analyzeBuffer(filePath, format, buffer, reportLines);
+        file_ = &file;
+        fileView_ = ByteView(mapped.data(), mapped.size());
+        threatDetected = analyzeData(format, fileView_, reportLines, 0);
+        file_ = nullptr;
+        fileView_ = ByteView();
     }
 
     if (threatDetected) {
-        std::cout << "Результат: Возможна стеганография!\n";
+        console() << "Результат: Возможна стеганография!\n";
     }
     else {
-        std::cout << "Результат: Стеганография не обнаружена.\n";
+        console() << "Результат: Стеганография не обнаружена.\n";
     }
-    std::cout << "========================================\n";
+    console() << "========================================\n";
 
     return reportLines;
 }
 
+std::vector<std::string> SteganographyChecker::analyzeMemory(const std::string& name, const uint8_t* data, size_t size) {
+    std::vector<std::string> reportLines;
+    ByteView view(data, size);
+    const size_t signatureBytes = 64;
+    std::vector<uint8_t> signature(view.begin(), view.begin() + std::min(view.size(), signatureBytes));
+    std::string format = FileReader(name).detectFileType(signature);
+
+    reportLines.push_back("Формат: " + format);
+    reportLines.push_back("Размер: " + std::to_string(size) + " байт");
+
+    console() << "========================================\n";
+    console() << "Анализ элемента: " << name << "\n";
+    console() << "Формат: " << format << "\n";
+    console() << "Размер: " << size << " байт\n";
+
+    bool threatDetected = false;
+    if (!isSupportedFormat(format)) {
+        reportLines.push_back("Формат не поддерживается для стеганографического анализа.");
+        console() << "Формат не поддерживается для стеганографического анализа.\n";
+    }
+    else {
+        threatDetected = analyzeData(format, view, reportLines, 0);
+    }
+
+    console() << (threatDetected ? "Результат: Возможна стеганография!\n" : "Результат: Стеганография не обнаружена.\n");
+    console() << "========================================\n";
+    return reportLines;
+}
 
 std::vector<std::pair<std::string, std::vector<std::string>>> SteganographyChecker::analyzeDirectory(const std::string& dirPath) {
     std::vector<std::pair<std::string, std::vector<std::string>>> allReports;
 
+    std::vector<std::string> paths;
     for (const auto& entry : fs::directory_iterator(dirPath)) {
-        if (!entry.is_regular_file()) continue;
-        std::string filePath = entry.path().string();
-        auto reportLines = analyzeFile(filePath);  // 🔁 используем переопределённую analyzeFile
-        allReports.emplace_back(filePath, reportLines);  // ✅ собираем вектор
+        if (entry.is_regular_file()) paths.push_back(entry.path().string());
+    }
+
+    // Следующие файлы читаются в кэш страниц, пока анализируется текущий
+    FilePrefetcher prefetcher(paths);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        prefetcher.advance(i);
+        auto reportLines = analyzeFile(paths[i]);  // 🔁 используем переопределённую analyzeFile
+        allReports.emplace_back(paths[i], reportLines);  // ✅ собираем вектор
     }
 
     return allReports;  // ✅ возвращаем в main.cpp для ReportGenerator
@@ -102,6 +371,14 @@ std::vector<std::pair<std::string, std::vector<std::string>>> SteganographyCheck
 
 
 
+ChunkSource SteganographyChecker::chunkSource(ByteView data) const {
+    if (file_ && !data.empty() && data.data() >= fileView_.data() &&
+        data.data() + data.size() <= fileView_.data() + fileView_.size()) {
+        return ChunkSource(*file_, static_cast<uint64_t>(data.data() - fileView_.data()), data.size());
+    }
+    return ChunkSource(data);
+}
+
 bool SteganographyChecker::isLSBRelevantFormat(const std::string& format) const {
     static const std::vector<std::string> lsbFormats = {
         "JPEG", "PNG", "BMP", "GIF", "TIFF", "WEBP", "PSD"
@@ -112,18 +389,24 @@ bool SteganographyChecker::isLSBRelevantFormat(const std::string& format) const
     return false;
 }
 
-bool SteganographyChecker::performLSBAnalysis(const std::vector<uint8_t>& buffer,
+bool SteganographyChecker::performLSBAnalysis(ByteView buffer,
     std::vector<std::string>& reportLines) {
     size_t total = buffer.size();
     if (total == 0) return false;
 
-    long long ones = 0;
-    for (uint8_t byte : buffer) {
-        if (byte & 1) ones++;
-    }
+    BitPlaneCounts planes;
+    ChunkSource source = chunkSource(buffer);
+    source.forEachChunk([&](uint64_t, ByteView chunk) {
+        countBitPlanes(chunk.data(), chunk.size(), planes);
+        return true;
+    });
+    total = static_cast<size_t>(planes.total);
+    if (total == 0) return false;
+
+    long long ones = static_cast<long long>(planes.ones[0]);
     long long zeros = total - ones;
 
-    double percentOnes = (static_cast<double>(ones) / total) * 100.0;
+    double percentOnes = planes.percent(0);
     double p0 = static_cast<double>(zeros) / total;
     double p1 = static_cast<double>(ones) / total;
 
@@ -131,14 +414,24 @@ bool SteganographyChecker::performLSBAnalysis(const std::vector<uint8_t>& buffer
     if (p0 > 0.0) entropy -= p0 * std::log2(p0);
     if (p1 > 0.0) entropy -= p1 * std::log2(p1);
 
+    // Доли единиц во всех битовых плоскостях: в естественных данных старшие
+    // плоскости заметно отклоняются от 50%, а младшие приближаются к нему
+    std::ostringstream planeStream;
+    planeStream << std::fixed << std::setprecision(2);
+    for (int b = 0; b < 8; ++b) {
+        planeStream << (b ? " " : "") << b << ":" << planes.percent(b) << "%";
+    }
+
     // Запись результатов в отчёт
     reportLines.push_back("- LSB-анализ: 1-битов: " + std::to_string(ones) +
         " из " + std::to_string(total) + " (" +
         std::to_string(percentOnes) + "%)");
     reportLines.push_back("- Энтропия LSB: " + std::to_string(entropy) + " бит");
+    reportLines.push_back("- Битовые плоскости (доля единиц): " + planeStream.str());
 
-    std::cout << "- LSB-анализ: 1-битов: " << ones << " из " << total << " (" << percentOnes << "%)\n";
-    std::cout << "- Энтропия LSB: " << entropy << " бит\n";
+    console() << "- LSB-анализ: 1-битов: " << ones << " из " << total << " (" << percentOnes << "%)\n";
+    console() << "- Энтропия LSB: " << entropy << " бит\n";
+    console() << "- Битовые плоскости (доля единиц): " << planeStream.str() << " [" << bitPlaneKernelName() << "]\n";
 
     // Пороговые значения для аномалий
     bool percentAnomaly = (percentOnes < 48.0) || (percentOnes > 49.5);
@@ -146,86 +439,1384 @@ bool SteganographyChecker::performLSBAnalysis(const std::vector<uint8_t>& buffer
 
     if (percentAnomaly || entropyAnomaly) {
         reportLines.push_back("- [!] Обнаружены аномальные значения LSB: возможная стеганография");
-        std::cout << "- [!] Обнаружены аномальные значения LSB: возможная стеганография\n";
+        console() << "- [!] Обнаружены аномальные значения LSB: возможная стеганография\n";
         return true; // Аномалия найдена
     }
     return false; // Всё нормально
 }
 
-bool SteganographyChecker::analyzeBuffer(const std::string& filePath,
-    const std::string& format,
-    const std::vector<uint8_t>& buffer,
+bool SteganographyChecker::performEntropyMapAnalysis(const std::string& format,
+    ByteView buffer, std::vector<std::string>& reportLines) {
+    EntropyProfiler profiler(4096);
+    ChunkSource source = chunkSource(buffer);
+    source.forEachChunk([&](uint64_t, ByteView chunk) {
+        profiler.update(chunk.data(), chunk.size());
+        return true;
+    });
+    profiler.finish();
+    if (profiler.blocks().empty()) return false;
+
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(3)
+        << "- Энтропийная карта (блоки по 4 КБ): блоков " << profiler.blocks().size()
+        << ", средняя " << profiler.meanEntropy() << ", максимум " << profiler.maxEntropy() << " бит/байт";
+    reportLines.push_back(summary.str());
+    console() << summary.str() << "\n";
+
+    // В несжатых форматах длинные участки с энтропией, близкой к 8 бит/байт,
+    // характерны для зашифрованных или сжатых вложений; в сжатых форматах
+    // области выводятся для локализации, но аномалией не считаются
+    bool uncompressedFormat = format == "BMP" || format == "PSD" || format == "EMF" || format == "WMF";
+    auto regions = profiler.highEntropyRegions(7.9, 2);
+    bool anomaly = false;
+    size_t shown = 0;
+    for (const auto& region : regions) {
+        if (shown++ == 5) {
+            std::string more = "- ... ещё высокоэнтропийных областей: " + std::to_string(regions.size() - 5);
+            reportLines.push_back(more);
+            console() << more << "\n";
+            break;
+        }
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(3)
+            << (uncompressedFormat ? "- [!] " : "- ") << "Высокоэнтропийная область " << formatByteRange(region.range)
+            << ", " << region.meanEntropy << " бит/байт"
+            << (uncompressedFormat ? ": возможны зашифрованные или сжатые встроенные данные" : "");
+        reportLines.push_back(line.str());
+        console() << line.str() << "\n";
+        if (uncompressedFormat) anomaly = true;
+    }
+    return anomaly;
+}
+
+bool SteganographyChecker::performPixelAnalysis(ByteView buffer,
+    std::vector<std::string>& reportLines, bool& anomalyDetected) {
+    DecodedImage image;
+    std::string error;
+    if (!image.decode(buffer.data(), buffer.size(), error)) {
+        std::string line = "- Пиксельный анализ недоступен (" + error + "), LSB-анализ выполняется по байтам файла.";
+        reportLines.push_back(line);
+        console() << line << "\n";
+        return false;
+    }
+
+    std::string header = "- Пиксельный анализ: " + std::to_string(image.width()) + "x" +
+        std::to_string(image.height()) + ", каналов: " + std::to_string(image.channels());
+    reportLines.push_back(header);
+    console() << header << "\n";
+
+    // Альфа-канал обычно постоянен и не используется для статистики
+    std::vector<SampleView> colorViews;
+    std::vector<const char*> names;
+    for (int c = 0; c < image.colorChannels(); ++c) {
+        colorViews.push_back(image.channel(c));
+        names.push_back(image.channelName(c));
+    }
+    if (reportChannelStatistics(colorViews, names, reportLines, nullptr)) {
+        anomalyDetected = true;
+    }
+    return true;
+}
+
+bool SteganographyChecker::reportChannelStatistics(const std::vector<SampleView>& channels,
+    const std::vector<const char*>& names, std::vector<std::string>& reportLines, BitPlaneCounts* planes) {
+    bool anomaly = false;
+    for (size_t c = 0; c < channels.size(); ++c) {
+        ChannelStatistics stats = computeChannelStatistics(channels[c]);
+        if (planes) {
+            for (int v = 0; v < 256; ++v) {
+                for (int b = 0; b < 8; ++b) {
+                    if (v & (1 << b)) planes->ones[b] += stats.histogram[v];
+                }
+                planes->total += stats.histogram[v];
+            }
+        }
+        double chiProbability = channels[c].bytesPerSample > 1 ?
+            chiSquareAlignedPairsProbability(stats.histogram) : chiSquareEmbeddingProbability(stats.histogram);
+        double rs = rsEmbeddingEstimate(stats);
+        double spa = spaEmbeddingEstimate(stats);
+
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(3)
+            << "- Канал " << names[c] << ": χ² p=" << chiProbability << ", RS=";
+        if (rs < 0) line << "н/д"; else line << rs;
+        line << ", SPA=";
+        if (spa < 0) line << "н/д"; else line << spa;
+        // У широких отсчётов гистограмма покрывает только окно около нуля,
+        // поэтому доля единичных LSB выводится отдельно по всем отсчётам
+        if (channels[c].bytesPerSample > 1 && stats.samples > 0) {
+            line << std::setprecision(2) << ", 1 в LSB: " << 100.0 * stats.lsbOnes / stats.samples << "%";
+        }
+        reportLines.push_back(line.str());
+        console() << line.str() << "\n";
+
+        // χ² реагирует на выравнивание пар значений при последовательном
+        // встраивании, RS и SPA — на случайно распределённое встраивание
+        bool chiAnomaly = chiProbability > 0.95;
+        bool rateAnomaly = rs > 0.10 && spa > 0.10;
+        if (chiAnomaly || rateAnomaly) {
+            std::string warn = std::string("- [!] Канал ") + names[c] +
+                ": статистика отсчётов указывает на LSB-встраивание" +
+                (chiAnomaly ? " (χ²)" : "") + (rateAnomaly ? " (RS/SPA)" : "");
+            reportLines.push_back(warn);
+            console() << warn << "\n";
+            anomaly = true;
+        }
+    }
+
+    ChiSquareWindowCurve curve = chiSquareWindowAttack(channels.data(), channels.size());
+    if (reportChiSquareCurve(curve, reportLines)) {
+        anomaly = true;
+    }
+    return anomaly;
+}
+
+bool SteganographyChecker::performBmpPixelAnalysis(ByteView buffer,
+    std::vector<std::string>& reportLines, bool& anomalyDetected) {
+    BmpHeader bmp;
+    std::string error;
+    if (!parseBmpHeader(buffer.data(), buffer.size(), bmp, error) || bmpSampleChannels(bmp) == 0 ||
+        bmp.pixelOffset > buffer.size() || bmp.pixelBytes > buffer.size() - bmp.pixelOffset) {
+        return false;
+    }
+
+    std::string header = "- Пиксельный анализ BMP (массив пикселей без копирования): " +
+        std::to_string(bmp.width) + "x" + std::to_string(bmp.height) + ", " + std::to_string(bmp.bitCount) + " бит";
+    reportLines.push_back(header);
+    console() << header << "\n";
+
+    std::vector<SampleView> views;
+    std::vector<const char*> names;
+    for (int c = 0; c < bmpSampleChannels(bmp); ++c) {
+        views.push_back(bmpChannel(bmp, buffer.data(), c));
+        names.push_back(bmpChannelName(bmp, c));
+    }
+
+    // Битовые плоскости: у 8 и 24 бит значащие байты строки идут подряд и
+    // считаются векторным ядром, у 32 бит байт X/альфа исключается, и
+    // плоскости берутся из гистограмм каналов
+    BitPlaneCounts planes;
+    bool fromHistograms = bmp.bitCount == 32;
+    if (!fromHistograms) {
+        for (size_t r = 0; r < views[0].height; ++r) {
+            countBitPlanes(views[0].row(r), static_cast<size_t>(bmp.rowBytes), planes);
+        }
+    }
+    if (reportChannelStatistics(views, names, reportLines, fromHistograms ? &planes : nullptr)) {
+        anomalyDetected = true;
+    }
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2) << "- LSB-анализ пикселей: 1-битов " << planes.percent(0)
+        << "%, битовые плоскости:";
+    for (int b = 0; b < 8; ++b) line << " " << b << ":" << planes.percent(b) << "%";
+    if (!fromHistograms) line << " [" << bitPlaneKernelName() << "]";
+    reportLines.push_back(line.str());
+    console() << line.str() << "\n";
+    return true;
+}
+
+bool SteganographyChecker::performBmpStructureAnalysis(ByteView buffer,
+    std::vector<std::string>& reportLines) {
+    BmpHeader bmp;
+    std::string error;
+    StructureReporter out{ reportLines, buffer };
+    if (!parseBmpHeader(buffer.data(), buffer.size(), bmp, error)) {
+        out.report("- BMP: неверный или повреждённый заголовок (" + error + ").");
+        return out.anomaly;
+    }
+
+    static const char* const compressionNames[] = { "BI_RGB", "BI_RLE8", "BI_RLE4", "BI_BITFIELDS",
+        "BI_JPEG", "BI_PNG", "BI_ALPHABITFIELDS" };
+    std::ostringstream info;
+    info << "- BMP: " << bmp.width << "x" << bmp.height << (bmp.topDown ? " (сверху вниз)" : "")
+        << ", " << bmp.bitCount << " бит, " << bmp.headerName() << " (" << bmp.dibSize << " байт), "
+        << (bmp.compression < 7 ? compressionNames[bmp.compression] : "сжатие " + std::to_string(bmp.compression))
+        << ", строка " << bmp.rowStride << " байт, массив пикселей " << bmp.pixelBytes << " байт";
+    out.inform(info.str());
+
+    if (bmp.declaredFileSize != buffer.size()) {
+        out.inform("- BMP: размер в заголовке (" + std::to_string(bmp.declaredFileSize) +
+            " байт) не совпадает с фактическим (" + std::to_string(buffer.size()) + " байт)");
+    }
+    if (bmp.pixelOffset < bmp.headerEnd) {
+        out.report("- BMP: массив пикселей (" + formatHexOffset(bmp.pixelOffset) +
+            ") перекрывает заголовок или палитру (до " + formatHexOffset(bmp.headerEnd) + ")");
+    }
+    uint64_t pixelEnd = uint64_t(bmp.pixelOffset) + bmp.pixelBytes;
+    if (pixelEnd > buffer.size()) {
+        out.report("- BMP: массив пикселей обрезан: нужно " + std::to_string(bmp.pixelBytes) + " байт, доступно " +
+            std::to_string(buffer.size() > bmp.pixelOffset ? buffer.size() - bmp.pixelOffset : 0));
+        return out.anomaly;
+    }
+
+    // Байты вне заголовков, массива пикселей и профиля: зазор перед
+    // пикселями и хвост после них. Нулевое выравнивание только подсчитывается
+    std::vector<ByteRange> covered = { { 0, bmp.headerEnd }, { bmp.pixelOffset, bmp.pixelBytes } };
+    if (bmp.profile.length > 0) covered.push_back(bmp.profile);
+    uint64_t zeroBytes = 0;
+    for (const ByteRange& gap : uncoveredRanges(std::move(covered), buffer.size())) {
+        if (out.zeroFilled(gap)) {
+            zeroBytes += gap.length;
+            continue;
+        }
+        out.report(std::string("- BMP: ") + (gap.offset < bmp.pixelOffset ? "данные между заголовком и пикселями: " :
+            "данные после массива пикселей: ") + out.describe(gap));
+    }
+    if (zeroBytes > 0) {
+        out.inform("- BMP: нулевых байтов вне массива пикселей: " + std::to_string(zeroBytes));
+    }
+
+    // Байты выравнивания строк должны быть нулевыми
+    if (bmp.uncompressed() && bmp.rowStride > bmp.rowBytes) {
+        uint64_t nonZero = 0;
+        for (int64_t r = 0; r < bmp.height; ++r) {
+            const uint8_t* pad = buffer.data() + bmp.pixelOffset + r * bmp.rowStride + bmp.rowBytes;
+            for (uint64_t i = 0; i < bmp.rowStride - bmp.rowBytes; ++i) nonZero += pad[i] != 0;
+        }
+        if (nonZero > 0) {
+            out.report("- BMP: ненулевые байты выравнивания строк: " + std::to_string(nonZero) + " из " +
+                std::to_string((bmp.rowStride - bmp.rowBytes) * bmp.height));
+        }
+    }
+    return out.anomaly;
+}
+
+bool SteganographyChecker::performJpegCoefficientAnalysis(ByteView buffer,
+    std::vector<std::string>& reportLines, bool& anomalyDetected) {
+    JpegCoefficientStats stats;
+    std::string error;
+    if (!decodeJpegCoefficients(buffer.data(), buffer.size(), stats, error)) {
+        std::string line = "- DCT-анализ JPEG недоступен (" + error + ").";
+        reportLines.push_back(line);
+        console() << line << "\n";
+        return false;
+    }
+
+    uint64_t total = stats.acTotal();
+    uint64_t nonZero = total - stats.ac(0);
+    std::ostringstream header;
+    header << std::fixed << std::setprecision(1)
+        << "- DCT-анализ JPEG: " << stats.width << "x" << stats.height
+        << ", компонентов: " << stats.components << ", блоков: " << stats.blocks
+        << ", ненулевых AC: " << (total ? 100.0 * nonZero / total : 0.0) << "%";
+    reportLines.push_back(header.str());
+    console() << header.str() << "\n";
+
+    std::ostringstream histogram;
+    histogram << "- Гистограмма AC: h(0)=" << stats.ac(0);
+    for (int v = 1; v <= 3; ++v) {
+        histogram << ", h(" << v << ")=" << stats.ac(v) << ", h(-" << v << ")=" << stats.ac(-v);
+    }
+    reportLines.push_back(histogram.str());
+    console() << histogram.str() << "\n";
+
+    if (stats.truncated) {
+        std::string line = "- JPEG: энтропийные данные обрываются раньше последнего блока.";
+        reportLines.push_back(line);
+        console() << line << "\n";
+    }
+
+    double chiProbability = jstegEmbeddingProbability(stats.acHistogram);
+    double rate = jstegEmbeddingEstimate(stats);
+    std::ostringstream jsteg;
+    jsteg << std::fixed << std::setprecision(3) << "- JSteg: χ² p=" << chiProbability << ", доля встраивания=";
+    if (rate < 0) jsteg << "н/д"; else jsteg << rate;
+    jsteg << ", растущее окно:";
+    for (size_t k = 4; k < stats.jstegCurve.size(); k += 5) {
+        jsteg << " " << (k + 1) * 100 / stats.jstegCurve.size() << "%=" << stats.jstegCurve[k];
+    }
+    reportLines.push_back(jsteg.str());
+    console() << jsteg.str() << "\n";
+
+    if (chiProbability > 0.95 || rate > 0.10) {
+        // Каждый используемый коэффициент (кроме 0 и 1) несёт один бит
+        uint64_t usable = nonZero - stats.ac(1);
+        uint64_t payload = rate > 0 ? static_cast<uint64_t>(rate * usable) / 8 : 0;
+        std::string warn = "- [!] JSteg: пары значений DCT-коэффициентов выровнены, оценка длины сообщения ~" +
+            std::to_string(payload) + " байт";
+        reportLines.push_back(warn);
+        console() << warn << "\n";
+        anomalyDetected = true;
+    }
+
+    if (hasF5EncoderSignature(stats)) {
+        std::string warn = "- [!] F5: комментарий JPEG совпадает с комментарием кодировщика F5 (\"" +
+            stats.comment.substr(0, 64) + "\")";
+        reportLines.push_back(warn);
+        console() << warn << "\n";
+        anomalyDetected = true;
+    }
+    return true;
+}
+
+bool SteganographyChecker::performPngStreamAnalysis(ByteView buffer,
+    std::vector<std::string>& reportLines) {
+    // Ограничения на файл: IDAT только подсчитывается, текст и профили
+    // сохраняются для проверки содержимого
+    const uint64_t maxIdatOutput = 512ULL * 1024 * 1024;
+    const uint64_t idatSlack = 1024 * 1024;
+    const uint64_t maxTextOutput = 8ULL * 1024 * 1024;
+
+    StructureReporter out{ reportLines, buffer };
+
+    uint64_t expectedRaw = 0;
+    std::vector<std::pair<size_t, size_t>> idat;   // смещение и длина данных
+    uint64_t textBudget = maxTextOutput;
+
+    size_t index = 8;
+    while (index + 12 <= buffer.size()) {
+        uint32_t length = readBE32(&buffer[index]);
+        uint32_t chunkType = readFourCC(&buffer[index + 4]);
+        size_t dataOffset = index + 8;
+        if (length > buffer.size() - dataOffset) break;
+        const uint8_t* data = &buffer[dataOffset];
+
+        if (chunkType == fourCC("IHDR") && length >= 13) {
+            expectedRaw = expectedPngRawSize(readBE32(data), readBE32(data + 4), data[8], data[9], data[12] != 0);
+        }
+        else if (chunkType == fourCC("IDAT")) {
+            idat.emplace_back(dataOffset, length);
+        }
+        else if (chunkType == fourCC("zTXt") || chunkType == fourCC("iTXt") || chunkType == fourCC("iCCP")) {
+            // Ключевое слово и метод сжатия; у iTXt между ними флаг сжатия,
+            // а перед текстом — язык и переведённое ключевое слово
+            const void* keywordEnd = std::memchr(data, 0, std::min<size_t>(length, 80));
+            size_t streamOffset = keywordEnd ? static_cast<const uint8_t*>(keywordEnd) - data + 1 : length;
+            bool compressed = true;
+            if (chunkType == fourCC("iTXt")) {
+                compressed = streamOffset + 2 <= length && data[streamOffset] == 1;
+                streamOffset += 2;
+                for (int field = 0; field < 2 && streamOffset < length; ++field) {
+                    const void* end = std::memchr(data + streamOffset, 0, length - streamOffset);
+                    streamOffset = end ? static_cast<const uint8_t*>(end) - data + 1 : length;
+                }
+            }
+            else {
+                streamOffset += 1;
+            }
+
+            if (compressed && streamOffset < length && textBudget > 0) {
+                std::vector<uint8_t> text;
+                Inflater inflater(Inflater::Format::Zlib, textBudget);
+                Inflater::Result result = inflater.run(data + streamOffset, length - streamOffset, text);
+                textBudget -= inflater.outputProduced();
+                std::string where = fourCCName(chunkType) + " по смещению " + formatHexOffset(index);
+
+                if (result == Inflater::Result::OutputLimit) {
+                    out.report("- PNG: чанк " + where + " распаковывается более чем в " +
+                        std::to_string(inflater.outputProduced()) + " байт (возможная zip-бомба)");
+                }
+                else if (result != Inflater::Result::Done) {
+                    out.report("- PNG: сжатые данные чанка " + where + " повреждены (" + inflater.error() + ")");
+                }
+                else if (inflater.trailingInput() > 0) {
+                    out.report("- PNG: в чанке " + where + " после конца zlib-потока " +
+                        std::to_string(inflater.trailingInput()) + " байт");
+                }
+
+                if (chunkType == fourCC("iCCP")) {
+                    // Заголовок ICC: размер профиля и сигнатура 'acsp'
+                    if (text.size() < 128 || std::memcmp(text.data() + 36, "acsp", 4) != 0) {
+                        if (result == Inflater::Result::Done) {
+                            out.report("- PNG: чанк " + where + " не содержит корректного ICC-профиля");
+                        }
+                    }
+                    else if (readBE32(text.data()) < text.size()) {
+                        out.report("- PNG: после ICC-профиля в " + where + " " +
+                            std::to_string(text.size() - readBE32(text.data())) + " лишних байт");
+                    }
+                }
+                else if (looksBinary(text)) {
+                    out.report("- PNG: распакованный текст чанка " + where + " содержит двоичные данные (" +
+                        std::to_string(text.size()) + " байт)");
+                }
+            }
+        }
+        else if (chunkType == fourCC("IEND")) {
+            break;
+        }
+        index = dataOffset + length + 4;
+    }
+
+    if (idat.empty() || expectedRaw == 0) return out.anomaly;
+
+    // IDAT — единый zlib-поток, разрезанный на чанки: фрагменты подаются без склейки
+    size_t next = 0;
+    Inflater::Source source = [&](const uint8_t*& chunk, size_t& size) {
+        if (next >= idat.size()) return false;
+        chunk = buffer.data() + idat[next].first;
+        size = idat[next].second;
+        next++;
+        return true;
+    };
+    uint64_t limit = std::min(expectedRaw + idatSlack, maxIdatOutput);
+    Inflater inflater(Inflater::Format::Zlib, limit);
+    Inflater::Result result = inflater.run(source, Inflater::Sink());
+    uint64_t produced = inflater.outputProduced();
+
+    if (result == Inflater::Result::OutputLimit) {
+        if (limit < expectedRaw + idatSlack) {
+            std::string line = "- PNG: проверка IDAT ограничена первыми " + std::to_string(limit) + " байт";
+            reportLines.push_back(line);
+            console() << line << "\n";
+        }
+        else {
+            out.report("- PNG: распакованный IDAT превышает размер изображения более чем на " +
+                std::to_string(idatSlack) + " байт (возможная zip-бомба или скрытые данные)");
+        }
+    }
+    else if (result != Inflater::Result::Done) {
+        out.report("- PNG: поток IDAT повреждён (" + inflater.error() + ")");
+    }
+    else {
+        if (produced > expectedRaw) {
+            out.report("- PNG: распакованный IDAT больше размера изображения на " +
+                std::to_string(produced - expectedRaw) + " байт");
+        }
+        else if (produced < expectedRaw) {
+            out.report("- PNG: распакованных данных IDAT меньше, чем требует IHDR (" +
+                std::to_string(produced) + " из " + std::to_string(expectedRaw) + " байт)");
+        }
+        if (inflater.trailingInput() > 0) {
+            out.report("- PNG: после конца zlib-потока в IDAT " + std::to_string(inflater.trailingInput()) + " байт");
+        }
+    }
+    return out.anomaly;
+}
+
+bool SteganographyChecker::performGifStructureAnalysis(ByteView buffer,
+    std::vector<std::string>& reportLines) {
+    const uint64_t maxCommentBytes = 2048;
+    const uint64_t maxLoopExtensionBytes = 16;    // NETSCAPE2.0: 3 байта счётчика повторов
+    const size_t maxReportedRanges = 10;
+
+    GifStructure gif;
+    if (!parseGifStructure(buffer.data(), buffer.size(), gif)) return false;
+
+    StructureReporter out{ reportLines, buffer };
+
+    {
+        std::ostringstream line;
+        line << "- GIF: " << gif.width << "x" << gif.height << ", глобальная палитра: " << gif.globalColors
+            << " цветов, кадров: " << gif.frames << ", расширений: " << gif.extensions.size();
+        reportLines.push_back(line.str());
+        console() << line.str() << "\n";
+    }
+
+    for (const GifExtension& ext : gif.extensions) {
+        std::string where = " по смещению " + formatHexOffset(ext.range.offset);
+        switch (ext.label) {
+        case 0xF9:
+            if (ext.dataBytes > 4) {
+                out.report("- GIF: расширение управления графикой" + where + " содержит " +
+                    std::to_string(ext.dataBytes) + " байт вместо 4");
+            }
+            break;
+        case 0xFE:
+        case 0x01:
+            if (ext.dataBytes > maxCommentBytes) {
+                out.report(std::string("- GIF: слишком большой ") + (ext.label == 0xFE ? "комментарий" : "текстовый блок") +
+                    where + " (" + std::to_string(ext.dataBytes) + " байт)");
+            }
+            break;
+        case 0xFF:
+            if (!isKnownGifApplication(ext.application)) {
+                out.report("- GIF: неизвестное расширение приложения \"" + printableText(ext.application) + "\"" +
+                    where + " (" + std::to_string(ext.dataBytes) + " байт данных)");
+            }
+            else if ((ext.application == "NETSCAPE2.0" || ext.application == "ANIMEXTS1.0") &&
+                ext.dataBytes > maxLoopExtensionBytes) {
+                out.report("- GIF: расширение " + ext.application + where + " содержит " +
+                    std::to_string(ext.dataBytes) + " байт данных");
+            }
+            break;
+        default: {
+            std::ostringstream line;
+            line << "- GIF: неизвестное расширение 0x" << std::hex << std::uppercase << std::setw(2)
+                << std::setfill('0') << int(ext.label) << std::dec << where << " ("
+                << ext.dataBytes << " байт данных)";
+            out.report(line.str());
+            break;
+        }
+        }
+    }
+
+    if (gif.badCodeSizes > 0) {
+        out.report("- GIF: недопустимый начальный размер кода LZW в кадрах: " + std::to_string(gif.badCodeSizes));
+    }
+
+    // Байты вне разобранных блоков: после трейлера или между блоками
+    std::vector<ByteRange> gaps = uncoveredRanges(gif.blocks, buffer.size());
+    uint64_t gapBytes = 0;
+    for (size_t i = 0; i < gaps.size(); ++i) {
+        gapBytes += gaps[i].length;
+        if (i >= maxReportedRanges) continue;
+        bool afterTrailer = gif.trailerFound && gaps[i].offset >= gif.trailerEnd;
+        out.report(std::string("- GIF: ") + (afterTrailer ? "данные после трейлера: " : "данные вне структуры блоков: ") +
+            formatByteRange(gaps[i]));
+    }
+    if (gaps.size() > maxReportedRanges) {
+        out.report("- GIF: всего областей вне структуры: " + std::to_string(gaps.size()) +
+            " (" + std::to_string(gapBytes) + " байт)");
+    }
+
+    if (gif.truncated) {
+        out.report("- GIF: блок обрывается концом файла — файл обрезан.");
+    }
+    else if (!gif.trailerFound) {
+        out.report("- GIF: отсутствует трейлер (0x3B) — возможно, файл обрезан.");
+    }
+    return out.anomaly;
+}
+
+bool SteganographyChecker::performTiffStructureAnalysis(ByteView buffer,
+    std::vector<std::string>& reportLines) {
+    const uint64_t alignmentSlack = 8;    // выравнивание значений по слову
+    const size_t maxReportedRanges = 10;
+
+    TiffStructure tiff;
+    if (!parseTiffStructure(buffer.data(), buffer.size(), tiff)) {
+        std::string line = "- TIFF: неверная сигнатура TIFF.";
+        reportLines.push_back(line);
+        console() << line << "\n";
+        return true;
+    }
+
+    StructureReporter out{ reportLines, buffer };
+
+    {
+        std::ostringstream line;
+        line << "- TIFF: " << (tiff.bigEndian ? "MM" : "II") << (tiff.bigTiff ? ", BigTIFF" : "")
+            << (tiff.dng ? ", DNG" : "") << (tiff.canonRaw ? ", Canon CR2" : "");
+        if (!tiff.make.empty()) line << ", производитель: " << printableText(tiff.make);
+        line << ", каталогов: " << tiff.ifds << ", тегов: " << tiff.entries
+            << ", полос и тайлов: " << tiff.dataBlocks;
+        out.inform(line.str());
+    }
+
+    if (tiff.badReferences > 0) {
+        out.report("- TIFF: ссылок за пределы файла: " + std::to_string(tiff.badReferences) +
+            " (файл обрезан или повреждён)");
+    }
+    if (tiff.repeatedIfds > 0) {
+        out.report("- TIFF: повторные ссылки на каталоги (циклы IFD): " + std::to_string(tiff.repeatedIfds));
+    }
+    if (tiff.ifdLimit) {
+        out.report("- TIFF: ссылок на каталоги больше предела, остальные каталоги не проверяются");
+    }
+
+    // Байты, на которые не ссылается ни один каталог. Заполненные нулями
+    // области оставляют некоторые кодировщики — они только подсчитываются
+    size_t reported = 0, hidden = 0, zeroRanges = 0;
+    uint64_t hiddenBytes = 0, zeroBytes = 0;
+    for (const ByteRange& gap : uncoveredRanges(std::move(tiff.referenced), buffer.size())) {
+        if (gap.length < alignmentSlack) continue;
+        if (out.zeroFilled(gap)) {
+            zeroRanges++;
+            zeroBytes += gap.length;
+            continue;
+        }
+        hidden++;
+        hiddenBytes += gap.length;
+        if (reported < maxReportedRanges) {
+            out.report("- TIFF: область вне структуры каталогов: " + out.describe(gap));
+            reported++;
+        }
+    }
+    if (hidden > reported) {
+        out.report("- TIFF: всего областей вне структуры: " + std::to_string(hidden) +
+            " (" + std::to_string(hiddenBytes) + " байт)");
+    }
+    if (zeroRanges > 0) {
+        out.inform("- TIFF: неиспользуемых областей, заполненных нулями: " + std::to_string(zeroRanges) +
+            " (" + std::to_string(zeroBytes) + " байт)");
+    }
+    return out.anomaly;
+}
+
+bool SteganographyChecker::performWebpStructureAnalysis(ByteView buffer,
+    std::vector<std::string>& reportLines) {
+    WebpStructure webp;
+    if (!parseWebpStructure(buffer.data(), buffer.size(), webp)) return false;
+
+    StructureReporter out{ reportLines, buffer };
+
+    {
+        std::ostringstream line;
+        line << "- WebP: " << (webp.extended ? "расширенный формат (VP8X)" : "простой формат")
+            << ", чанков: " << webp.chunks.size();
+        if (webp.extended) line << ", холст " << webp.canvasWidth << "x" << webp.canvasHeight;
+        if (webp.frames) line << ", кадров: " << webp.frames;
+        for (const WebpImage& image : webp.images) {
+            if (image.inFrame) continue;
+            line << ", " << (image.lossless ? "VP8L " : "VP8 ") << image.width << "x" << image.height;
+        }
+        reportLines.push_back(line.str());
+        console() << line.str() << "\n";
+    }
+
+    // Границы RIFF
+    if (webp.riffSize & 1) {
+        out.report("- WebP: нечётный размер RIFF (" + std::to_string(webp.riffSize) + ")");
+    }
+    if (webp.riffEnd > buffer.size()) {
+        out.report("- WebP: размер RIFF (" + std::to_string(webp.riffEnd) + " байт) больше файла (" +
+            std::to_string(buffer.size()) + " байт) — файл обрезан");
+    }
+    else if (webp.riffEnd < buffer.size()) {
+        out.report("- WebP: данные после конца RIFF: " +
+            formatByteRange({ webp.riffEnd, buffer.size() - webp.riffEnd }));
+    }
+    if (webp.overflow) {
+        out.report("- WebP: чанк " + fourCCName(webp.overflowChunk.fourcc) + " по смещению " +
+            formatHexOffset(webp.overflowChunk.offset) + " (" + std::to_string(webp.overflowChunk.size) +
+            " байт) выходит за пределы RIFF");
+    }
+
+    bool hasChunk[5] = {};   // ICCP, EXIF, XMP, ANIM, ALPH
+    size_t imageChunks = 0;
+    for (size_t i = 0; i < webp.chunks.size(); ++i) {
+        uint32_t id = webp.chunks[i].fourcc;
+        if (!kWebpChunks.contains(id)) {
+            out.report("- WebP: обнаружен нестандартный chunk: " + fourCCName(id) + " по смещению " +
+                formatHexOffset(webp.chunks[i].offset) + " (" + std::to_string(webp.chunks[i].size) + " байт)");
+        }
+        if (id == fourCC("VP8X") && i != 0) out.report("- WebP: чанк VP8X не первый в файле");
+        if (id == fourCC("ICCP")) hasChunk[0] = true;
+        if (id == fourCC("EXIF")) hasChunk[1] = true;
+        if (id == fourCC("XMP ")) hasChunk[2] = true;
+        if (id == fourCC("ANIM")) hasChunk[3] = true;
+        if (id == fourCC("ALPH")) hasChunk[4] = true;
+        if (id == fourCC("VP8 ") || id == fourCC("VP8L")) imageChunks++;
+    }
+
+    // Флаги VP8X должны соответствовать набору чанков
+    if (webp.extended) {
+        static const struct { uint8_t flag; int chunk; const char* name; } flagChecks[] = {
+            { kWebpFlagIcc, 0, "ICC (чанк ICCP)" }, { kWebpFlagExif, 1, "EXIF" },
+            { kWebpFlagXmp, 2, "XMP" }, { kWebpFlagAnimation, 3, "анимации (чанк ANIM)" } };
+        for (const auto& check : flagChecks) {
+            if (((webp.flags & check.flag) != 0) != hasChunk[check.chunk]) {
+                out.report(std::string("- WebP: флаг ") + check.name + " в VP8X не соответствует наличию чанка");
+            }
+        }
+        if (webp.flags & kWebpFlagsReserved) out.report("- WebP: в VP8X установлены зарезервированные биты флагов");
+        if (!(webp.flags & kWebpFlagAlpha) && hasChunk[4]) out.report("- WebP: чанк ALPH без флага альфа-канала в VP8X");
+        if ((webp.flags & kWebpFlagAnimation) == 0 && webp.frames > 0) {
+            out.report("- WebP: кадры ANMF в неанимированном файле");
+        }
+    }
+    else if (webp.chunks.size() > 1) {
+        out.report("- WebP: простой формат (без VP8X) содержит дополнительные чанки: " +
+            std::to_string(webp.chunks.size() - 1));
+    }
+    if (!(webp.extended && (webp.flags & kWebpFlagAnimation)) && imageChunks > 1) {
+        out.report("- WebP: несколько потоков изображения в неанимированном файле: " + std::to_string(imageChunks));
+    }
+    if (webp.framesOutsideCanvas > 0) {
+        out.report("- WebP: кадры за пределами холста: " + std::to_string(webp.framesOutsideCanvas));
+    }
+    if (webp.alphaWithLossless > 0) {
+        out.report("- WebP: чанк ALPH рядом с VP8L (альфа-канал VP8L хранится в самом потоке)");
+    }
+
+    // Заголовки потоков; неполные коды Хаффмана VP8L — структурный признак CVE-2023-4863
+    for (const WebpImage& image : webp.images) {
+        std::string where = std::string(image.lossless ? "VP8L" : "VP8") + " по смещению " + formatHexOffset(image.offset);
+        if (!image.error.empty()) {
+            out.report("- WebP: повреждён заголовок " + where + " (" + image.error + ")");
+            continue;
+        }
+        uint32_t expectedWidth = image.inFrame ? image.frameWidth : webp.canvasWidth;
+        uint32_t expectedHeight = image.inFrame ? image.frameHeight : webp.canvasHeight;
+        if ((image.inFrame || webp.extended) && (image.width != expectedWidth || image.height != expectedHeight)) {
+            out.report("- WebP: размеры " + where + " (" + std::to_string(image.width) + "x" + std::to_string(image.height) +
+                ") не совпадают с " + (image.inFrame ? "кадром" : "холстом") + " (" +
+                std::to_string(expectedWidth) + "x" + std::to_string(expectedHeight) + ")");
+        }
+        if (!image.lossless) continue;
+        if (image.vp8l.invalidCodes > 0) {
+            out.report("- [!] WebP: " + where + " содержит неполный или переполненный код Хаффмана — "
+                "признак эксплуатации CVE-2023-4863 (переполнение таблиц libwebp)");
+        }
+        else if (image.vp8l.truncated) {
+            out.report("- WebP: поток " + where + " обрывается до конца кодов Хаффмана");
+        }
+        else if (!image.vp8l.complete) {
+            out.report("- WebP: коды Хаффмана " + where + " не разобраны (" + image.vp8l.error + ")");
+        }
+    }
+    return out.anomaly;
+}
+
+bool SteganographyChecker::performIsoBmffAnalysis(const uint8_t* data, size_t size,
+    std::vector<std::string>& reportLines, std::vector<ByteRange>& payload) {
+    const uint64_t alignmentSlack = 8;
+    const size_t maxReportedRanges = 10;
+
+    IsoBmffStructure iso;
+    if (!parseIsoBmffStructure(data, size, iso)) {
+        std::string line = "- ISO-BMFF: файл не начинается с корректного бокса.";
+        reportLines.push_back(line);
+        console() << line << "\n";
+        return true;
+    }
+
+    StructureReporter out{ reportLines, ByteView(data, size) };
+
+    {
+        std::ostringstream line;
+        line << "- ISO-BMFF: бренд " << (iso.majorBrand ? fourCCName(iso.majorBrand) : "не указан");
+        if (!iso.compatibleBrands.empty()) {
+            line << " (совместимые:";
+            for (uint32_t brand : iso.compatibleBrands) line << " " << fourCCName(brand);
+            line << ")";
+        }
+        line << ", боксов: " << iso.boxes << ", дорожек: " << iso.tracks << ", чанков: " << iso.chunks
+            << ", сэмплов: " << iso.samples;
+        if (iso.fragments) line << ", фрагментов: " << iso.fragments;
+        if (iso.items) line << ", элементов: " << iso.items;
+        out.inform(line.str());
+    }
+
+    // Боксы верхнего уровня и данные после них. Обрезанный «бокс» неизвестного
+    // типа в конце файла — это дописанные данные, случайно похожие на заголовок
+    uint64_t boxesEnd = iso.boxesEnd;
+    if (iso.truncated && !kIsoTopLevelBoxes.contains(iso.topLevel.back().type)) {
+        boxesEnd = iso.topLevel.back().range.offset;
+        iso.topLevel.pop_back();
+        iso.truncated = false;
+    }
+    size_t unknownBoxes = 0;
+    for (const IsoBox& box : iso.topLevel) {
+        if (kIsoTopLevelBoxes.contains(box.type)) continue;
+        if (unknownBoxes++ < maxReportedRanges) {
+            out.report("- ISO-BMFF: нестандартный бокс верхнего уровня " + fourCCName(box.type) + ": " +
+                formatByteRange(box.range));
+        }
+    }
+    if (unknownBoxes > maxReportedRanges) {
+        out.report("- ISO-BMFF: всего нестандартных боксов верхнего уровня: " + std::to_string(unknownBoxes));
+    }
+    if (iso.truncated) {
+        const IsoBox& last = iso.topLevel.back();
+        out.report("- ISO-BMFF: бокс " + fourCCName(last.type) + " по смещению " + formatHexOffset(last.range.offset) +
+            " выходит за пределы файла (файл обрезан или к нему дописаны данные)");
+    }
+    if (boxesEnd < size) {
+        out.report("- ISO-BMFF: данные после последнего бокса: " + out.describe({ boxesEnd, size - boxesEnd }));
+    }
+    if (iso.malformedBoxes > 0) {
+        out.report("- ISO-BMFF: вложенных боксов с неверным размером: " + std::to_string(iso.malformedBoxes));
+    }
+
+    // free и skip обычно заполнены нулями или содержат строку кодировщика
+    for (const IsoBox& box : iso.freeBoxes) {
+        ByteRange content{ box.payload(), box.range.end() - box.payload() };
+        if (content.length == 0 || out.zeroFilled(content)) continue;
+        const uint8_t* begin = data + content.offset;
+        const uint8_t* end = begin + out.inspected(content);
+        bool text = std::all_of(begin, end, [](uint8_t c) {
+            return c == 0 || c == '\t' || c == '\r' || c == '\n' || (c >= 0x20 && c < 0x7F);
+        });
+        if (text && content.length <= kInspectLimit) {
+            std::string value(reinterpret_cast<const char*>(begin), std::min<size_t>(out.inspected(content), 80));
+            value.erase(std::remove(value.begin(), value.end(), '\0'), value.end());
+            out.inform("- ISO-BMFF: бокс " + fourCCName(box.type) + " по смещению " + formatHexOffset(box.range.offset) +
+                " содержит текст: " + printableText(value));
+        }
+        else {
+            out.report("- ISO-BMFF: бокс " + fourCCName(box.type) + " с ненулевыми данными: " + out.describe(content));
+        }
+    }
+
+    if (iso.badReferences > 0) {
+        out.report("- ISO-BMFF: ссылок на сэмплы за пределами файла: " + std::to_string(iso.badReferences));
+    }
+    if (iso.mediaData.empty()) return out.anomaly;
+    if (iso.tracks == 0 && iso.fragments == 0 && iso.items == 0) {
+        out.report("- ISO-BMFF: mdat без описания сэмплов (нет moov, moof и iloc)");
+        return out.anomaly;
+    }
+    if (iso.incompleteTables > 0 || iso.badReferences > 0 || iso.truncated) {
+        out.inform("- ISO-BMFF: таблицы сэмплов неполные или файл обрезан, проверка покрытия mdat пропущена");
+        return out.anomaly;
+    }
+
+    payload.insert(payload.end(), iso.referenced.begin(), iso.referenced.end());
+
+    // Участки mdat, не принадлежащие ни одному сэмплу: всё вне данных mdat
+    // считается покрытым, к нему добавляются диапазоны из таблиц сэмплов
+    std::vector<ByteRange> covered = uncoveredRanges(iso.mediaData, size);
+    covered.insert(covered.end(), iso.referenced.begin(), iso.referenced.end());
+    size_t reported = 0, hidden = 0, zeroRanges = 0;
+    uint64_t hiddenBytes = 0, zeroBytes = 0;
+    for (const ByteRange& gap : uncoveredRanges(std::move(covered), size)) {
+        if (gap.length < alignmentSlack) continue;
+        if (out.zeroFilled(gap)) {
+            zeroRanges++;
+            zeroBytes += gap.length;
+            continue;
+        }
+        hidden++;
+        hiddenBytes += gap.length;
+        if (reported < maxReportedRanges) {
+            out.report("- ISO-BMFF: участок mdat вне таблиц сэмплов: " + out.describe(gap));
+            reported++;
+        }
+    }
+    if (hidden > reported) {
+        out.report("- ISO-BMFF: всего участков mdat вне таблиц сэмплов: " + std::to_string(hidden) +
+            " (" + std::to_string(hiddenBytes) + " байт)");
+    }
+    if (zeroRanges > 0) {
+        out.inform("- ISO-BMFF: неиспользуемых участков mdat, заполненных нулями: " + std::to_string(zeroRanges) +
+            " (" + std::to_string(zeroBytes) + " байт)");
+    }
+    return out.anomaly;
+}
+
+bool SteganographyChecker::performEbmlAnalysis(const std::string& format, const uint8_t* data, size_t size,
+    std::vector<std::string>& reportLines, std::vector<ByteRange>& payload) {
+    const size_t maxReported = 10;
+    const uint64_t maxTagString = 4096;       // длиннее не бывают названия, описания и даты
+
+    EbmlStructure ebml;
+    if (!parseEbmlStructure(data, size, ebml)) {
+        std::string line = "- " + format + ": неверный заголовок EBML.";
+        reportLines.push_back(line);
+        console() << line << "\n";
+        return true;
+    }
+
+    StructureReporter out{ reportLines, ByteView(data, size) };
+    const std::string prefix = "- " + format + ": ";
+    payload.insert(payload.end(), ebml.clusterRanges.begin(), ebml.clusterRanges.end());
+
+    {
+        std::ostringstream line;
+        line << prefix << "DocType " << (ebml.docType.empty() ? "не указан" : printableText(ebml.docType))
+            << " v" << ebml.docTypeVersion << ", сегментов: " << ebml.segments << ", кластеров: " << ebml.clusters
+            << ", вложений: " << ebml.attachments.size() << ", тегов: " << ebml.tags.size();
+        out.inform(line.str());
+    }
+
+    if (ebml.truncated) out.report(prefix + "элемент выходит за пределы файла (файл обрезан)");
+    if (ebml.malformed > 0) {
+        out.report(prefix + "элементов с неверным заголовком или размером: " + std::to_string(ebml.malformed));
+    }
+    if (ebml.streamEnd < size) {
+        out.report(prefix + "данные после конца сегмента: " + out.describe({ ebml.streamEnd, size - ebml.streamEnd }));
+    }
+
+    // Вложения: в WebM они не предусмотрены, в Matroska обычны шрифты и обложки
+    for (const EbmlAttachment& file : ebml.attachments) {
+        std::string line = prefix + "вложение «" + printableText(file.name) + "» (" +
+            (file.mimeType.empty() ? "тип не указан" : printableText(file.mimeType)) + ", " +
+            std::to_string(file.data.length) + " байт)";
+        const uint8_t* content = data + file.data.offset;
+        size_t contentSize = static_cast<size_t>(std::min(file.data.length, kInspectLimit));
+        if (format == "WebM") {
+            out.report(line + ": вложения не допускаются в WebM");
+        }
+        else if (!attachmentMatchesMime(file.mimeType, content, contentSize)) {
+            out.report(line + ": содержимое не соответствует типу MIME");
+        }
+        else if (!isFontMimeType(file.mimeType) && file.mimeType.rfind("image/", 0) != 0) {
+            out.report(line + ": не шрифт и не изображение");
+        }
+        else {
+            out.inform(line);
+        }
+    }
+
+    // Двоичные и слишком длинные теги
+    for (const EbmlTag& tag : ebml.tags) {
+        if (tag.binary) {
+            out.report(prefix + "двоичный тег «" + printableText(tag.name) + "»: " + out.describe(tag.value));
+        }
+        else if (tag.value.length > maxTagString) {
+            out.report(prefix + "длинный тег «" + printableText(tag.name) + "»: " + out.describe(tag.value));
+        }
+    }
+
+    for (size_t i = 0; i < ebml.unknownElements.size() && i < maxReported; ++i) {
+        const EbmlElement& e = ebml.unknownElements[i];
+        out.report(prefix + "неизвестный элемент " + formatHexOffset(e.id) + ": " +
+            formatByteRange({ e.offset, e.end() - e.offset }));
+    }
+    if (ebml.unknownElements.size() > maxReported) {
+        out.report(prefix + "всего неизвестных элементов: " + std::to_string(ebml.unknownElements.size()));
+    }
+
+    // Void резервирует место под последующую запись индексов и обычно заполнен нулями
+    size_t reportedVoids = 0;
+    for (const ByteRange& range : ebml.voids) {
+        if (out.zeroFilled(range)) continue;
+        if (reportedVoids++ < maxReported) out.report(prefix + "элемент Void с ненулевыми данными: " + out.describe(range));
+    }
+    if (reportedVoids > maxReported) {
+        out.report(prefix + "всего элементов Void с ненулевыми данными: " + std::to_string(reportedVoids));
+    }
+    return out.anomaly;
+}
+
+bool SteganographyChecker::performMp3Analysis(const uint8_t* data, size_t size,
+    std::vector<std::string>& reportLines, std::vector<ByteRange>& payload) {
+    const uint64_t maxPictureSize = 2ULL << 20;     // обложки крупнее 2 МБ встречаются редко
+    const uint64_t maxObjectSize = 64ULL << 10;     // GEOB
+    const uint64_t maxPrivateSize = 4096;           // PRIV обычно хранит идентификаторы в десятки байтов
+    const size_t maxReportedGaps = 10;
+
+    Mp3Structure mp3;
+    if (!parseMp3Structure(data, size, mp3)) {
+        std::string line = "- MP3: не найдены ни тег ID3v2, ни кадры MPEG-аудио.";
+        reportLines.push_back(line);
+        console() << line << "\n";
+        return true;
+    }
+
+    StructureReporter out{ reportLines, ByteView(data, size) };
+
+    {
+        std::ostringstream line;
+        line << "- MP3: ";
+        if (mp3.audio.frames > 0) {
+            line << "MPEG-" << (mp3.audio.version == 25 ? "2.5" : std::to_string(mp3.audio.version))
+                << " Layer " << mp3.audio.layer << ", " << mp3.audio.sampleRate << " Гц, кадров: " << mp3.audio.frames;
+        }
+        else {
+            line << "кадры MPEG-аудио не найдены";
+        }
+        for (const Id3Tag& tag : mp3.id3v2) {
+            line << ", ID3v2." << int(tag.version) << " (" << tag.frames.size() << " кадров"
+                << (tag.unsynchronised ? ", несинхронизация" : "") << ")";
+        }
+        if (mp3.id3v1) line << ", ID3v1";
+        if (mp3.apeTag.length) line << ", APEv2";
+        line << " [" << byteSearchKernelName() << "]";
+        out.inform(line.str());
+    }
+
+    // Кадры ID3v2, способные нести произвольные данные
+    for (const Id3Tag& tag : mp3.id3v2) {
+        for (const Id3Frame& frame : tag.frames) {
+            std::string where = "- MP3: кадр " + frame.id + " по смещению " + formatHexOffset(frame.offset) +
+                " (" + std::to_string(frame.size) + " байт)";
+            if (frame.id == "APIC" || frame.id == "PIC") {
+                if (!frame.knownPicture) out.report(where + ": данные не являются изображением (" + printableText(frame.mimeType) + ")");
+                else if (frame.objectSize > maxPictureSize) out.report(where + ": необычно большая обложка");
+            }
+            else if (frame.id == "GEOB" || frame.id == "GEO") {
+                std::string line = where + ": вложенный объект " + printableText(frame.mimeType) +
+                    (frame.description.empty() ? "" : " «" + printableText(frame.description) + "»");
+                if (frame.objectSize > maxObjectSize) out.report(line);
+                else out.inform(line);
+            }
+            else if (frame.id == "PRIV" && frame.objectSize > maxPrivateSize) {
+                out.report(where + ": большой приватный кадр владельца «" + printableText(frame.description) + "»");
+            }
+        }
+        if (tag.paddingNonZero) {
+            out.report("- MP3: ненулевые байты в заполнении тега ID3v2: " + out.describe(tag.padding));
+        }
+        if (tag.unparsed.length > 0) {
+            out.report("- MP3: нераспознанные данные в теге ID3v2: " + out.describe(tag.unparsed));
+        }
+    }
+
+    if (mp3.audio.frames == 0) {
+        out.report("- MP3: после тегов ID3v2 нет кадров MPEG-аудио");
+        return out.anomaly;
+    }
+
+    // Полезная нагрузка — поток кадров без разрывов; если записаны не все
+    // разрывы, поток целиком остаётся для поиска вложенных файлов
+    if (mp3.audio.gapCount == mp3.audio.gaps.size()) {
+        std::vector<ByteRange> outside = mp3.audio.gaps;
+        outside.push_back({ 0, mp3.audio.firstFrame });
+        outside.push_back({ mp3.audio.end, size - mp3.audio.end });
+        for (const ByteRange& frames : uncoveredRanges(std::move(outside), size)) payload.push_back(frames);
+    }
+
+    // Данные вне кадров: до первого кадра, в разрывах потока и после последнего кадра
+    if (mp3.leading.length > 0) {
+        if (out.zeroFilled(mp3.leading)) out.inform("- MP3: нули перед первым кадром: " + formatByteRange(mp3.leading));
+        else out.report("- MP3: данные перед первым кадром: " + out.describe(mp3.leading));
+    }
+    for (size_t i = 0; i < mp3.audio.gaps.size() && i < maxReportedGaps; ++i) {
+        out.report("- MP3: разрыв потока кадров: " + out.describe(mp3.audio.gaps[i]));
+    }
+    if (mp3.audio.gapCount > maxReportedGaps) {
+        out.report("- MP3: всего разрывов потока: " + std::to_string(mp3.audio.gapCount) +
+            " (" + std::to_string(mp3.audio.gapBytes) + " байт)");
+    }
+    if (mp3.trailing.length > 0) {
+        if (out.zeroFilled(mp3.trailing)) out.inform("- MP3: нули после последнего кадра: " + formatByteRange(mp3.trailing));
+        else out.report("- MP3: данные после последнего кадра: " + out.describe(mp3.trailing));
+    }
+    return out.anomaly;
+}
+
+bool SteganographyChecker::performWavAnalysis(const uint8_t* data, size_t size,
+    std::vector<std::string>& reportLines, std::vector<ByteRange>& payload) {
+    // Кадры PCM раскладываются в строки представления: полосы строк
+    // обрабатываются параллельно, неполная последняя строка отбрасывается
+    const size_t framesPerRow = 4096;
+    const uint64_t minFrames = 1024;
+
+    WavStructure wav;
+    if (!parseWavStructure(data, size, wav)) {
+        std::string line = "- WAV: нет заголовка RIFF/WAVE.";
+        reportLines.push_back(line);
+        console() << line << "\n";
+        return true;
+    }
+
+    StructureReporter out{ reportLines, ByteView(data, size) };
+    if (wav.samples.length > 0) payload.push_back(wav.samples);
+
+    const WavFormat& fmt = wav.format;
+    const uint64_t frames = fmt.blockAlign ? wav.samples.length / fmt.blockAlign : 0;
+    if (!wav.hasFormat) {
+        out.report("- WAV: нет чанка fmt");
+    }
+    else {
+        std::ostringstream line;
+        line << "- WAV: " << (fmt.pcm() ? "PCM" : fmt.formatTag == 3 ? "IEEE float" : "тег формата " + std::to_string(fmt.formatTag))
+            << (fmt.extensible ? " (EXTENSIBLE)" : "") << ", " << fmt.bitsPerSample << " бит, каналов: " << fmt.channels
+            << ", " << fmt.sampleRate << " Гц, кадров: " << frames;
+        out.inform(line.str());
+    }
+
+    // Чанки вне спецификации и заполнение с ненулевыми данными
+    for (const WavChunk& chunk : wav.chunks) {
+        ByteRange payload{ chunk.payload(), std::min<uint64_t>(chunk.size, size - chunk.payload()) };
+        std::string name = fourCCName(chunk.fourcc);
+        if (!kWavChunks.contains(chunk.fourcc)) {
+            out.report("- WAV: нестандартный чанк '" + name + "': " + out.describe(payload));
+        }
+        else if ((chunk.fourcc == fourCC("JUNK") || chunk.fourcc == fourCC("junk") || chunk.fourcc == fourCC("PAD ") ||
+            chunk.fourcc == fourCC("FLLR")) && payload.length > 0 && !out.zeroFilled(payload)) {
+            out.report("- WAV: ненулевые данные в чанке заполнения '" + name + "': " + out.describe(payload));
+        }
+    }
+    if (wav.dataChunks > 1) {
+        out.report("- WAV: чанков data: " + std::to_string(wav.dataChunks) + ", воспроизводится только первый");
+    }
+    if (wav.overflow) {
+        out.report("- WAV: чанк '" + fourCCName(wav.overflowChunk.fourcc) + "' по смещению " +
+            formatHexOffset(wav.overflowChunk.offset) + " выходит за пределы RIFF");
+    }
+    if (wav.truncated) out.inform("- WAV: чанк data обрывается концом файла");
+    if (wav.streamingSize) out.inform("- WAV: размер чанка data не записан, данные до конца файла");
+
+    // Остаток RIFF, не вместивший заголовок чанка, и данные после конца RIFF
+    const uint64_t riffEnd = wav.riffSizeUnset ? size : std::min<uint64_t>(wav.riffEnd, size);
+    if (!wav.overflow && !wav.truncated && !wav.streamingSize && wav.chunksEnd < riffEnd) {
+        ByteRange rest{ wav.chunksEnd, riffEnd - wav.chunksEnd };
+        if (!out.zeroFilled(rest)) out.report("- WAV: данные после последнего чанка внутри RIFF: " + out.describe(rest));
+    }
+    if (!wav.riffSizeUnset && wav.riffEnd < size) {
+        ByteRange tail{ wav.riffEnd, size - wav.riffEnd };
+        if (out.zeroFilled(tail)) out.inform("- WAV: нули после конца RIFF: " + formatByteRange(tail));
+        else out.report("- WAV: данные после конца RIFF: " + out.describe(tail));
+    }
+
+    if (!wav.hasFormat || wav.samples.length == 0) return out.anomaly;
+    const size_t bytes = fmt.bytesPerSample();
+    if (!fmt.pcm() || bytes == 0 || bytes > 4 || fmt.channels == 0 ||
+        fmt.blockAlign != static_cast<uint64_t>(fmt.channels) * bytes) {
+        out.inform("- WAV: статистика LSB по отсчётам не применяется к этому формату");
+        return out.anomaly;
+    }
+    if (frames < minFrames) {
+        out.inform("- WAV: слишком мало кадров для статистики LSB");
+        return out.anomaly;
+    }
+    if (wav.samples.length % fmt.blockAlign != 0) {
+        out.inform("- WAV: неполный кадр в конце data (" + std::to_string(wav.samples.length % fmt.blockAlign) + " байт)");
+    }
+
+    // Каналы читаются прямо из чередующихся кадров: base смещён на канал,
+    // шаг — размер кадра, строка — framesPerRow кадров подряд
+    size_t width = static_cast<size_t>(std::min<uint64_t>(frames, framesPerRow));
+    size_t height = static_cast<size_t>(frames / width);
+    std::vector<SampleView> views;
+    std::vector<std::string> labels;
+    for (size_t c = 0; c < fmt.channels; ++c) {
+        SampleView view;
+        view.base = data + wav.samples.offset + c * bytes;
+        view.width = width;
+        view.height = height;
+        view.step = fmt.blockAlign;
+        view.rowStride = width * fmt.blockAlign;
+        view.bytesPerSample = bytes;
+        views.push_back(view);
+        labels.push_back(fmt.channels == 2 ? (c == 0 ? "L" : "R") : std::to_string(c + 1));
+    }
+    std::vector<const char*> names;
+    for (const std::string& label : labels) names.push_back(label.c_str());
+
+    out.inform("- Анализ отсчётов PCM (по отображению файла, без копирования): " + std::to_string(width * height) +
+        " кадров" + (bytes > 1 ? ", χ² по окну значений [-128, 128)" : ""));
+    if (reportChannelStatistics(views, names, reportLines, nullptr)) {
+        out.anomaly = true;
+    }
+    return out.anomaly;
+}
+
+bool SteganographyChecker::performEmbeddedFileAnalysis(const uint8_t* data, size_t size,
+    const std::vector<ByteRange>& search, std::vector<std::string>& reportLines, std::vector<ChildRange>& carved) {
+    if (!data || size == 0) return false;
+    bool anomaly = false;
+    for (const EmbeddedFile& file : findEmbeddedFiles(data, size, search)) {
+        std::string line = "- [!] Вложенный файл " + file.type + " (" + file.detail + "): " + formatByteRange(file.range) +
+            (file.complete ? "" : file.range.end() == size ? ", до конца данных" : ", конец не определён");
+        reportLines.push_back(line);
+        console() << line << "\n";
+        anomaly = true;
+        carved.push_back({ file.range, "вложенный " + file.type, true });
+    }
+    return anomaly;
+}
+
+bool SteganographyChecker::analyzeData(const std::string& format, ByteView data,
+    std::vector<std::string>& reportLines, size_t depth) {
+    bool anomaly = false;
+    std::vector<ChildRange> trailing;
+    // Сэмплы mdat, кластеры, кадры MPEG и отсчёты data описаны структурой
+    // и при поиске вложенных файлов пропускаются: многогигабайтный файл не
+    // читается целиком ради сигнатур
+    std::vector<ByteRange> payload;
+    if (isIsoBmffFormat(format)) {
+        anomaly = performIsoBmffAnalysis(data.data(), data.size(), reportLines, payload);
+    }
+    else if (isMatroskaFormat(format)) {
+        anomaly = performEbmlAnalysis(format, data.data(), data.size(), reportLines, payload);
+    }
+    else if (format == "MP3") {
+        anomaly = performMp3Analysis(data.data(), data.size(), reportLines, payload);
+    }
+    else if (format == "WAV") {
+        anomaly = performWavAnalysis(data.data(), data.size(), reportLines, payload);
+    }
+    else {
+        anomaly = analyzeBuffer(format, data, reportLines, trailing);
+    }
+
+    std::vector<ChildRange> carved;
+    if (performEmbeddedFileAnalysis(data.data(), data.size(), uncoveredRanges(std::move(payload), data.size()),
+        reportLines, carved)) {
+        anomaly = true;
+    }
+
+    // Данные после конца формата, которые начинаются с вырезанного файла,
+    // анализируются в его границах. Файлы внутри хвоста найдёт задание,
+    // разбирающее хвост, и отдельные задания для них не создаются
+    std::vector<ChildRange> children;
+    for (const ChildRange& tail : trailing) {
+        bool startsWithFile = std::any_of(carved.begin(), carved.end(),
+            [&](const ChildRange& c) { return c.range.offset == tail.range.offset; });
+        if (!startsWithFile) children.push_back(tail);
+    }
+    const size_t tails = children.size();
+    for (const ChildRange& file : carved) {
+        bool insideTail = std::any_of(children.begin(), children.begin() + tails,
+            [&](const ChildRange& t) { return file.range.offset > t.range.offset && file.range.offset < t.range.end(); });
+        if (!insideTail) children.push_back(file);
+    }
+    std::sort(children.begin(), children.end(),
+        [](const ChildRange& a, const ChildRange& b) { return a.range.offset < b.range.offset; });
+
+    if (analyzeChildRanges(data, children, reportLines, depth)) {
+        anomaly = true;
+    }
+    return anomaly;
+}
+
+bool SteganographyChecker::analyzeChildRanges(ByteView data, const std::vector<ChildRange>& children,
+    std::vector<std::string>& reportLines, size_t depth) {
+    if (children.empty()) return false;
+    if (depth + 1 > kMaxChildDepth) {
+        std::string line = "- Вложенные участки (" + std::to_string(children.size()) +
+            ") не анализируются: достигнута глубина вложенности " + std::to_string(kMaxChildDepth);
+        reportLines.push_back(line);
+        console() << line << "\n";
+        return false;
+    }
+
+    std::vector<const ChildRange*> jobs;
+    size_t skipped = 0;
+    for (const ChildRange& child : children) {
+        if (child.range.length < kMinChildBytes) continue;
+        if (child.range.length > kMaxChildBytes) {
+            std::string line = "- Участок " + child.source + " " + formatByteRange(child.range) +
+                " слишком велик для повторного анализа";
+            reportLines.push_back(line);
+            console() << line << "\n";
+            continue;
+        }
+        if (jobs.size() == kMaxChildJobs) {
+            skipped++;
+            continue;
+        }
+        jobs.push_back(&child);
+    }
+
+    struct ChildReport {
+        std::vector<std::string> lines;
+        std::string console;
+        bool anomaly = false;
+    };
+    std::vector<ChildReport> results(jobs.size());
+    ThreadPool::shared().parallelFor(jobs.size(), [&](size_t i) {
+        ConsoleCapture capture;
+        const ChildRange& child = *jobs[i];
+        results[i].anomaly = analyzeChildRange(data.subview(child.range), child, results[i].lines, depth + 1);
+        results[i].console = capture.text();
+    });
+
+    bool anomaly = false;
+    for (const ChildReport& result : results) {
+        for (const std::string& line : result.lines) {
+            reportLines.push_back("  " + line);
+        }
+        console() << indentLines(result.console);
+        anomaly = anomaly || result.anomaly;
+    }
+    if (skipped > 0) {
+        std::string line = "- Не проанализировано вложенных участков сверх предела " +
+            std::to_string(kMaxChildJobs) + ": " + std::to_string(skipped);
+        reportLines.push_back(line);
+        console() << line << "\n";
+    }
+    return anomaly;
+}
+
+bool SteganographyChecker::analyzeChildRange(ByteView data, const ChildRange& child,
+    std::vector<std::string>& reportLines, size_t depth) {
+    // Смещения в отчёте задания отсчитываются от начала участка
+    const size_t signatureBytes = 64;
+    std::vector<uint8_t> signature(data.begin(), data.begin() + std::min(data.size(), signatureBytes));
+    std::string format = FileReader(std::string()).detectFileType(signature);
+
+    std::string header = "- Участок " + child.source + " " + formatByteRange(child.range) + ": формат " + format;
+    reportLines.push_back(header);
+    console() << header << "\n";
+
+    bool anomaly = false;
+    if (scanner_) {
+        std::string threat = scanner_->analyzeMemory(data.data(), data.size());
+        std::string line = threat == "OK"
+            ? "- YARA: угроз не обнаружено"
+            : "- [!] YARA: обнаружена угроза " + threat;
+        reportLines.push_back(line);
+        console() << line << "\n";
+        anomaly = threat != "OK";
+    }
+    if (isSupportedFormat(format)) {
+        if (analyzeData(format, data, reportLines, depth)) anomaly = true;
+    }
+    else if (!child.carved) {
+        // Хвост неизвестного формата: задания получают файлы, найденные в нём
+        std::vector<ChildRange> carved;
+        if (performEmbeddedFileAnalysis(data.data(), data.size(), { { 0, data.size() } }, reportLines, carved)) anomaly = true;
+        if (analyzeChildRanges(data, carved, reportLines, depth)) anomaly = true;
+    }
+    return anomaly;
+}
+
+bool SteganographyChecker::reportChiSquareCurve(const ChiSquareWindowCurve& curve,
     std::vector<std::string>& reportLines) {
+    if (curve.growing.empty()) return false;
+    bool anomaly = false;
+
+    std::ostringstream points;
+    points << std::fixed << std::setprecision(3);
+    for (size_t k = curve.steps / 10 - 1; k < curve.steps; k += curve.steps / 10) {
+        points << (k + 1) * 100 / curve.steps << "%=" << curve.growing[k] << " ";
+    }
+    std::string line = "- χ²-атака (растущее окно): " + points.str();
+    reportLines.push_back(line);
+    console() << line << "\n";
+
+    if (curve.estimatedPayloadSamples > 0) {
+        size_t percent = curve.estimatedPayloadSamples * 100 / curve.totalSamples;
+        std::string warn = "- [!] χ²-атака: последовательное встраивание от начала данных, оценка длины сообщения ~" +
+            std::to_string(curve.estimatedPayloadSamples / 8) + " байт (" + std::to_string(percent) + "% отсчётов)";
+        reportLines.push_back(warn);
+        console() << warn << "\n";
+        anomaly = true;
+    }
+
+    // Участки, где скользящее окно показывает выравнивание пар значений
+    size_t reported = 0;
+    for (size_t j = 0; j < curve.sliding.size() && reported < 5; ++j) {
+        if (curve.sliding[j] <= 0.95) continue;
+        size_t first = j;
+        while (j + 1 < curve.sliding.size() && curve.sliding[j + 1] > 0.95) ++j;
+        size_t startPercent = first * 100 / curve.steps;
+        size_t endPercent = (j + curve.windowSteps) * 100 / curve.steps;
+        std::string warn = "- [!] χ²-атака (скользящее окно): признаки встраивания в отсчётах " +
+            std::to_string(startPercent) + "%–" + std::to_string(endPercent) + "%";
+        reportLines.push_back(warn);
+        console() << warn << "\n";
+        anomaly = true;
+        reported++;
+    }
+    return anomaly;
+}
+
+bool SteganographyChecker::analyzeBuffer(const std::string& format,
+    ByteView buffer,
+    std::vector<std::string>& reportLines,
+    std::vector<ChildRange>& trailing) {
     bool anomalyDetected = false;
 
     if (format == "JPEG") {
         if (buffer.size() < 2 || buffer[0] != 0xFF || buffer[1] != 0xD8) {
             std::string line = "- JPEG: неверный или отсутствующий заголовок JPEG.";
             reportLines.push_back(line);
-            std::cout << line << "\n";
+            console() << line << "\n";
             anomalyDetected = true;
         }
         else {
-            size_t eoiPos = 0;
-            bool foundEOI = false;
-            size_t pos = 2; // После SOI
-
-            while (pos + 3 < buffer.size()) {
-                if (buffer[pos] != 0xFF) {
-                    pos++;
-                    continue;
-                }
-
-                uint8_t marker = buffer[pos + 1];
-                // EOI
-                if (marker == 0xD9) {
-                    eoiPos = pos + 2;
-                    foundEOI = true;
-                    break;
-                }
-
-                // Некоторые сегменты без длины (RSTn, SOI, EOI) пропускаем
-                if (marker >= 0xD0 && marker <= 0xD7) {
-                    pos += 2;
-                    continue;
-                }
-
-                // Иначе читаем длину сегмента
-                if (pos + 4 > buffer.size()) break; // Ошибка
-                uint16_t length = (uint16_t(buffer[pos + 2]) << 8) | uint16_t(buffer[pos + 3]);
+            JpegSegmentIterator segments(buffer.data(), buffer.size(), 2);
+            JpegSegment segment;
+            while (segments.next(segment)) {
+                uint8_t marker = segment.marker;
 
                 // Проверка на APPn или COM сегменты
                 if ((marker >= 0xE0 && marker <= 0xEF) || marker == 0xFE) {
                     std::string segType = (marker == 0xFE) ? "COM" : ("APP" + std::to_string(marker - 0xE0));
-                    if (length > 2048) { // Порог: 2 КБ для текстовых сегментов
-                        std::string line = "- JPEG: подозрительно большой сегмент " + segType + " (" + std::to_string(length) + " байт)";
+                    if (segment.length > 2048) { // Порог: 2 КБ для текстовых сегментов
+                        std::string line = "- JPEG: подозрительно большой сегмент " + segType + " (" + std::to_string(segment.length) + " байт)";
                         reportLines.push_back(line);
-                        std::cout << line << "\n";
+                        console() << line << "\n";
                         anomalyDetected = true;
                     }
 
-                    // Специально для APP1 (EXIF)
-                    if (marker == 0xE1 && pos + 10 < buffer.size()) {
-                        std::string header((const char*)&buffer[pos + 4], 6);
-                        if (header != "Exif\0\0") {
-                            std::string line = "- JPEG: APP1 сегмент не содержит правильного заголовка EXIF.";
-                            reportLines.push_back(line);
-                            std::cout << line << "\n";
-                            anomalyDetected = true;
-                        }
+                    // Специально для APP1: EXIF или XMP
+                    if (marker == 0xE1 && !isKnownApp1Header(segment.payload, segment.payloadSize)) {
+                        std::string line = "- JPEG: APP1 сегмент не содержит правильного заголовка EXIF.";
+                        reportLines.push_back(line);
+                        console() << line << "\n";
+                        anomalyDetected = true;
                     }
                 }
-
-                if (length < 2) break; // Ошибка длины
-                pos += length + 2;
             }
 
+            bool foundEOI = segments.reachedEoi();
+            size_t eoiPos = segments.eoiEnd();
             if (foundEOI && eoiPos < buffer.size()) {
                 size_t extra = buffer.size() - eoiPos;
                 std::string line = "- JPEG: обнаружены дополнительные данные после EOI: " + std::to_string(extra) + " байт";
                 reportLines.push_back(line);
-                std::cout << line << "\n";
+                console() << line << "\n";
                 anomalyDetected = true;
+                trailing.push_back({ { eoiPos, extra }, "после EOI" });
             }
         }
     }
@@ -234,56 +1825,63 @@ bool SteganographyChecker::analyzeBuffer(const std::string& filePath,
         if (buffer.size() < 8 || buffer[0] != 0x89 || buffer[1] != 0x50 || buffer[2] != 0x4E || buffer[3] != 0x47) {
             std::string line = "- PNG: неверная сигнатура файла.";
             reportLines.push_back(line);
-            std::cout << line << "\n";
+            console() << line << "\n";
             anomalyDetected = true;
         }
         else {
             bool foundIEND = false;
             size_t index = 8;
             size_t fileSizeBuf = buffer.size();
-            static const std::vector<std::string> standardChunks = {
-                "IHDR", "PLTE", "IDAT", "IEND", "tEXt", "zTXt", "iTXt",
-                "pHYs", "gAMA", "cHRM", "sRGB", "bKGD", "hIST", "iCCP", "sBIT", "tIME", "tRNS"
-            };
+            size_t crcErrors = 0;
+            const size_t maxReportedCrcErrors = 10;
 
             while (index + 8 <= fileSizeBuf) {
-                uint32_t length = (uint32_t(buffer[index]) << 24) |
-                    (uint32_t(buffer[index + 1]) << 16) |
-                    (uint32_t(buffer[index + 2]) << 8) |
-                    (uint32_t(buffer[index + 3]));
-
-                std::string chunkType((const char*)&buffer[index + 4], 4);
+                uint32_t length = readBE32(&buffer[index]);
+                uint32_t chunkType = readFourCC(&buffer[index + 4]);
+                size_t chunkOffset = index;
                 index += 8;
 
-                bool isStandard = false;
-                for (const auto& stdChunk : standardChunks) {
-                    if (chunkType == stdChunk) {
-                        isStandard = true;
-                        break;
+                // CRC покрывает тип и данные чанка
+                if (index + length + 4 <= fileSizeBuf) {
+                    uint32_t storedCrc = readBE32(&buffer[index + length]);
+                    uint32_t actualCrc = computeCrc32(&buffer[chunkOffset + 4], length + 4);
+                    if (storedCrc != actualCrc) {
+                        crcErrors++;
+                        if (crcErrors <= maxReportedCrcErrors) {
+                            std::ostringstream line;
+                            line << "- PNG: неверная CRC чанка " << fourCCName(chunkType) << " по смещению "
+                                << formatHexOffset(chunkOffset) << " (" << length << " байт): записано 0x"
+                                << std::hex << std::uppercase << std::setw(8) << std::setfill('0') << storedCrc
+                                << ", вычислено 0x" << std::setw(8) << actualCrc;
+                            reportLines.push_back(line.str());
+                            console() << line.str() << "\n";
+                        }
+                        anomalyDetected = true;
                     }
                 }
 
-                if (!isStandard) {
-                    std::string line = "- PNG: обнаружен нестандартный чанк: " + chunkType;
+                if (!kPngChunks.contains(chunkType)) {
+                    std::string line = "- PNG: обнаружен нестандартный чанк: " + fourCCName(chunkType);
                     reportLines.push_back(line);
-                    std::cout << line << "\n";
+                    console() << line << "\n";
                     anomalyDetected = true;
                 }
 
-                if (chunkType == "tEXt" || chunkType == "iTXt" || chunkType == "zTXt") {
+                const bool isText = chunkType == fourCC("tEXt") || chunkType == fourCC("iTXt") || chunkType == fourCC("zTXt");
+                if (isText) {
                     if (index + length > buffer.size()) break; // Защита от выхода за границы
                     const uint8_t* chunkData = &buffer[index];
 
                     // Проверка размера текстового чанка
                     if (length > 2048) { // Порог: 2 КБ
-                        std::string line = "- PNG: слишком большой размер текстового чанка " + chunkType + " (" + std::to_string(length) + " байт)";
+                        std::string line = "- PNG: слишком большой размер текстового чанка " + fourCCName(chunkType) + " (" + std::to_string(length) + " байт)";
                         reportLines.push_back(line);
-                        std::cout << line << "\n";
+                        console() << line << "\n";
                         anomalyDetected = true;
                     }
 
                     // Проверка наличия разделителя '\0' (для tEXt и iTXt)
-                    if (chunkType == "tEXt" || chunkType == "iTXt") {
+                    if (chunkType != fourCC("zTXt")) {
                         bool hasNullSeparator = false;
                         for (uint32_t i = 0; i < length; ++i) {
                             if (chunkData[i] == 0) {
@@ -292,15 +1890,15 @@ bool SteganographyChecker::analyzeBuffer(const std::string& filePath,
                             }
                         }
                         if (!hasNullSeparator) {
-                            std::string line = "- PNG: некорректная структура данных в текстовом чанке " + chunkType + " (нет разделителя '\\0')";
+                            std::string line = "- PNG: некорректная структура данных в текстовом чанке " + fourCCName(chunkType) + " (нет разделителя '\\0')";
                             reportLines.push_back(line);
-                            std::cout << line << "\n";
+                            console() << line << "\n";
                             anomalyDetected = true;
                         }
                     }
                 }
 
-                if (chunkType == "IEND") {
+                if (chunkType == fourCC("IEND")) {
                     foundIEND = true;
                     size_t endPos = index + length + 4;
                     if (endPos > fileSizeBuf) endPos = fileSizeBuf;
@@ -308,8 +1906,9 @@ bool SteganographyChecker::analyzeBuffer(const std::string& filePath,
                         size_t extra = fileSizeBuf - endPos;
                         std::string line = "- PNG: обнаружены данные после IEND: " + std::to_string(extra) + " байт";
                         reportLines.push_back(line);
-                        std::cout << line << "\n";
+                        console() << line << "\n";
                         anomalyDetected = true;
+                        trailing.push_back({ { endPos, extra }, "после IEND" });
                     }
                     break;
                 }
@@ -318,10 +1917,20 @@ bool SteganographyChecker::analyzeBuffer(const std::string& filePath,
                 index += length + 4;
             }
 
+            if (performPngStreamAnalysis(buffer, reportLines)) {
+                anomalyDetected = true;
+            }
+
+            if (crcErrors > maxReportedCrcErrors) {
+                std::string line = "- PNG: всего чанков с неверной CRC: " + std::to_string(crcErrors);
+                reportLines.push_back(line);
+                console() << line << "\n";
+            }
+
             if (!foundIEND) {
                 std::string line = "- PNG: IEND не найден, файл может быть повреждён.";
                 reportLines.push_back(line);
-                std::cout << line << "\n";
+                console() << line << "\n";
                 anomalyDetected = true;
             }
         }
@@ -330,29 +1939,18 @@ bool SteganographyChecker::analyzeBuffer(const std::string& filePath,
         if (buffer.size() < 6 || buffer[0] != 'B' || buffer[1] != 'M') {
             std::string line = "- BMP: неверный или повреждённый заголовок.";
             reportLines.push_back(line);
-            std::cout << line << "\n";
+            console() << line << "\n";
             anomalyDetected = true;
         }
-        else {
-            uint32_t headerSize = (uint32_t)buffer[2] |
-                ((uint32_t)buffer[3] << 8) |
-                ((uint32_t)buffer[4] << 16) |
-                ((uint32_t)buffer[5] << 24);
-            uintmax_t actualSize = buffer.size();
-            if (actualSize > headerSize) {
-                uintmax_t extra = actualSize - headerSize;
-                std::string line = "- BMP: обнаружены дополнительные данные: " + std::to_string(extra) + " байт";
-                reportLines.push_back(line);
-                std::cout << line << "\n";
-                anomalyDetected = true;
-            }
+        else if (performBmpStructureAnalysis(buffer, reportLines)) {
+            anomalyDetected = true;
         }
     }
     else if (format == "GIF") {
         if (buffer.size() < 6) {
             std::string line = "- GIF: файл слишком мал.";
             reportLines.push_back(line);
-            std::cout << line << "\n";
+            console() << line << "\n";
             anomalyDetected = true;
         }
         else {
@@ -360,87 +1958,55 @@ bool SteganographyChecker::analyzeBuffer(const std::string& filePath,
             if (header != "GIF89a" && header != "GIF87a") {
                 std::string line = "- GIF: неподдерживаемый или повреждённый заголовок.";
                 reportLines.push_back(line);
-                std::cout << line << "\n";
+                console() << line << "\n";
                 anomalyDetected = true;
             }
-            if (buffer.empty() || buffer.back() != 0x3B) {
-                std::string line = "- GIF: отсутствует трейлер (0x3B) — возможно, файл обрезан.";
-                reportLines.push_back(line);
-                std::cout << line << "\n";
+            else if (performGifStructureAnalysis(buffer, reportLines)) {
                 anomalyDetected = true;
             }
         }
     }
-    else if (format == "TIFF") {
-        if (buffer.size() < 4) {
+    else if (format == "TIFF" || format == "CR2" || format == "NEF" || format == "DNG") {
+        if (buffer.size() < 8) {
             std::string line = "- TIFF: файл слишком мал или повреждён.";
             reportLines.push_back(line);
-            std::cout << line << "\n";
+            console() << line << "\n";
             anomalyDetected = true;
         }
-        else {
-            bool validHeader = ((buffer[0] == 'I' && buffer[1] == 'I' && buffer[2] == 0x2A && buffer[3] == 0x00) ||
-                (buffer[0] == 'M' && buffer[1] == 'M' && buffer[2] == 0x00 && buffer[3] == 0x2A));
-            if (!validHeader) {
-                std::string line = "- TIFF: неверная сигнатура TIFF.";
-                reportLines.push_back(line);
-                std::cout << line << "\n";
-                anomalyDetected = true;
-            }
-            if (buffer.size() > 50ULL * 1024ULL * 1024ULL) {
-                std::string line = "- TIFF: подозрительно большой размер (" + std::to_string(buffer.size()) + " байт), возможна стеганография.";
-                reportLines.push_back(line);
-                std::cout << line << "\n";
-                anomalyDetected = true;
-            }
+        else if (performTiffStructureAnalysis(buffer, reportLines)) {
+            anomalyDetected = true;
         }
     }
     else if (format == "PSD") {
-        if (buffer.size() < 4 || std::string((const char*)buffer.data(), 4) != "8BPS") {
+        if (buffer.size() < 4 || readFourCC(buffer.data()) != fourCC("8BPS")) {
             std::string line = "- PSD: повреждённый или неподдерживаемый заголовок.";
             reportLines.push_back(line);
-            std::cout << line << "\n";
+            console() << line << "\n";
             anomalyDetected = true;
         }
         if (buffer.size() > 100ULL * 1024ULL * 1024ULL) {
             std::string line = "- PSD: необычно большой размер файла, возможна стеганография.";
             reportLines.push_back(line);
-            std::cout << line << "\n";
+            console() << line << "\n";
             anomalyDetected = true;
         }
     }
     else if (format == "WEBP") {
-        if (buffer.size() < 12 || std::string((const char*)buffer.data(), 4) != "RIFF" || std::string((const char*)buffer.data() + 8, 4) != "WEBP") {
+        if (buffer.size() < 12 || readFourCC(buffer.data()) != fourCC("RIFF") || readFourCC(buffer.data() + 8) != fourCC("WEBP")) {
             std::string line = "- WebP: неверная структура заголовка RIFF/WEBP.";
             reportLines.push_back(line);
-            std::cout << line << "\n";
+            console() << line << "\n";
             anomalyDetected = true;
         }
-        else {
-            size_t i = 12;
-            while (i + 8 <= buffer.size()) {
-                std::string chunkID((const char*)&buffer[i], 4);
-                uint32_t chunkSize = (uint32_t)buffer[i + 4] |
-                    ((uint32_t)buffer[i + 5] << 8) |
-                    ((uint32_t)buffer[i + 6] << 16) |
-                    ((uint32_t)buffer[i + 7] << 24);
-                if (!(chunkID == "VP8 " || chunkID == "VP8L" || chunkID == "VP8X" ||
-                    chunkID == "ALPH" || chunkID == "ANIM" || chunkID == "ANMF")) {
-                    std::string line = "- WebP: обнаружен нестандартный chunk: " + chunkID;
-                    reportLines.push_back(line);
-                    std::cout << line << "\n";
-                    anomalyDetected = true;
-                }
-                i += 8 + chunkSize;
-                if (chunkSize % 2 == 1) i += 1;
-            }
+        else if (performWebpStructureAnalysis(buffer, reportLines)) {
+            anomalyDetected = true;
         }
     }
     else if (format == "EMF" || format == "WMF") {
         if (buffer.size() < 44) {
             std::string line = "- EMF/WMF: файл слишком мал для анализа.";
             reportLines.push_back(line);
-            std::cout << line << "\n";
+            console() << line << "\n";
             anomalyDetected = true;
         }
         else {
@@ -451,7 +2017,7 @@ bool SteganographyChecker::analyzeBuffer(const std::string& filePath,
             std::string fmt = isEMF ? "EMF" : "WMF";
             std::string line = "- Определён формат: " + fmt;
             reportLines.push_back(line);
-            std::cout << line << "\n";
+            console() << line << "\n";
 
             if (isEMF) {
                 uint32_t declaredSize = (uint32_t)buffer[4] |
@@ -463,15 +2029,31 @@ bool SteganographyChecker::analyzeBuffer(const std::string& filePath,
                     size_t extra = buffer.size() - expectedBytes;
                     std::string extraLine = "- Обнаружены дополнительные данные после EMF: " + std::to_string(extra) + " байт";
                     reportLines.push_back(extraLine);
-                    std::cout << extraLine << "\n";
+                    console() << extraLine << "\n";
                     anomalyDetected = true;
+                    if (expectedBytes > 0) trailing.push_back({ { expectedBytes, extra }, "после EMF" });
                 }
             }
         }
     }
 
+    if (isLSBRelevantFormat(format) || format == "EMF" || format == "WMF") {
+        if (performEntropyMapAnalysis(format, buffer, reportLines)) {
+            anomalyDetected = true;
+        }
+    }
+
     if (isLSBRelevantFormat(format)) {
-        bool lsbAnomaly = performLSBAnalysis(buffer, reportLines);
+        // Для сжатых форматов LSB байтов файла не отражает LSB пикселей,
+        // поэтому при возможности анализируются декодированные пиксели.
+        // JPEG-стеганография работает с DCT-коэффициентами, их статистика
+        // считается без восстановления пикселей
+        bool lsbAnomaly = false;
+        bool analyzed = (format == "JPEG" && performJpegCoefficientAnalysis(buffer, reportLines, lsbAnomaly)) ||
+            (format == "BMP" && performBmpPixelAnalysis(buffer, reportLines, lsbAnomaly));
+        if (!analyzed && (!isDecodableImageFormat(format) || !performPixelAnalysis(buffer, reportLines, lsbAnomaly))) {
+            lsbAnomaly = performLSBAnalysis(buffer, reportLines);
+        }
         if (lsbAnomaly) {
             anomalyDetected = true;
         }
@@ -4,20 +4,138 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include "pixel_statistics.h"
+#include "lsb_kernels.h"
+#include "byte_ranges.h"
+#include "chunk_source.h"
+
+class SignatureScanner;
+class RandomAccessFile;
 
 class SteganographyChecker {
 public:
+    // Сканер YARA для файлов, вырезанных из анализируемого, и данных после
+    // конца формата; без него такие участки проверяются только по структуре
+    void setSignatureScanner(SignatureScanner* scanner) { scanner_ = scanner; }
+
     // Анализ одного файла и директории
     std::vector<std::string> analyzeFile(const std::string& filePath);  // ✅ Добавлен возврат отчёта
     std::vector<std::pair<std::string, std::vector<std::string>>> analyzeDirectory(const std::string& dirPath);
 
+    // Анализ данных в памяти (элемент архива); name — имя для отчёта
+    std::vector<std::string> analyzeMemory(const std::string& name, const uint8_t* data, size_t size);
+
 private:
-    bool analyzeBuffer(const std::string& filePath, const std::string& format, const std::vector<uint8_t>& buffer, std::vector<std::string>& reportLines);
+    // Участок данных для дочернего задания: вырезанный файл или данные после
+    // конца формата (EOI, IEND, размер EMF)
+    struct ChildRange {
+        ByteRange range;
+        std::string source;       // "после EOI", "вложенный ZIP" и т. п.
+        bool carved = false;      // границы найдены по структуре вложенного файла
+    };
+
+    // Проверки структуры и статистики для формата из списка поддерживаемых,
+    // поиск вложенных файлов и дочерние задания для найденных участков.
+    // depth — уровень вложенности, у самого файла 0
+    bool analyzeData(const std::string& format, ByteView data, std::vector<std::string>& reportLines, size_t depth);
+
+    // Дочерние задания в общем пуле: определение типа, YARA и analyzeData на
+    // виде участка без копирования. Вывод заданий собирается и добавляется
+    // к отчёту в порядке смещений с отступом; глубина, число и размер
+    // участков ограничены
+    bool analyzeChildRanges(ByteView data, const std::vector<ChildRange>& children, std::vector<std::string>& reportLines, size_t depth);
+    bool analyzeChildRange(ByteView data, const ChildRange& child, std::vector<std::string>& reportLines, size_t depth);
+
+    // Разбор формата по буферу; участки после конца формата добавляются в trailing
+    bool analyzeBuffer(const std::string& format, ByteView buffer, std::vector<std::string>& reportLines, std::vector<ChildRange>& trailing);
     
+    // Источник для проходов по всем байтам участка: участки анализируемого
+    // файла читаются через pread в фиксированный буфер, остальные данные
+    // отдаются видами памяти
+    ChunkSource chunkSource(ByteView data) const;
+
     // Определение, нужен ли LSB-анализ для данного формата
     bool isLSBRelevantFormat(const std::string& format) const;
-    bool performLSBAnalysis(const std::vector<uint8_t>& buffer, std::vector<std::string>& reportLines);
+    bool performLSBAnalysis(ByteView buffer, std::vector<std::string>& reportLines);
+
+    // Карта энтропии по блокам 4 КБ и поиск высокоэнтропийных областей
+    bool performEntropyMapAnalysis(const std::string& format, ByteView buffer, std::vector<std::string>& reportLines);
+
+    // Статистический анализ декодированных пикселей (χ², RS, SPA по каналам).
+    // Возвращает false, если изображение не удалось декодировать
+    bool performPixelAnalysis(ByteView buffer, std::vector<std::string>& reportLines, bool& anomalyDetected);
+
+    // χ², RS, SPA по каналам и кривая χ²-атаки; при planes != nullptr
+    // битовые плоскости добавляются из гистограмм каналов
+    bool reportChannelStatistics(const std::vector<SampleView>& channels, const std::vector<const char*>& names,
+        std::vector<std::string>& reportLines, BitPlaneCounts* planes);
+
+    // LSB и χ² прямо по массиву пикселей BMP через строчные представления
+    // каналов. false — раскладка пикселей не поддерживается
+    bool performBmpPixelAnalysis(ByteView buffer, std::vector<std::string>& reportLines, bool& anomalyDetected);
+
+    // Заголовки BMP любой версии: геометрия массива пикселей, зазоры до и
+    // после него, байты выравнивания строк
+    bool performBmpStructureAnalysis(ByteView buffer, std::vector<std::string>& reportLines);
+
+    // Анализ квантованных DCT-коэффициентов JPEG без декодирования пикселей
+    // (JSteg, F5). Возвращает false, если энтропийные данные не декодируются
+    bool performJpegCoefficientAnalysis(ByteView buffer, std::vector<std::string>& reportLines, bool& anomalyDetected);
+
+    // Распаковка IDAT, zTXt, iTXt и iCCP с ограничением объёма: данные после
+    // конца zlib-потока, лишние байты сверх размера изображения, двоичный текст
+    bool performPngStreamAnalysis(ByteView buffer, std::vector<std::string>& reportLines);
+
+    // Обход блоков GIF: нестандартные расширения, области вне структуры
+    // (в том числе после трейлера), обрезанные блоки
+    bool performGifStructureAnalysis(ByteView buffer, std::vector<std::string>& reportLines);
+
+    // Обход каталогов TIFF (включая BigTIFF, DNG, CR2, NEF): карта байтов,
+    // на которые ссылаются каталоги, и области вне неё
+    bool performTiffStructureAnalysis(ByteView buffer, std::vector<std::string>& reportLines);
+
+    // Границы RIFF, согласованность флагов VP8X и чанков, заголовки VP8/VP8L
+    // и полнота кодов Хаффмана VP8L (CVE-2023-4863)
+    bool performWebpStructureAnalysis(ByteView buffer, std::vector<std::string>& reportLines);
+
+    // Обход боксов MP4/MOV/HEIF/AVIF по отображению файла: нестандартные и
+    // обрезанные боксы, данные после последнего бокса, содержимое free/skip
+    // и участки mdat, на которые не ссылаются таблицы сэмплов и iloc.
+    // Здесь и в трёх обходах ниже в payload добавляются участки полезной
+    // нагрузки, описанные структурой: в них вложенные файлы не ищутся
+    bool performIsoBmffAnalysis(const uint8_t* data, size_t size, std::vector<std::string>& reportLines,
+        std::vector<ByteRange>& payload);
+
+    // Обход элементов MKV/WebM по отображению файла без чтения кластеров:
+    // вложения, двоичные и длинные теги, неизвестные элементы, данные в Void
+    // и после конца сегмента
+    bool performEbmlAnalysis(const std::string& format, const uint8_t* data, size_t size, std::vector<std::string>& reportLines,
+        std::vector<ByteRange>& payload);
+
+    // Теги ID3v2 (APIC, GEOB, PRIV, заполнение) и непрерывность потока кадров
+    // MPEG: данные до первого кадра, в разрывах и после последнего кадра
+    bool performMp3Analysis(const uint8_t* data, size_t size, std::vector<std::string>& reportLines,
+        std::vector<ByteRange>& payload);
+
+    // Чанки RIFF/WAVE (нестандартные, заполнение, данные после RIFF) и χ², RS,
+    // SPA по каналам PCM прямо из чередующихся кадров отображения файла
+    bool performWavAnalysis(const uint8_t* data, size_t size, std::vector<std::string>& reportLines,
+        std::vector<ByteRange>& payload);
+
+    // Поиск вложенных файлов (ZIP, PE, ELF, PDF, 7z, RAR, сценарии) в
+    // участках search; границы найденных файлов добавляются в carved
+    bool performEmbeddedFileAnalysis(const uint8_t* data, size_t size, const std::vector<ByteRange>& search,
+        std::vector<std::string>& reportLines, std::vector<ChildRange>& carved);
+
+    // Отчёт по кривой χ²-атаки: оценка длины сообщения и участки встраивания
+    bool reportChiSquareCurve(const ChiSquareWindowCurve& curve, std::vector<std::string>& reportLines);
+
+    SignatureScanner* scanner_ = nullptr;
 
+    // Файл, открытый analyzeFile, и его отображение: виды, попадающие в
+    // отображение, читаются проходами по байтам из файла
+    const RandomAccessFile* file_ = nullptr;
+    ByteView fileView_;
 };
 
 #endif // STEGANOGRAPHY_CHECKER_H
@@ -0,0 +1,207 @@
+﻿#include "tar_stream.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const size_t kBlockSize = 512;
+const uint64_t kMaxMetaSize = 1024 * 1024;
+const uint64_t kMaxFieldValue = 1ULL << 62;
+
+// Числовое поле: восьмеричное с пробелами и нулями по краям либо, для
+// больших значений GNU, двоичное big-endian со старшим битом первого байта
+bool parseNumber(const uint8_t* field, size_t length, uint64_t& value) {
+    value = 0;
+    if (field[0] & 0x80) {
+        for (size_t i = 1; i < length; ++i) {
+            if (value > (kMaxFieldValue >> 8)) return false;
+            value = (value << 8) | field[i];
+        }
+        return true;
+    }
+    size_t i = 0;
+    while (i < length && field[i] == ' ') i++;
+    bool digits = false;
+    for (; i < length && field[i] >= '0' && field[i] <= '7'; ++i) {
+        value = (value << 3) | uint64_t(field[i] - '0');
+        digits = true;
+    }
+    for (; i < length; ++i) {
+        if (field[i] != ' ' && field[i] != 0) return false;
+    }
+    return digits;
+}
+
+std::string fieldText(const uint8_t* field, size_t length) {
+    const uint8_t* end = std::find(field, field + length, uint8_t(0));
+    return std::string(reinterpret_cast<const char*>(field), static_cast<size_t>(end - field));
+}
+
+// Сумма байтов заголовка с пробелами вместо поля суммы; старые программы
+// считали её по знаковым байтам
+bool checksumMatches(const uint8_t* block) {
+    uint64_t stored = 0;
+    if (!parseNumber(block + 148, 8, stored)) return false;
+    uint64_t unsignedSum = 0;
+    int64_t signedSum = 0;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        uint8_t b = (i >= 148 && i < 156) ? uint8_t(' ') : block[i];
+        unsignedSum += b;
+        signedSum += static_cast<int8_t>(b);
+    }
+    return stored == unsignedSum || static_cast<int64_t>(stored) == signedSum;
+}
+
+bool zeroBlock(const uint8_t* block) {
+    return std::all_of(block, block + kBlockSize, [](uint8_t b) { return b == 0; });
+}
+
+// Записи pax: "<длина> <ключ>=<значение>\n"
+void parsePax(const std::string& records, std::string& path, uint64_t& size, bool& hasSize) {
+    size_t pos = 0;
+    while (pos < records.size()) {
+        size_t space = records.find(' ', pos);
+        if (space == std::string::npos) return;
+        uint64_t length = 0;
+        for (size_t i = pos; i < space; ++i) {
+            if (records[i] < '0' || records[i] > '9' || length > records.size()) return;
+            length = length * 10 + uint64_t(records[i] - '0');
+        }
+        if (length < space - pos + 2 || pos + length > records.size()) return;
+        std::string record = records.substr(space + 1, pos + length - space - 2);
+        size_t eq = record.find('=');
+        if (eq != std::string::npos) {
+            std::string key = record.substr(0, eq);
+            std::string value = record.substr(eq + 1);
+            if (key == "path") {
+                path = value;
+            }
+            else if (key == "size") {
+                uint64_t parsed = 0;
+                bool valid = !value.empty() && value.size() < 19;
+                for (char c : value) {
+                    if (c < '0' || c > '9') valid = false;
+                    else parsed = parsed * 10 + uint64_t(c - '0');
+                }
+                if (valid) {
+                    size = parsed;
+                    hasSize = true;
+                }
+            }
+        }
+        pos += length;
+    }
+}
+
+} // namespace
+
+bool isTarHeader(const uint8_t* block, size_t size) {
+    return size >= kBlockSize && !zeroBlock(block) && checksumMatches(block);
+}
+
+bool TarReader::feed(const uint8_t* data, size_t size) {
+    while (size > 0) {
+        size_t n = 0;
+        switch (state_) {
+        case State::End:
+            return true;
+        case State::Header:
+            n = std::min(size, kBlockSize - headerFill_);
+            std::memcpy(header_ + headerFill_, data, n);
+            headerFill_ += n;
+            if (headerFill_ == kBlockSize) {
+                headerFill_ = 0;
+                if (!processHeader()) return false;
+            }
+            break;
+        case State::Body:
+            n = static_cast<size_t>(std::min<uint64_t>(size, remaining_));
+            if (mode_ == Mode::Deliver) data_(data, n);
+            else if (mode_ == Mode::Collect) meta_.append(reinterpret_cast<const char*>(data), n);
+            remaining_ -= n;
+            if (remaining_ == 0) finishBody();
+            break;
+        case State::Padding:
+            n = static_cast<size_t>(std::min<uint64_t>(size, padding_));
+            padding_ -= n;
+            if (padding_ == 0) state_ = State::Header;
+            break;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool TarReader::processHeader() {
+    if (zeroBlock(header_)) {
+        state_ = State::End;
+        return true;
+    }
+    if (!checksumMatches(header_)) {
+        error_ = "неверная контрольная сумма заголовка";
+        return false;
+    }
+    uint64_t size = 0;
+    if (!parseNumber(header_ + 124, 12, size) || size > kMaxFieldValue) {
+        error_ = "неверный размер записи";
+        return false;
+    }
+
+    TarEntry entry;
+    entry.type = static_cast<char>(header_[156]);
+    entry.name = fieldText(header_, 100);
+    if (std::memcmp(header_ + 257, "ustar", 5) == 0 && header_[345] != 0) {
+        entry.name = fieldText(header_ + 345, 155) + "/" + entry.name;
+    }
+    entry.size = size;
+
+    remaining_ = size;
+    padding_ = (kBlockSize - size % kBlockSize) % kBlockSize;
+    if (entry.type == 'L' || entry.type == 'x') {
+        if (size > kMaxMetaSize) {
+            error_ = "слишком длинный расширенный заголовок";
+            return false;
+        }
+        mode_ = Mode::Collect;
+        metaType_ = entry.type;
+        meta_.clear();
+    }
+    else if (entry.type == 'g' || entry.type == 'K') {
+        mode_ = Mode::Skip;
+    }
+    else {
+        if (!pendingName_.empty()) entry.name = pendingName_;
+        if (hasPendingSize_) {
+            entry.size = pendingSize_;
+            remaining_ = pendingSize_;
+            padding_ = (kBlockSize - pendingSize_ % kBlockSize) % kBlockSize;
+        }
+        pendingName_.clear();
+        hasPendingSize_ = false;
+        entries_++;
+        entry_ = entry;
+        mode_ = start_(entry_) ? Mode::Deliver : Mode::Skip;
+    }
+
+    state_ = State::Body;
+    if (remaining_ == 0) finishBody();
+    return true;
+}
+
+void TarReader::finishBody() {
+    if (mode_ == Mode::Deliver) {
+        end_();
+    }
+    else if (mode_ == Mode::Collect) {
+        if (metaType_ == 'L') {
+            pendingName_ = fieldText(reinterpret_cast<const uint8_t*>(meta_.data()), meta_.size());
+        }
+        else {
+            parsePax(meta_, pendingName_, pendingSize_, hasPendingSize_);
+        }
+        meta_.clear();
+    }
+    mode_ = Mode::Skip;
+    state_ = padding_ > 0 ? State::Padding : State::Header;
+}
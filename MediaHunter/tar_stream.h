@@ -0,0 +1,76 @@
+﻿#ifndef TAR_STREAM_H
+#define TAR_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Запись tar с учётом длинных имён GNU (тип L) и расширенных заголовков pax
+struct TarEntry {
+    std::string name;
+    uint64_t size = 0;
+    char type = '0';
+
+    bool regular() const { return type == '0' || type == '\0' || type == '7'; }
+};
+
+// Потоковый разбор tar (v7, ustar, GNU, pax). Архив подаётся фрагментами
+// произвольной длины в порядке следования, содержимое записей передаётся
+// обработчикам по мере поступления, поэтому архив и записи целиком в
+// памяти не хранятся
+class TarReader {
+public:
+    // Начало записи; false — содержимое записи пропускается
+    using EntryStart = std::function<bool(const TarEntry& entry)>;
+    // Очередная порция содержимого принятой записи
+    using EntryData = std::function<void(const uint8_t* data, size_t size)>;
+    // Содержимое принятой записи передано полностью
+    using EntryEnd = std::function<void()>;
+
+    TarReader(EntryStart start, EntryData data, EntryEnd end)
+        : start_(std::move(start)), data_(std::move(data)), end_(std::move(end)) {}
+
+    // false — повреждённый заголовок, см. error(); после конца архива
+    // (нулевой блок) остальной вход игнорируется
+    bool feed(const uint8_t* data, size_t size);
+
+    bool ended() const { return state_ == State::End; }
+    // Вход закончился посреди записи, принятой обработчиком
+    bool insideEntry() const { return state_ == State::Body && mode_ == Mode::Deliver; }
+    const TarEntry& current() const { return entry_; }
+    uint64_t entryCount() const { return entries_; }
+    const std::string& error() const { return error_; }
+
+private:
+    enum class State { Header, Body, Padding, End };
+    enum class Mode { Deliver, Collect, Skip };
+
+    bool processHeader();
+    void finishBody();
+
+    EntryStart start_;
+    EntryData data_;
+    EntryEnd end_;
+
+    State state_ = State::Header;
+    Mode mode_ = Mode::Skip;
+    uint8_t header_[512] = {};
+    size_t headerFill_ = 0;
+    uint64_t remaining_ = 0;
+    uint64_t padding_ = 0;
+
+    TarEntry entry_;
+    std::string meta_;                // содержимое записей L и x
+    char metaType_ = 0;
+    std::string pendingName_;         // имя для следующей записи из L или pax
+    uint64_t pendingSize_ = 0;        // размер из pax (для записей больше 8 ГБ)
+    bool hasPendingSize_ = false;
+    uint64_t entries_ = 0;
+    std::string error_;
+};
+
+// Блок 512 байт — заголовок tar с верной контрольной суммой
+bool isTarHeader(const uint8_t* block, size_t size);
+
+#endif // TAR_STREAM_H
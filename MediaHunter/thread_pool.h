@@ -0,0 +1,44 @@
+﻿#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Общий пул рабочих потоков для параллельных этапов анализа
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t workerCount = 0);  // 0 — по числу ядер минус один
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Пул, разделяемый всеми модулями
+    static ThreadPool& shared();
+
+    // Степень параллелизма с учётом вызывающего потока
+    size_t concurrency() const { return workers_.size() + 1; }
+
+    void submit(std::function<void()> task);
+
+    // Выполняет fn(i) для i из [0, count). Вызывающий поток сам забирает
+    // задания, поэтому вложенные вызовы из рабочих потоков не блокируют пул.
+    // Первое исключение из fn пробрасывается вызывающему.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,269 @@
+﻿#include "tiff_structure.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+
+// Теги со ссылками на данные и вложенные каталоги
+enum : uint16_t {
+    kTagMake = 271,
+    kTagStripOffsets = 273,
+    kTagStripByteCounts = 279,
+    kTagTileOffsets = 324,
+    kTagTileByteCounts = 325,
+    kTagSubIfds = 330,
+    kTagJpegOffset = 513,
+    kTagJpegLength = 514,
+    kTagExifIfd = 34665,
+    kTagGpsIfd = 34853,
+    kTagInteropIfd = 40965,
+    kTagDngVersion = 50706
+};
+
+// Ограничение на число каталогов: защита от файлов с тысячами циклических ссылок
+const size_t kMaxIfds = 4096;
+
+// Размер элемента по типу поля; 0 — неизвестный тип
+size_t typeSize(uint16_t type) {
+    switch (type) {
+    case 1: case 2: case 6: case 7: return 1;
+    case 3: case 8: return 2;
+    case 4: case 9: case 11: case 13: return 4;
+    case 5: case 10: case 12: case 16: case 17: case 18: return 8;
+    default: return 0;
+    }
+}
+
+class TiffReader {
+public:
+    TiffReader(const uint8_t* data, size_t size, bool bigEndian)
+        : data_(data), size_(size), bigEndian_(bigEndian) {}
+
+    // Чтение без проверки границ: вызывающий проверяет fits()
+    uint64_t read(size_t pos, size_t bytes) const {
+        uint64_t v = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            uint64_t b = data_[pos + i];
+            v |= bigEndian_ ? b << (8 * (bytes - 1 - i)) : b << (8 * i);
+        }
+        return v;
+    }
+
+    bool fits(uint64_t offset, uint64_t length) const {
+        return offset <= size_ && length <= size_ - offset;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    bool bigEndian_;
+};
+
+// Поле каталога: значения лежат либо в самой записи, либо по смещению
+struct TiffField {
+    uint16_t tag = 0;
+    uint16_t type = 0;
+    uint64_t count = 0;
+    uint64_t valuePos = 0;      // позиция первого значения в файле
+    bool valid = false;         // значения целиком внутри файла
+};
+
+class TiffWalker {
+public:
+    TiffWalker(const uint8_t* data, size_t size, TiffStructure& tiff)
+        : data_(data), size_(size), reader_(data, size, tiff.bigEndian), tiff_(tiff) {}
+
+    // Каталог и всё, что достижимо из него; уже разобранный корень пропускается
+    void walk(uint64_t root) {
+        if (root == 0 || visited_.count(root)) return;
+        enqueue(root);
+        while (!pending_.empty()) {
+            uint64_t offset = pending_.back();
+            pending_.pop_back();
+            parseIfd(offset);
+        }
+    }
+
+private:
+    // Каждый каталог ставится в очередь один раз, и всего не больше
+    // kMaxIfds: иначе поле SubIFDs с тысячами одинаковых смещений в каждом
+    // каталоге раздувает очередь
+    void enqueue(uint64_t offset) {
+        if (offset == 0) return;
+        if (visited_.count(offset)) {
+            tiff_.repeatedIfds++;
+            return;
+        }
+        if (visited_.size() >= kMaxIfds) {
+            tiff_.ifdLimit = true;
+            return;
+        }
+        visited_.insert(offset);
+        pending_.push_back(offset);
+    }
+
+    void reference(uint64_t offset, uint64_t length) {
+        if (length == 0) return;
+        if (!reader_.fits(offset, length)) {
+            tiff_.badReferences++;
+            return;
+        }
+        tiff_.referenced.push_back({ offset, length });
+    }
+
+    // Числовые значения поля (SHORT, LONG, LONG8, IFD)
+    std::vector<uint64_t> values(const TiffField& field, uint64_t limit = UINT64_MAX) const {
+        std::vector<uint64_t> out;
+        size_t width = typeSize(field.type);
+        if (!field.valid || (width != 2 && width != 4 && width != 8) || field.type == 5 || field.type == 10 ||
+            field.type == 12) {
+            return out;
+        }
+        const uint64_t count = std::min(field.count, limit);
+        out.reserve(static_cast<size_t>(count));
+        for (uint64_t i = 0; i < count; ++i) {
+            out.push_back(reader_.read(static_cast<size_t>(field.valuePos + i * width), width));
+        }
+        return out;
+    }
+
+    // Пары «смещение — длина» для полос, тайлов и встроенного JPEG
+    void referencePairs(const TiffField* offsets, const TiffField* lengths) {
+        if (!offsets || !lengths) return;
+        std::vector<uint64_t> starts = values(*offsets);
+        std::vector<uint64_t> sizes = values(*lengths);
+        size_t n = starts.size() < sizes.size() ? starts.size() : sizes.size();
+        for (size_t i = 0; i < n; ++i) {
+            reference(starts[i], sizes[i]);
+            tiff_.dataBlocks++;
+        }
+    }
+
+    void parseIfd(uint64_t offset) {
+        const size_t countSize = tiff_.bigTiff ? 8 : 2;
+        const size_t entrySize = tiff_.bigTiff ? 20 : 12;
+        const size_t inlineSize = tiff_.bigTiff ? 8 : 4;
+
+        if (!reader_.fits(offset, countSize)) {
+            tiff_.badReferences++;
+            return;
+        }
+        uint64_t count = reader_.read(static_cast<size_t>(offset), countSize);
+        uint64_t tableSize = countSize + count * entrySize + inlineSize;
+        if (count > 0xFFFF || !reader_.fits(offset, tableSize)) {
+            tiff_.badReferences++;
+            return;
+        }
+        tiff_.ifds++;
+        tiff_.entries += static_cast<size_t>(count);
+        tiff_.referenced.push_back({ offset, tableSize });
+
+        TiffField stripOffsets, stripCounts, tileOffsets, tileCounts, jpegOffset, jpegLength;
+        bool hasStrips = false, hasStripCounts = false, hasTiles = false, hasTileCounts = false;
+        bool hasJpeg = false, hasJpegLength = false;
+
+        size_t pos = static_cast<size_t>(offset + countSize);
+        for (uint64_t i = 0; i < count; ++i, pos += entrySize) {
+            TiffField field;
+            field.tag = static_cast<uint16_t>(reader_.read(pos, 2));
+            field.type = static_cast<uint16_t>(reader_.read(pos + 2, 2));
+            field.count = reader_.read(pos + 4, tiff_.bigTiff ? 8 : 4);
+            size_t valueField = pos + (tiff_.bigTiff ? 12 : 8);
+
+            size_t width = typeSize(field.type);
+            if (width == 0 || field.count > size_ / width) {
+                continue;
+            }
+            uint64_t bytes = field.count * width;
+            if (bytes <= inlineSize) {
+                field.valuePos = valueField;
+                field.valid = true;
+            }
+            else {
+                field.valuePos = reader_.read(valueField, inlineSize);
+                field.valid = reader_.fits(field.valuePos, bytes);
+                reference(field.valuePos, bytes);
+            }
+            if (!field.valid) continue;
+
+            switch (field.tag) {
+            case kTagMake: {
+                const char* text = reinterpret_cast<const char*>(data_ + field.valuePos);
+                tiff_.make.assign(text, std::find(text, text + field.count, '\0'));
+                break;
+            }
+            case kTagDngVersion: tiff_.dng = true; break;
+            case kTagStripOffsets: stripOffsets = field; hasStrips = true; break;
+            case kTagStripByteCounts: stripCounts = field; hasStripCounts = true; break;
+            case kTagTileOffsets: tileOffsets = field; hasTiles = true; break;
+            case kTagTileByteCounts: tileCounts = field; hasTileCounts = true; break;
+            case kTagJpegOffset: jpegOffset = field; hasJpeg = true; break;
+            case kTagJpegLength: jpegLength = field; hasJpegLength = true; break;
+            case kTagSubIfds:
+            case kTagExifIfd:
+            case kTagGpsIfd:
+            case kTagInteropIfd:
+                for (uint64_t child : values(field, kMaxIfds)) {
+                    if (tiff_.ifdLimit) break;
+                    enqueue(child);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        referencePairs(hasStrips ? &stripOffsets : nullptr, hasStripCounts ? &stripCounts : nullptr);
+        referencePairs(hasTiles ? &tileOffsets : nullptr, hasTileCounts ? &tileCounts : nullptr);
+        referencePairs(hasJpeg ? &jpegOffset : nullptr, hasJpegLength ? &jpegLength : nullptr);
+
+        // Следующий каталог цепочки
+        enqueue(reader_.read(pos, inlineSize));
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    TiffReader reader_;
+    TiffStructure& tiff_;
+    std::vector<uint64_t> pending_;
+    std::unordered_set<uint64_t> visited_;
+};
+
+} // namespace
+
+bool parseTiffStructure(const uint8_t* data, size_t size, TiffStructure& tiff) {
+    tiff = TiffStructure();
+    if (size < 8) return false;
+    if (data[0] == 'I' && data[1] == 'I') tiff.bigEndian = false;
+    else if (data[0] == 'M' && data[1] == 'M') tiff.bigEndian = true;
+    else return false;
+
+    TiffReader reader(data, size, tiff.bigEndian);
+    uint64_t version = reader.read(2, 2);
+    uint64_t firstIfd = 0;
+    size_t headerSize = 8;
+    if (version == 42) {
+        firstIfd = reader.read(4, 4);
+        // CR2: после смещения IFD0 — "CR", версия и смещение RAW-каталога
+        if (size >= 16 && data[8] == 'C' && data[9] == 'R') {
+            tiff.canonRaw = true;
+            headerSize = 16;
+        }
+    }
+    else if (version == 43) {
+        // BigTIFF: размер смещений (8), резерв, 64-битное смещение IFD0
+        if (size < 16 || reader.read(4, 2) != 8) return false;
+        tiff.bigTiff = true;
+        firstIfd = reader.read(8, 8);
+        headerSize = 16;
+    }
+    else {
+        return false;
+    }
+    tiff.referenced.push_back({ 0, headerSize });
+
+    TiffWalker walker(data, size, tiff);
+    walker.walk(firstIfd);
+    if (tiff.canonRaw) walker.walk(reader.read(12, 4));
+    return true;
+}
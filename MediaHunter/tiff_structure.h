@@ -0,0 +1,31 @@
+﻿#ifndef TIFF_STRUCTURE_H
+#define TIFF_STRUCTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "byte_ranges.h"
+
+// Структура TIFF и производных форматов (DNG, CR2, NEF): все байты, на
+// которые ссылаются заголовок и каталоги, собраны в referenced
+struct TiffStructure {
+    bool bigEndian = false;             // MM
+    bool bigTiff = false;               // 64-битные смещения (версия 43)
+    bool canonRaw = false;              // заголовок CR2 ("CR" после смещения IFD0)
+    bool dng = false;                   // есть тег DNGVersion
+    std::string make;                   // тег Make
+    size_t ifds = 0;                    // разобрано каталогов, включая SubIFD, EXIF, GPS
+    size_t entries = 0;
+    size_t dataBlocks = 0;              // полосы, тайлы и встроенные JPEG
+    size_t badReferences = 0;           // смещения за пределами файла
+    size_t repeatedIfds = 0;            // ссылки на уже разобранный каталог (циклы)
+    bool ifdLimit = false;              // ссылок на разные каталоги больше предела, лишние не разбираются
+    std::vector<ByteRange> referenced;  // заголовок, каталоги, значения тегов, данные изображений
+};
+
+// Обход цепочки IFD и вложенных каталогов (SubIFDs, EXIF, GPS, Interoperability)
+// в обоих порядках байтов, включая BigTIFF. false — нет заголовка TIFF
+bool parseTiffStructure(const uint8_t* data, size_t size, TiffStructure& tiff);
+
+#endif // TIFF_STRUCTURE_H
@@ -0,0 +1,361 @@
+﻿#include "vp8l_bitstream.h"
+#include "huffman_code.h"
+#include <vector>
+
+namespace {
+
+const int kCodeLengthCodes = 19;
+const uint8_t kCodeLengthOrder[kCodeLengthCodes] = {
+    17, 18, 0, 1, 2, 3, 4, 5, 16, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+const int kLiteralCodes = 256;
+const int kLengthCodes = 24;
+const int kDistanceCodes = 40;
+
+// Подызображения больше этого объёма не декодируются: разбор остаётся
+// быстрым и на специально раздутых файлах
+const uint64_t kMaxSubImagePixels = 4u * 1024 * 1024;
+
+// Смещения (dy << 4) | (8 - dx) для кодов расстояний 1–120
+const uint8_t kCodeToPlane[120] = {
+    0x18, 0x07, 0x17, 0x19, 0x28, 0x06, 0x27, 0x29, 0x16, 0x1a,
+    0x26, 0x2a, 0x38, 0x05, 0x37, 0x39, 0x15, 0x1b, 0x36, 0x3a,
+    0x25, 0x2b, 0x48, 0x04, 0x47, 0x49, 0x14, 0x1c, 0x35, 0x3b,
+    0x46, 0x4a, 0x24, 0x2c, 0x58, 0x45, 0x4b, 0x34, 0x3c, 0x03,
+    0x57, 0x59, 0x13, 0x1d, 0x56, 0x5a, 0x23, 0x2d, 0x44, 0x4c,
+    0x55, 0x5b, 0x33, 0x3d, 0x68, 0x02, 0x67, 0x69, 0x12, 0x1e,
+    0x66, 0x6a, 0x22, 0x2e, 0x54, 0x5c, 0x43, 0x4d, 0x65, 0x6b,
+    0x32, 0x3e, 0x78, 0x01, 0x77, 0x79, 0x53, 0x5d, 0x11, 0x1f,
+    0x64, 0x6c, 0x42, 0x4e, 0x76, 0x7a, 0x21, 0x2f, 0x75, 0x7b,
+    0x31, 0x3f, 0x63, 0x6d, 0x52, 0x5e, 0x00, 0x74, 0x7c, 0x41,
+    0x4f, 0x10, 0x20, 0x62, 0x6e, 0x30, 0x73, 0x7d, 0x51, 0x5f,
+    0x40, 0x72, 0x7e, 0x61, 0x6f, 0x50, 0x71, 0x7f, 0x60, 0x70 };
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    uint32_t read(int n) {
+        uint32_t v = peek(n);
+        skip(n);
+        return v;
+    }
+
+    uint32_t peek(int n) {
+        while (count_ < n) {
+            uint64_t byte = pos_ < size_ ? data_[pos_] : 0;
+            pos_++;
+            bits_ |= byte << count_;
+            count_ += 8;
+        }
+        return static_cast<uint32_t>(bits_ & ((uint64_t(1) << n) - 1));
+    }
+
+    void skip(int n) {
+        bits_ >>= n;
+        count_ -= n;
+    }
+
+    // Прочитано больше битов, чем есть в данных: поток обрезан
+    bool overrun() const { return pos_ - static_cast<size_t>(count_ / 8) > size_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    uint64_t bits_ = 0;
+    int count_ = 0;
+};
+
+// Префиксный код VP8L: код из одного символа занимает ноль битов
+struct PrefixCode {
+    CanonicalHuffman table;
+    bool single = false;
+    uint16_t symbol = 0;
+
+    bool decode(BitReader& br, uint16_t& out) const {
+        if (single) {
+            out = symbol;
+            return true;
+        }
+        HuffmanSymbol s = table.decode(br.peek(table.maxLength()));
+        if (s.length == 0) return false;
+        br.skip(s.length);
+        out = s.symbol;
+        return true;
+    }
+};
+
+class Vp8lParser {
+public:
+    Vp8lParser(BitReader& br, Vp8lInfo& info) : br_(br), info_(info) {}
+
+    bool parseMain() {
+        while (br_.read(1)) {
+            if (++info_.transforms > 4) return fail("повторное преобразование");
+            if (!parseTransform()) return false;
+        }
+        return parseImageCodes(width_, info_.height, true);
+    }
+
+    uint32_t width_ = 0;
+
+private:
+    bool fail(const char* message) {
+        if (info_.error.empty()) info_.error = message;
+        return false;
+    }
+
+    // Обрыв потока не считается ошибкой кода: биты за концом данных
+    // читаются нулями и дают неполные коды
+    bool truncated() {
+        info_.truncated = true;
+        return fail("поток обрывается");
+    }
+
+    static uint32_t subSampled(uint32_t size, int bits) {
+        return (size + (1u << bits) - 1) >> bits;
+    }
+
+    bool parseTransform() {
+        uint32_t type = br_.read(2);
+        if (seen_ & (1u << type)) return fail("преобразование повторяется");
+        seen_ |= 1u << type;
+        switch (type) {
+        case 0:     // предсказание
+        case 1: {   // цветовое преобразование
+            int bits = static_cast<int>(br_.read(3)) + 2;
+            return decodeSubImage(subSampled(width_, bits), subSampled(info_.height, bits));
+        }
+        case 2:     // вычитание зелёного
+            return true;
+        default: {  // индексация цветов: палитра и упаковка пикселей
+            uint32_t colors = br_.read(8) + 1;
+            if (!decodeSubImage(colors, 1)) return false;
+            int bits = colors > 16 ? 0 : colors > 4 ? 1 : colors > 2 ? 2 : 3;
+            width_ = subSampled(width_, bits);
+            return true;
+        }
+        }
+    }
+
+    // Кэш цветов, коды и (для основного изображения) карта энтропии
+    bool parseImageCodes(uint32_t width, uint32_t height, bool level0) {
+        int cacheBits = 0;
+        if (br_.read(1)) {
+            cacheBits = static_cast<int>(br_.read(4));
+            if (cacheBits < 1 || cacheBits > 11) return fail("недопустимый размер кэша цветов");
+        }
+        size_t groups = 1;
+        if (level0) {
+            info_.colorCacheBits = cacheBits;
+            if (br_.read(1)) {
+                int bits = static_cast<int>(br_.read(3)) + 2;
+                uint32_t w = subSampled(width, bits), h = subSampled(height, bits);
+                std::vector<uint32_t> metaCodes;
+                if (!decodeSubImage(w, h, &metaCodes)) return false;
+                uint32_t maxCode = 0;
+                for (uint32_t code : metaCodes) maxCode = code > maxCode ? code : maxCode;
+                groups = size_t(maxCode) + 1;
+            }
+            info_.huffmanGroups = groups;
+        }
+
+        // Коды основного изображения только проверяются и строятся по одному
+        // в общей таблице: групп может быть до 65536, а простой код в пару
+        // десятков бит занимает таблицу в сотни записей. Подызображению коды
+        // нужны для декодирования, группа у него одна
+        PrefixCode scratch;
+        for (size_t g = 0; g < groups; ++g) {
+            static const int sizes[5] = { kLiteralCodes + kLengthCodes, kLiteralCodes, kLiteralCodes,
+                kLiteralCodes, kDistanceCodes };
+            for (int i = 0; i < 5; ++i) {
+                int alphabet = sizes[i] + (i == 0 && cacheBits ? (1 << cacheBits) : 0);
+                PrefixCode& code = level0 ? scratch : codes_[i];
+                code.single = false;
+                if (!readCode(alphabet, code)) return false;
+            }
+        }
+        cacheBits_ = cacheBits;
+        if (level0) info_.complete = true;
+        return true;
+    }
+
+    // Код корректен, если он полный или состоит из одного символа
+    bool buildCode(const std::vector<uint8_t>& lengths, PrefixCode& code) {
+        info_.codes++;
+        size_t used = 0;
+        uint16_t last = 0;
+        for (size_t s = 0; s < lengths.size(); ++s) {
+            if (lengths[s]) {
+                used++;
+                last = static_cast<uint16_t>(s);
+            }
+        }
+        if (used == 1) {
+            code.single = true;
+            code.symbol = last;
+            return true;
+        }
+        if (!code.table.build(lengths.data(), lengths.size()) || !code.table.complete()) {
+            info_.invalidCodes++;
+            return fail("неполный или переполненный префиксный код");
+        }
+        return true;
+    }
+
+    bool readCode(int alphabet, PrefixCode& code) {
+        std::vector<uint8_t> lengths(static_cast<size_t>(alphabet), 0);
+        if (br_.read(1)) {
+            // Простой код: один или два символа
+            int symbols = static_cast<int>(br_.read(1)) + 1;
+            int firstBits = br_.read(1) ? 8 : 1;
+            uint32_t s0 = br_.read(firstBits);
+            uint32_t s1 = symbols == 2 ? br_.read(8) : 0;
+            if (br_.overrun()) return truncated();
+            if (s0 >= lengths.size() || (symbols == 2 && s1 >= lengths.size())) {
+                info_.invalidCodes++;
+                return fail("символ простого кода вне алфавита");
+            }
+            info_.codes++;
+            if (symbols == 1 || s0 == s1) {
+                code.single = true;
+                code.symbol = static_cast<uint16_t>(s0);
+                return true;
+            }
+            lengths[s0] = 1;
+            lengths[s1] = 1;
+            return code.table.build(lengths.data(), lengths.size());
+        }
+
+        // Код длин кодов, затем длины символов с повторами 16–18
+        uint8_t codeLengthLengths[kCodeLengthCodes] = {};
+        int count = static_cast<int>(br_.read(4)) + 4;
+        for (int i = 0; i < count; ++i) codeLengthLengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(br_.read(3));
+        if (br_.overrun()) return truncated();
+        PrefixCode lengthCode;
+        if (!buildCode(std::vector<uint8_t>(codeLengthLengths, codeLengthLengths + kCodeLengthCodes), lengthCode)) {
+            return false;
+        }
+
+        int maxSymbol = alphabet;
+        if (br_.read(1)) {
+            int bits = 2 + 2 * static_cast<int>(br_.read(3));
+            maxSymbol = 2 + static_cast<int>(br_.read(bits));
+            if (maxSymbol > alphabet) return fail("длина кода больше алфавита");
+        }
+
+        int symbol = 0;
+        uint8_t previous = 8;
+        while (symbol < alphabet && maxSymbol-- > 0) {
+            uint16_t value;
+            if (!lengthCode.decode(br_, value)) return br_.overrun() ? truncated() : fail("повреждён код длин");
+            if (value < 16) {
+                lengths[symbol++] = static_cast<uint8_t>(value);
+                if (value) previous = static_cast<uint8_t>(value);
+                continue;
+            }
+            static const int extraBits[3] = { 2, 3, 7 };
+            static const int offsets[3] = { 3, 3, 11 };
+            int repeat = static_cast<int>(br_.read(extraBits[value - 16])) + offsets[value - 16];
+            if (symbol + repeat > alphabet) return fail("повтор длин выходит за алфавит");
+            uint8_t fill = value == 16 ? previous : 0;
+            for (int i = 0; i < repeat; ++i) lengths[symbol++] = fill;
+        }
+        if (br_.overrun()) return truncated();
+        return buildCode(lengths, code);
+    }
+
+    uint32_t readPrefixValue(uint16_t prefix) {
+        if (prefix < 4) return prefix + 1;
+        int extra = (prefix - 2) >> 1;
+        uint32_t offset = (2u + (prefix & 1)) << extra;
+        return offset + br_.read(extra) + 1;
+    }
+
+    // Подызображение с единственной группой кодов декодируется полностью:
+    // без этого нельзя найти конец его данных. Значения пикселей нужны
+    // только карте энтропии (номер группы — красный и зелёный каналы)
+    bool decodeSubImage(uint32_t width, uint32_t height, std::vector<uint32_t>* groups = nullptr) {
+        uint64_t total = uint64_t(width) * height;
+        if (total > kMaxSubImagePixels) return fail("подызображение слишком велико");
+        if (!parseImageCodes(width, height, false)) return false;
+        const PrefixCode* codes = codes_;
+        const int cacheBits = cacheBits_;
+        std::vector<uint32_t> cache(cacheBits ? size_t(1) << cacheBits : 0, 0);
+        std::vector<uint32_t> pixels;
+        pixels.reserve(static_cast<size_t>(total));
+
+        size_t cached = 0;
+        while (pixels.size() < total) {
+            uint16_t green;
+            if (!codes[0].decode(br_, green)) return fail("повреждён код подызображения");
+            if (green < kLiteralCodes) {
+                uint16_t red, blue, alpha;
+                if (!codes[1].decode(br_, red) || !codes[2].decode(br_, blue) || !codes[3].decode(br_, alpha)) {
+                    return fail("повреждён код подызображения");
+                }
+                pixels.push_back((uint32_t(alpha) << 24) | (uint32_t(red) << 16) | (uint32_t(green) << 8) | blue);
+            }
+            else if (green < kLiteralCodes + kLengthCodes) {
+                uint32_t length = readPrefixValue(green - kLiteralCodes);
+                uint16_t distanceSymbol;
+                if (!codes[4].decode(br_, distanceSymbol)) return fail("повреждён код расстояния");
+                uint64_t distance = planeDistance(readPrefixValue(distanceSymbol), width);
+                if (distance > pixels.size() || length > total - pixels.size()) {
+                    return fail("копирование за пределы подызображения");
+                }
+                for (uint32_t i = 0; i < length; ++i) pixels.push_back(pixels[pixels.size() - distance]);
+            }
+            else {
+                uint32_t index = green - kLiteralCodes - kLengthCodes;
+                if (index >= cache.size()) return fail("индекс кэша цветов вне диапазона");
+                pixels.push_back(cache[index]);
+            }
+            // В кэш попадает каждый декодированный пиксель
+            for (; cacheBits && cached < pixels.size(); ++cached) {
+                cache[(0x1E35A7BDu * pixels[cached]) >> (32 - cacheBits)] = pixels[cached];
+            }
+            if (br_.overrun()) return truncated();
+        }
+
+        if (groups) {
+            groups->reserve(pixels.size());
+            for (uint32_t argb : pixels) groups->push_back((argb >> 8) & 0xFFFF);
+        }
+        return true;
+    }
+
+    // Короткие коды расстояний задают смещение по строкам и столбцам
+    static uint64_t planeDistance(uint32_t code, uint32_t width) {
+        if (code > 120) return code - 120;
+        uint8_t plane = kCodeToPlane[code - 1];
+        int64_t distance = int64_t(plane >> 4) * width + 8 - (plane & 0xF);
+        return distance >= 1 ? static_cast<uint64_t>(distance) : 1;
+    }
+
+    BitReader& br_;
+    Vp8lInfo& info_;
+    uint32_t seen_ = 0;
+    int cacheBits_ = 0;
+    PrefixCode codes_[5];     // коды последнего подызображения
+};
+
+} // namespace
+
+bool parseVp8lBitstream(const uint8_t* data, size_t size, Vp8lInfo& info) {
+    info = Vp8lInfo();
+    if (size < 5 || data[0] != 0x2F) return false;
+    BitReader br(data + 1, size - 1);
+    info.width = br.read(14) + 1;
+    info.height = br.read(14) + 1;
+    info.alpha = br.read(1) != 0;
+    info.version = br.read(3);
+    if (info.version != 0) {
+        info.error = "неизвестная версия VP8L";
+        return true;
+    }
+    Vp8lParser parser(br, info);
+    parser.width_ = info.width;
+    parser.parseMain();
+    return true;
+}
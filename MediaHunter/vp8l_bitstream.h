@@ -0,0 +1,30 @@
+﻿#ifndef VP8L_BITSTREAM_H
+#define VP8L_BITSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Заголовок и префиксные коды потока VP8L (WebP без потерь). Подызображения
+// преобразований и карты энтропии декодируются только для того, чтобы дойти
+// до кодов основного изображения; пиксели основного изображения не читаются
+struct Vp8lInfo {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool alpha = false;
+    uint32_t version = 0;
+    int transforms = 0;
+    int colorCacheBits = 0;
+    size_t huffmanGroups = 0;     // групп из пяти кодов у основного изображения
+    size_t codes = 0;             // прочитано префиксных кодов всего
+    size_t invalidCodes = 0;      // неполные или переполненные коды (признак CVE-2023-4863)
+    bool complete = false;        // все коды основного изображения прочитаны
+    bool truncated = false;       // данные кончились раньше кодов
+    std::string error;            // причина остановки разбора
+};
+
+// false — нет сигнатуры 0x2F или повреждён заголовок. Ошибка в кодах не
+// делает результат false: разбор останавливается, причина — в info.error
+bool parseVp8lBitstream(const uint8_t* data, size_t size, Vp8lInfo& info);
+
+#endif // VP8L_BITSTREAM_H
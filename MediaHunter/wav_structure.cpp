@@ -0,0 +1,90 @@
+﻿#include "wav_structure.h"
+#include "fourcc.h"
+
+namespace {
+
+inline uint16_t readLE16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t readLE32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+// WAVE_FORMAT_EXTENSIBLE: cbSize (2), validBits (2), channelMask (4), затем
+// GUID подформата, первые два байта которого — тег формата
+void parseFormat(const uint8_t* p, uint32_t size, WavFormat& format) {
+    format.formatTag = readLE16(p);
+    format.channels = readLE16(p + 2);
+    format.sampleRate = readLE32(p + 4);
+    format.blockAlign = readLE16(p + 12);
+    format.bitsPerSample = readLE16(p + 14);
+    if (format.formatTag == 0xFFFE) {
+        format.extensible = true;
+        format.formatTag = size >= 26 ? readLE16(p + 24) : 0;
+    }
+}
+
+} // namespace
+
+bool parseWavStructure(const uint8_t* data, size_t size, WavStructure& wav) {
+    wav = WavStructure();
+    if (size < 12 || readFourCC(data) != fourCC("RIFF") || readFourCC(data + 8) != fourCC("WAVE")) return false;
+    wav.riffSize = readLE32(data + 4);
+    wav.riffEnd = 8 + uint64_t(wav.riffSize);
+
+    // Размер RIFF, не записанный пишущей программой, заменяется размером файла
+    wav.riffSizeUnset = wav.riffSize == 0 || wav.riffSize == 0xFFFFFFFF;
+    const uint64_t end = (!wav.riffSizeUnset && wav.riffEnd < size) ? wav.riffEnd : size;
+    uint64_t pos = 12;
+    wav.chunksEnd = pos;
+    while (pos < end && end - pos >= 8) {
+        WavChunk chunk;
+        chunk.fourcc = readFourCC(data + pos);
+        chunk.offset = pos;
+        chunk.size = readLE32(data + pos + 4);
+        const bool isData = chunk.fourcc == fourCC("data");
+
+        if (isData && wav.dataChunks++ == 0) {
+            uint64_t available = end - chunk.payload();
+            uint64_t length = chunk.size;
+            if (chunk.size == 0xFFFFFFFF || (chunk.size == 0 && wav.riffSizeUnset)) {
+                wav.streamingSize = available > 0;
+                if (wav.streamingSize) length = available;
+            }
+            if (length > available) {
+                // За пределы RIFF внутри файла — нарушение структуры, за конец файла — обрезка
+                if (end < size) {
+                    wav.overflow = true;
+                    wav.overflowChunk = chunk;
+                }
+                else {
+                    wav.truncated = true;
+                }
+                length = available;
+            }
+            wav.samples = { chunk.payload(), length };
+            if (wav.streamingSize || length < chunk.size) {
+                chunk.size = length;
+                wav.chunks.push_back(chunk);
+                wav.chunksEnd = chunk.payload() + length;
+                break;
+            }
+        }
+        else if (chunk.size > end - chunk.payload()) {
+            wav.overflow = true;
+            wav.overflowChunk = chunk;
+            break;
+        }
+        else if (chunk.fourcc == fourCC("fmt ") && !wav.hasFormat && chunk.size >= 16) {
+            wav.hasFormat = true;
+            parseFormat(data + chunk.payload(), static_cast<uint32_t>(chunk.size), wav.format);
+        }
+
+        wav.chunks.push_back(chunk);
+        // Байт выравнивания последнего чанка может отсутствовать
+        pos = chunk.end() < end ? chunk.end() : end;
+        wav.chunksEnd = pos;
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+﻿#ifndef WAV_STRUCTURE_H
+#define WAV_STRUCTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "byte_ranges.h"
+
+// Чанк RIFF: заголовок 8 байт, данные и байт выравнивания при нечётном размере
+struct WavChunk {
+    uint32_t fourcc = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;      // у data потоковой записи или RF64 может быть больше 4 ГБ
+
+    uint64_t payload() const { return offset + 8; }
+    uint64_t end() const { return offset + 8 + size + (size & 1); }
+};
+
+// Чанк fmt: WAVE_FORMAT_PCM (1), IEEE float (3) или WAVE_FORMAT_EXTENSIBLE
+// (0xFFFE), у которого тип определяется подформатом
+struct WavFormat {
+    uint16_t formatTag = 0;       // для EXTENSIBLE — тег подформата
+    uint16_t channels = 0;
+    uint32_t sampleRate = 0;
+    uint16_t blockAlign = 0;      // байт в кадре (все каналы одного момента)
+    uint16_t bitsPerSample = 0;
+    bool extensible = false;
+
+    bool pcm() const { return formatTag == 1; }
+    uint16_t bytesPerSample() const { return static_cast<uint16_t>((bitsPerSample + 7) / 8); }
+};
+
+struct WavStructure {
+    uint32_t riffSize = 0;
+    uint64_t riffEnd = 0;                 // 8 + размер RIFF; может превышать размер файла
+    bool riffSizeUnset = false;           // размер RIFF 0 или 0xFFFFFFFF (запись не завершена)
+    std::vector<WavChunk> chunks;         // чанки верхнего уровня
+    uint64_t chunksEnd = 0;               // конец последнего целого чанка
+    bool overflow = false;                // чанк (кроме data в конце файла) выходит за пределы RIFF
+    WavChunk overflowChunk;
+
+    bool hasFormat = false;
+    WavFormat format;
+    size_t dataChunks = 0;
+    ByteRange samples;                    // данные первого чанка data в пределах файла
+    bool truncated = false;               // чанк data обрывается концом файла
+    bool streamingSize = false;           // размер data не записан (0xFFFFFFFF или 0 при незаписанном RIFF)
+};
+
+// Обход чанков RIFF/WAVE и разбор fmt. Чанк data программ, не записавших
+// размер, и обрезанный data продолжаются до конца RIFF или файла.
+// false — нет заголовка RIFF/WAVE
+bool parseWavStructure(const uint8_t* data, size_t size, WavStructure& wav);
+
+#endif // WAV_STRUCTURE_H
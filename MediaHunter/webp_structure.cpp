@@ -0,0 +1,125 @@
+﻿#include "webp_structure.h"
+#include "fourcc.h"
+
+namespace {
+
+inline uint32_t readLE24(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16);
+}
+
+inline uint32_t readLE32(const uint8_t* p) {
+    return readLE24(p) | (uint32_t(p[3]) << 24);
+}
+
+// Заголовок ключевого кадра VP8 (RFC 6386, 9.1): тег кадра, стартовый код, размеры
+void parseVp8Header(const uint8_t* data, size_t size, WebpImage& image) {
+    if (size < 10) {
+        image.error = "слишком короткий поток VP8";
+        return;
+    }
+    uint32_t tag = readLE24(data);
+    bool keyFrame = (tag & 1) == 0;
+    uint32_t version = (tag >> 1) & 7;
+    uint32_t firstPartition = tag >> 5;
+    if (!keyFrame) image.error = "первый кадр VP8 не ключевой";
+    else if (version > 3) image.error = "неизвестная версия VP8";
+    else if (data[3] != 0x9D || data[4] != 0x01 || data[5] != 0x2A) image.error = "нет стартового кода VP8";
+    else if (firstPartition > size - 10) image.error = "первый раздел VP8 выходит за пределы чанка";
+    image.width = (data[6] | (data[7] << 8)) & 0x3FFF;
+    image.height = (data[8] | (data[9] << 8)) & 0x3FFF;
+}
+
+void parseImageChunk(const uint8_t* data, const WebpChunk& chunk, WebpImage& image) {
+    image.offset = chunk.offset;
+    image.lossless = chunk.fourcc == fourCC("VP8L");
+    const uint8_t* payload = data + chunk.payload();
+    if (!image.lossless) {
+        parseVp8Header(payload, chunk.size, image);
+        return;
+    }
+    if (!parseVp8lBitstream(payload, chunk.size, image.vp8l)) {
+        image.error = "нет сигнатуры VP8L";
+        return;
+    }
+    image.width = image.vp8l.width;
+    image.height = image.vp8l.height;
+}
+
+// Чанки в [begin, end); false — очередной чанк выходит за end
+bool walkChunks(const uint8_t* data, uint64_t begin, uint64_t end, std::vector<WebpChunk>& chunks,
+    WebpChunk& overflow) {
+    uint64_t pos = begin;
+    while (pos + 8 <= end) {
+        WebpChunk chunk;
+        chunk.offset = pos;
+        chunk.fourcc = readFourCC(data + pos);
+        chunk.size = readLE32(data + pos + 4);
+        if (chunk.payload() + chunk.size > end) {
+            overflow = chunk;
+            return false;
+        }
+        chunks.push_back(chunk);
+        pos = chunk.end();
+    }
+    return true;
+}
+
+} // namespace
+
+bool parseWebpStructure(const uint8_t* data, size_t size, WebpStructure& webp) {
+    webp = WebpStructure();
+    if (size < 12 || readFourCC(data) != fourCC("RIFF") || readFourCC(data + 8) != fourCC("WEBP")) return false;
+    webp.riffSize = readLE32(data + 4);
+    webp.riffEnd = 8 + uint64_t(webp.riffSize);
+
+    uint64_t end = webp.riffEnd < size ? webp.riffEnd : size;
+    webp.overflow = !walkChunks(data, 12, end, webp.chunks, webp.overflowChunk);
+
+    if (!webp.chunks.empty() && webp.chunks[0].fourcc == fourCC("VP8X") && webp.chunks[0].size >= 10) {
+        const uint8_t* p = data + webp.chunks[0].payload();
+        webp.extended = true;
+        webp.flags = p[0];
+        webp.canvasWidth = readLE24(p + 4) + 1;
+        webp.canvasHeight = readLE24(p + 7) + 1;
+    }
+
+    bool hasAlphaChunk = false;
+    for (const WebpChunk& chunk : webp.chunks) {
+        if (chunk.fourcc == fourCC("ALPH")) hasAlphaChunk = true;
+        if (chunk.fourcc == fourCC("VP8 ") || chunk.fourcc == fourCC("VP8L")) {
+            WebpImage image;
+            parseImageChunk(data, chunk, image);
+            if (image.lossless && hasAlphaChunk) webp.alphaWithLossless++;
+            webp.images.push_back(std::move(image));
+        }
+        else if (chunk.fourcc == fourCC("ANMF") && chunk.size >= 16) {
+            // Кадр: X/2, Y/2, ширина-1, высота-1 (по 24 бита), длительность, флаги, затем чанки кадра
+            const uint8_t* p = data + chunk.payload();
+            uint64_t x = uint64_t(readLE24(p)) * 2, y = uint64_t(readLE24(p + 3)) * 2;
+            uint32_t width = readLE24(p + 6) + 1, height = readLE24(p + 9) + 1;
+            webp.frames++;
+            if (webp.extended && (x + width > webp.canvasWidth || y + height > webp.canvasHeight)) {
+                webp.framesOutsideCanvas++;
+            }
+            std::vector<WebpChunk> frameChunks;
+            WebpChunk frameOverflow;
+            if (!walkChunks(data, chunk.payload() + 16, chunk.payload() + chunk.size, frameChunks, frameOverflow)) {
+                webp.overflow = true;
+                webp.overflowChunk = frameOverflow;
+            }
+            bool frameAlpha = false;
+            for (const WebpChunk& sub : frameChunks) {
+                if (sub.fourcc == fourCC("ALPH")) frameAlpha = true;
+                if (sub.fourcc != fourCC("VP8 ") && sub.fourcc != fourCC("VP8L")) continue;
+                WebpImage image;
+                image.inFrame = true;
+                image.frameWidth = width;
+                image.frameHeight = height;
+                parseImageChunk(data, sub, image);
+                if (image.lossless && frameAlpha) webp.alphaWithLossless++;
+                webp.images.push_back(std::move(image));
+            }
+        }
+    }
+    return true;
+}
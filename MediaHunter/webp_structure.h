@@ -0,0 +1,64 @@
+﻿#ifndef WEBP_STRUCTURE_H
+#define WEBP_STRUCTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "vp8l_bitstream.h"
+
+// Чанк RIFF: заголовок 8 байт, данные и байт выравнивания при нечётном размере
+struct WebpChunk {
+    uint32_t fourcc = 0;
+    uint64_t offset = 0;
+    uint32_t size = 0;
+
+    uint64_t payload() const { return offset + 8; }
+    uint64_t end() const { return offset + 8 + size + (size & 1); }
+};
+
+// Поток изображения (VP8 или VP8L) верхнего уровня или внутри кадра ANMF
+struct WebpImage {
+    uint64_t offset = 0;          // смещение чанка
+    bool lossless = false;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool inFrame = false;         // внутри ANMF
+    uint32_t frameWidth = 0;      // размеры кадра ANMF
+    uint32_t frameHeight = 0;
+    std::string error;            // заголовок потока повреждён
+    Vp8lInfo vp8l;                // для VP8L: коды Хаффмана
+};
+
+struct WebpStructure {
+    uint32_t riffSize = 0;
+    uint64_t riffEnd = 0;                 // 8 + размер RIFF; может превышать размер файла
+    std::vector<WebpChunk> chunks;        // чанки верхнего уровня
+    bool overflow = false;                // чанк выходит за пределы RIFF или файла
+    WebpChunk overflowChunk;
+
+    bool extended = false;                // первый чанк — VP8X
+    uint8_t flags = 0;
+    uint32_t canvasWidth = 0;
+    uint32_t canvasHeight = 0;
+    std::vector<WebpImage> images;
+    size_t frames = 0;
+    size_t framesOutsideCanvas = 0;
+    size_t alphaWithLossless = 0;         // ALPH рядом с VP8L (альфа VP8L хранится в самом потоке)
+};
+
+// Флаги VP8X
+enum : uint8_t {
+    kWebpFlagAnimation = 0x02,
+    kWebpFlagXmp = 0x04,
+    kWebpFlagExif = 0x08,
+    kWebpFlagAlpha = 0x10,
+    kWebpFlagIcc = 0x20,
+    kWebpFlagsReserved = 0xC1
+};
+
+// Обход чанков RIFF/WEBP (включая вложенные в ANMF) и разбор заголовков
+// VP8/VP8L. false — нет заголовка RIFF/WEBP
+bool parseWebpStructure(const uint8_t* data, size_t size, WebpStructure& webp);
+
+#endif // WEBP_STRUCTURE_H
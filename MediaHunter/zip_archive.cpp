@@ -0,0 +1,196 @@
+﻿#include "zip_archive.h"
+#include "crc32.h"
+#include "inflate_stream.h"
+#include <algorithm>
+
+namespace {
+
+inline uint16_t readLE16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t readLE32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline uint64_t readLE64(const uint8_t* p) {
+    return uint64_t(readLE32(p)) | (uint64_t(readLE32(p + 4)) << 32);
+}
+
+const uint32_t kLocalHeader = 0x04034B50;
+const uint32_t kCentralHeader = 0x02014B50;
+const uint32_t kEndOfDirectory = 0x06054B50;
+const uint32_t kZip64EndOfDirectory = 0x06064B50;
+const uint32_t kZip64Locator = 0x07064B50;
+const size_t kEndOfDirectorySize = 22;
+const size_t kMaxCommentSize = 0xFFFF;
+
+// Последний EOCD, комментарий которого укладывается в файл
+bool findEndOfDirectory(const uint8_t* data, size_t size, size_t& at) {
+    if (size < kEndOfDirectorySize) return false;
+    size_t lowest = size > kEndOfDirectorySize + kMaxCommentSize ? size - kEndOfDirectorySize - kMaxCommentSize : 0;
+    for (size_t pos = size - kEndOfDirectorySize + 1; pos-- > lowest;) {
+        if (readLE32(data + pos) == kEndOfDirectory && pos + kEndOfDirectorySize + readLE16(data + pos + 20) <= size) {
+            at = pos;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Поля со значением 0xFFFF/0xFFFFFFFF берутся из дополнительного поля ZIP64
+// (0x0001) в порядке: размер без сжатия, сжатый размер, смещение заголовка
+void applyZip64Extra(const uint8_t* extra, size_t length, ZipEntry& entry) {
+    size_t pos = 0;
+    while (pos + 4 <= length) {
+        uint16_t id = readLE16(extra + pos);
+        uint16_t fieldSize = readLE16(extra + pos + 2);
+        if (pos + 4 + fieldSize > length) return;
+        if (id == 0x0001) {
+            const uint8_t* field = extra + pos + 4;
+            size_t offset = 0;
+            auto take = [&](uint64_t& value) {
+                if (offset + 8 > fieldSize) return;
+                value = readLE64(field + offset);
+                offset += 8;
+            };
+            if (entry.uncompressedSize == 0xFFFFFFFF) take(entry.uncompressedSize);
+            if (entry.compressedSize == 0xFFFFFFFF) take(entry.compressedSize);
+            if (entry.localHeaderOffset == 0xFFFFFFFF) take(entry.localHeaderOffset);
+            return;
+        }
+        pos += 4 + fieldSize;
+    }
+}
+
+bool hasPrefix(const std::string& name, const char* prefix) {
+    return name.rfind(prefix, 0) == 0;
+}
+
+// Документы Office Open XML, OpenDocument и Java-архивы — это ZIP с
+// характерным набором записей
+std::string archiveKind(const std::vector<ZipEntry>& entries) {
+    bool contentTypes = false;
+    bool word = false, excel = false, powerPoint = false, odf = false, manifest = false;
+    for (const ZipEntry& entry : entries) {
+        contentTypes = contentTypes || entry.name == "[Content_Types].xml";
+        word = word || hasPrefix(entry.name, "word/");
+        excel = excel || hasPrefix(entry.name, "xl/");
+        powerPoint = powerPoint || hasPrefix(entry.name, "ppt/");
+        odf = odf || entry.name == "mimetype";
+        manifest = manifest || entry.name == "META-INF/MANIFEST.MF";
+    }
+    if (contentTypes && word) return "DOCX";
+    if (contentTypes && excel) return "XLSX";
+    if (contentTypes && powerPoint) return "PPTX";
+    if (odf) return "ODF";
+    if (manifest) return "JAR";
+    return "ZIP";
+}
+
+} // namespace
+
+bool parseZipArchive(const uint8_t* data, size_t size, ZipArchive& zip, size_t maxEntries) {
+    zip = ZipArchive();
+    size_t eocd = 0;
+    if (!data || !findEndOfDirectory(data, size, eocd)) return false;
+
+    zip.declaredEntries = readLE16(data + eocd + 10);
+    zip.directorySize = readLE32(data + eocd + 12);
+    zip.directoryOffset = readLE32(data + eocd + 16);
+    uint64_t directoryEnd = eocd;
+
+    // Локатор ZIP64 лежит непосредственно перед EOCD
+    if (eocd >= 20 && readLE32(data + eocd - 20) == kZip64Locator) {
+        uint64_t record = readLE64(data + eocd - 20 + 8);
+        if (record <= size && size - record >= 56 && readLE32(data + record) == kZip64EndOfDirectory) {
+            zip.zip64 = true;
+            zip.declaredEntries = readLE64(data + record + 32);
+            zip.directorySize = readLE64(data + record + 40);
+            zip.directoryOffset = readLE64(data + record + 48);
+            directoryEnd = record;
+        }
+    }
+
+    // Данные перед архивом (самораспаковывающийся модуль, полиглот) сдвигают
+    // каталог относительно записанного смещения на одну и ту же величину
+    uint64_t shift = 0;
+    if (!zip.zip64 && zip.directorySize <= directoryEnd && zip.directoryOffset + zip.directorySize < directoryEnd) {
+        uint64_t actual = directoryEnd - zip.directorySize;
+        if (actual >= zip.directoryOffset && readLE32(data + actual) == kCentralHeader) {
+            shift = actual - zip.directoryOffset;
+        }
+    }
+    zip.leadingBytes = shift;
+    uint64_t pos = zip.directoryOffset + shift;
+
+    while (zip.entries.size() < zip.declaredEntries && zip.entries.size() < maxEntries) {
+        if (pos > size || size - pos < 46 || readLE32(data + pos) != kCentralHeader) {
+            zip.directoryTruncated = true;
+            break;
+        }
+        const uint8_t* header = data + pos;
+        uint16_t nameLength = readLE16(header + 28);
+        uint16_t extraLength = readLE16(header + 30);
+        uint16_t commentLength = readLE16(header + 32);
+        uint64_t next = pos + 46 + nameLength + extraLength + commentLength;
+        if (next > size) {
+            zip.directoryTruncated = true;
+            break;
+        }
+
+        ZipEntry entry;
+        entry.flags = readLE16(header + 8);
+        entry.method = readLE16(header + 10);
+        entry.crc32 = readLE32(header + 16);
+        entry.compressedSize = readLE32(header + 20);
+        entry.uncompressedSize = readLE32(header + 24);
+        entry.localHeaderOffset = readLE32(header + 42);
+        entry.name.assign(reinterpret_cast<const char*>(header + 46), nameLength);
+        applyZip64Extra(header + 46 + nameLength, extraLength, entry);
+        entry.localHeaderOffset += shift;
+        zip.entries.push_back(std::move(entry));
+        pos = next;
+    }
+    zip.kind = archiveKind(zip.entries);
+    return true;
+}
+
+ZipExtractResult extractZipEntry(const uint8_t* data, size_t size, const ZipEntry& entry,
+    uint64_t outputLimit, std::vector<uint8_t>& buffer, ByteView& content, std::string& error) {
+    content = ByteView();
+    if (entry.encrypted()) return ZipExtractResult::Encrypted;
+    if (entry.method != 0 && entry.method != 8) return ZipExtractResult::Unsupported;
+
+    // Длины имени и дополнительного поля локального заголовка могут
+    // отличаться от записанных в центральном каталоге
+    uint64_t header = entry.localHeaderOffset;
+    if (header > size || size - header < 30 || readLE32(data + header) != kLocalHeader) {
+        error = "локальный заголовок не найден";
+        return ZipExtractResult::Corrupt;
+    }
+    uint64_t start = header + 30 + readLE16(data + header + 26) + readLE16(data + header + 28);
+    if (start > size || entry.compressedSize > size - start) {
+        error = "сжатые данные выходят за пределы файла";
+        return ZipExtractResult::Corrupt;
+    }
+    const uint8_t* compressed = data + start;
+
+    if (entry.method == 0) {
+        if (entry.compressedSize > outputLimit) return ZipExtractResult::OutputLimit;
+        content = ByteView(compressed, static_cast<size_t>(entry.compressedSize));
+    }
+    else {
+        buffer.clear();
+        Inflater inflater(Inflater::Format::Raw, outputLimit);
+        Inflater::Result result = inflater.run(compressed, static_cast<size_t>(entry.compressedSize), buffer);
+        if (result == Inflater::Result::OutputLimit) return ZipExtractResult::OutputLimit;
+        if (result != Inflater::Result::Done) {
+            error = inflater.error();
+            return ZipExtractResult::Corrupt;
+        }
+        content = ByteView(buffer);
+    }
+    if (computeCrc32(content.data(), content.size()) != entry.crc32) return ZipExtractResult::CrcMismatch;
+    return ZipExtractResult::Ok;
+}
@@ -0,0 +1,55 @@
+﻿#ifndef ZIP_ARCHIVE_H
+#define ZIP_ARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "byte_ranges.h"
+
+// Запись центрального каталога ZIP; размеры и смещение уже с учётом ZIP64
+struct ZipEntry {
+    std::string name;
+    uint16_t flags = 0;
+    uint16_t method = 0;              // 0 — без сжатия, 8 — Deflate
+    uint32_t crc32 = 0;
+    uint64_t compressedSize = 0;
+    uint64_t uncompressedSize = 0;
+    uint64_t localHeaderOffset = 0;
+
+    bool encrypted() const { return (flags & 0x01) != 0; }
+    bool directory() const { return !name.empty() && name.back() == '/'; }
+};
+
+struct ZipArchive {
+    std::string kind;                 // ZIP, DOCX, XLSX, PPTX, ODF, JAR — по именам записей
+    bool zip64 = false;
+    uint64_t directoryOffset = 0;
+    uint64_t directorySize = 0;
+    uint64_t declaredEntries = 0;     // число записей по EOCD
+    uint64_t leadingBytes = 0;        // данные перед архивом (SFX, полиглот)
+    bool directoryTruncated = false;  // каталог оборвался раньше заявленного числа записей
+    std::vector<ZipEntry> entries;    // не более maxEntries записей
+};
+
+// Поиск конца центрального каталога (EOCD, при необходимости ZIP64) в
+// последних 64 КБ файла и чтение каталога прямо из отображения без
+// обращения к локальным заголовкам. false — каталог не найден
+bool parseZipArchive(const uint8_t* data, size_t size, ZipArchive& zip, size_t maxEntries);
+
+enum class ZipExtractResult {
+    Ok,
+    Unsupported,      // метод сжатия кроме Stored и Deflate
+    Encrypted,
+    Corrupt,          // локальный заголовок или поток Deflate повреждён, данные за концом файла
+    OutputLimit,      // распакованные данные превышают outputLimit
+    CrcMismatch       // содержимое извлечено, но CRC-32 не совпала
+};
+
+// Содержимое записи. Несжатые записи отдаются видом на отображение без
+// копирования, сжатые распаковываются в buffer: его содержимое заменяется,
+// а ёмкость сохраняется, поэтому один буфер служит для всех записей архива
+ZipExtractResult extractZipEntry(const uint8_t* data, size_t size, const ZipEntry& entry,
+    uint64_t outputLimit, std::vector<uint8_t>& buffer, ByteView& content, std::string& error);
+
+#endif // ZIP_ARCHIVE_H